@@ -0,0 +1,242 @@
+//
+// MathBench.cpp
+// Micro-benchmark of the hot Vector4/Matrix4 operations used by the quadrics.
+//
+// Usage: math_bench [--iterations N]
+//
+// Every operation is checked on random inputs against a scalar copy of the previous out-of-line implementation
+// (kept below, not inlinable across the call as it used to be without LTO), then both are timed. Results are
+// printed as CSV; the exit code is non zero if any operation differs by more than the tolerance.
+//
+
+#include <Vector4.hpp>
+#include <Matrix4.hpp>
+#include <SIMD.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+namespace
+{
+	using Math::Scalar;
+
+	// The implementations as they were in Math/*/src before the operations moved inline
+	namespace Reference
+	{
+		BENCH_NOINLINE Scalar dot(const Math::Vector4& a, const Math::Vector4& b)
+		{
+			return a.coordinates.x * b.coordinates.x + a.coordinates.y * b.coordinates.y +
+				   a.coordinates.z * b.coordinates.z + a.coordinates.w * b.coordinates.w;
+		}
+
+		BENCH_NOINLINE Math::Vector4 add(const Math::Vector4& a, const Math::Vector4& b)
+		{
+			return {a.coordinates.x + b.coordinates.x, a.coordinates.y + b.coordinates.y,
+					a.coordinates.z + b.coordinates.z, a.coordinates.w + b.coordinates.w};
+		}
+
+		BENCH_NOINLINE Math::Vector4 scale(const Math::Vector4& a, const Scalar& k)
+		{
+			return {a.coordinates.x * k, a.coordinates.y * k, a.coordinates.z * k, a.coordinates.w * k};
+		}
+
+		BENCH_NOINLINE Math::Vector4 multiply(const Math::Matrix4& m, const Math::Vector4& v)
+		{
+			const Scalar* d = m.data;
+			return {v.coordinates.x * d[0] + v.coordinates.y * d[1] + v.coordinates.z * d[2] + v.coordinates.w * d[3],
+					v.coordinates.x * d[4] + v.coordinates.y * d[5] + v.coordinates.z * d[6] + v.coordinates.w * d[7],
+					v.coordinates.x * d[8] + v.coordinates.y * d[9] + v.coordinates.z * d[10] + v.coordinates.w * d[11],
+					v.coordinates.x * d[12] + v.coordinates.y * d[13] + v.coordinates.z * d[14] + v.coordinates.w * d[15]};
+		}
+
+		BENCH_NOINLINE Math::Matrix4 add(const Math::Matrix4& a, const Math::Matrix4& b)
+		{
+			Math::Matrix4 result(a);
+			for (unsigned int i = 0; i < 16; ++i)
+				result.data[i] += b.data[i];
+			return result;
+		}
+
+		BENCH_NOINLINE Math::Matrix4 scale(const Math::Matrix4& a, const Scalar& k)
+		{
+			Math::Matrix4 result(a);
+			for (unsigned int i = 0; i < 16; ++i)
+				result.data[i] *= k;
+			return result;
+		}
+
+		// Quadric::evaluateSQEM: s'As + b's + c
+		BENCH_NOINLINE Scalar evaluate(const Math::Matrix4& A, const Math::Vector4& b, Scalar c, const Math::Vector4& s)
+		{
+			return dot(s, multiply(A, s)) + dot(b, s) + c;
+		}
+	}
+
+	struct Inputs
+	{
+		std::vector<Math::Vector4> vectors;
+		std::vector<Math::Matrix4> matrices;
+		std::vector<Scalar> scalars;
+	};
+
+	Inputs randomInputs(int count, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<Scalar> uniform(-10, 10);
+
+		Inputs inputs;
+		for (int i = 0; i < count; i++)
+		{
+			inputs.vectors.emplace_back(uniform(generator), uniform(generator), uniform(generator), uniform(generator));
+			inputs.scalars.push_back(uniform(generator));
+
+			Math::Matrix4 m;
+			for (Scalar& d : m.data)
+				d = uniform(generator);
+			inputs.matrices.push_back(m);
+		}
+
+		return inputs;
+	}
+
+	Scalar relativeError(Scalar expected, Scalar actual)
+	{
+		return std::abs(expected - actual) / std::max(static_cast<Scalar>(1), std::abs(expected));
+	}
+
+	Scalar relativeError(const Math::Vector4& expected, const Math::Vector4& actual)
+	{
+		Scalar error = 0;
+		for (short i = 0; i < 4; i++)
+			error = std::max(error, relativeError(expected[i], actual[i]));
+		return error;
+	}
+
+	Scalar relativeError(const Math::Matrix4& expected, const Math::Matrix4& actual)
+	{
+		Scalar error = 0;
+		for (int i = 0; i < 16; i++)
+			error = std::max(error, relativeError(expected.data[i], actual.data[i]));
+		return error;
+	}
+
+	// Runs body over all the inputs for the given number of passes, the checksum keeps the work observable
+	template <typename Body>
+	double nanosecondsPerOperation(int passes, int count, const Body& body, Scalar& checksum)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (int p = 0; p < passes; p++)
+			for (int i = 0; i < count; i++)
+				checksum += body(i);
+
+		auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		return elapsed / (static_cast<double>(passes) * count);
+	}
+
+	// Validates the current implementation of an operation against the reference, times both and prints the row
+	template <typename ReferenceOp, typename CurrentOp, typename ErrorOp>
+	bool runOperation(const std::string& name, int passes, int count, Scalar tolerance, const ReferenceOp& reference,
+					  const CurrentOp& current, const ErrorOp& error, Scalar& checksum)
+	{
+		Scalar maxError = 0;
+		for (int i = 0; i < count; i++)
+			maxError = std::max(maxError, error(i));
+
+		bool ok = maxError <= tolerance;
+
+		double referenceTime = nanosecondsPerOperation(passes, count, reference, checksum);
+		double currentTime = nanosecondsPerOperation(passes, count, current, checksum);
+
+		std::cout << name << "," << Math::SIMD::backend() << "," << std::fixed << std::setprecision(3) << referenceTime
+				  << "," << currentTime << "," << referenceTime / currentTime << "," << std::scientific
+				  << std::setprecision(2) << maxError << std::defaultfloat << "," << (ok ? "yes" : "NO") << std::endl;
+
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int passes = 200;
+	for (int i = 1; i + 1 < argc; i++)
+		if (std::string(argv[i]) == "--iterations")
+			passes = std::max(1, std::stoi(argv[++i]));
+
+	const int count = 4096;
+	const Scalar tolerance = std::is_same<Scalar, float>::value ? 1e-5 : 1e-12;
+
+	Inputs in = randomInputs(count, 42);
+	auto next = [&](int i) { return (i + 1) % count; };
+
+	bool valid = true;
+	Scalar checksum = 0;
+
+	std::cout << "operation,backend,reference_ns,current_ns,speedup,max_relative_error,valid" << std::endl;
+
+	// Each lambda folds its result into a Scalar so that the compiler cannot drop the call
+	valid &= runOperation("vector4_dot", passes, count, tolerance,
+		[&](int i) { return Reference::dot(in.vectors[i], in.vectors[next(i)]); },
+		[&](int i) { return in.vectors[i].dot(in.vectors[next(i)]); },
+		[&](int i) { return relativeError(Reference::dot(in.vectors[i], in.vectors[next(i)]), in.vectors[i].dot(in.vectors[next(i)])); },
+		checksum);
+
+	valid &= runOperation("vector4_add", passes, count, tolerance,
+		[&](int i) { return Reference::add(in.vectors[i], in.vectors[next(i)]).coordinates.w; },
+		[&](int i) { return (in.vectors[i] + in.vectors[next(i)]).coordinates.w; },
+		[&](int i) { return relativeError(Reference::add(in.vectors[i], in.vectors[next(i)]), in.vectors[i] + in.vectors[next(i)]); },
+		checksum);
+
+	valid &= runOperation("vector4_scale", passes, count, tolerance,
+		[&](int i) { return Reference::scale(in.vectors[i], in.scalars[i]).coordinates.w; },
+		[&](int i) { return (in.vectors[i] * in.scalars[i]).coordinates.w; },
+		[&](int i) { return relativeError(Reference::scale(in.vectors[i], in.scalars[i]), in.vectors[i] * in.scalars[i]); },
+		checksum);
+
+	valid &= runOperation("matrix4_vector4", passes, count, tolerance,
+		[&](int i) { return Reference::multiply(in.matrices[i], in.vectors[i]).coordinates.w; },
+		[&](int i) { return (in.matrices[i] * in.vectors[i]).coordinates.w; },
+		[&](int i) { return relativeError(Reference::multiply(in.matrices[i], in.vectors[i]), in.matrices[i] * in.vectors[i]); },
+		checksum);
+
+	valid &= runOperation("matrix4_add", passes, count, tolerance,
+		[&](int i) { return Reference::add(in.matrices[i], in.matrices[next(i)]).data[15]; },
+		[&](int i) { return (in.matrices[i] + in.matrices[next(i)]).data[15]; },
+		[&](int i) { return relativeError(Reference::add(in.matrices[i], in.matrices[next(i)]), in.matrices[i] + in.matrices[next(i)]); },
+		checksum);
+
+	valid &= runOperation("matrix4_scale", passes, count, tolerance,
+		[&](int i) { return Reference::scale(in.matrices[i], in.scalars[i]).data[15]; },
+		[&](int i) { return (in.matrices[i] * in.scalars[i]).data[15]; },
+		[&](int i) { return relativeError(Reference::scale(in.matrices[i], in.scalars[i]), in.matrices[i] * in.scalars[i]); },
+		checksum);
+
+	auto evaluate = [&](int i)
+	{
+		return in.vectors[i].dot(in.matrices[i] * in.vectors[i]) + in.vectors[next(i)].dot(in.vectors[i]) + in.scalars[i];
+	};
+
+	valid &= runOperation("quadric_evaluate", passes, count, tolerance,
+		[&](int i) { return Reference::evaluate(in.matrices[i], in.vectors[next(i)], in.scalars[i], in.vectors[i]); },
+		evaluate,
+		[&](int i) { return relativeError(Reference::evaluate(in.matrices[i], in.vectors[next(i)], in.scalars[i], in.vectors[i]), evaluate(i)); },
+		checksum);
+
+	// Printed so the timed loops have an observable result
+	std::cerr << "checksum " << checksum << std::endl;
+
+	return valid ? 0 : 1;
+}
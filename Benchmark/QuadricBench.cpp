@@ -0,0 +1,238 @@
+//
+// QuadricBench.cpp
+// Micro-benchmark of the batched candidate solve (QuadricBatch) against one Quadric::getMinimumAndMinimizer per
+// candidate, the way updateCost solves them.
+//
+// Usage: quadric_bench [--iterations N] [--candidates N]
+//
+// The candidates are pairs of sphere quadrics built like the ones of a sphere mesh (face quadrics around a point
+// plus the vertex regularizer). Some radii fall under the minimum radius and two thirds of the pairs get a maximum
+// radius around the one of their spheres, so every branch of the solve is taken. Both QuadricBatch::solveScalar and
+// QuadricBatch::solve are checked against the per candidate solve (summed quadric, minimizer and cost, see
+// compare), singular quadrics included, then timed in blocks as the simplification runs them. Results are printed
+// as CSV; the exit code is non zero if any of them differs by more than the tolerance.
+//
+
+#include <Quadric.hpp>
+#include <QuadricBatch.hpp>
+#include <SIMD.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Math::Scalar;
+
+	struct Candidate
+	{
+		Renderer::Quadric a, b;
+		Scalar maximumRadius = DBL_MAX;
+	};
+
+	Renderer::Quadric sphereQuadric(std::mt19937& generator, const Math::Vector3& center, Scalar radius)
+	{
+		std::normal_distribution<Scalar> normal(0, 1);
+		std::uniform_int_distribution<int> faceCount(1, 12);
+
+		Renderer::Quadric q;
+		const int faces = faceCount(generator);
+		for (int f = 0; f < faces; f++)
+		{
+			Math::Vector3 n(normal(generator), normal(generator), normal(generator));
+			n.normalize();
+
+			Renderer::Quadric face(center + n * radius, n);
+			q += face;
+		}
+
+		Renderer::Vertex vertex(center + Math::Vector3(radius, 0, 0), Math::Vector3(1, 0, 0));
+		q += Renderer::Quadric::initializeQuadricFromVertex(vertex, radius) * 1e-6;
+
+		return q;
+	}
+
+	std::vector<Candidate> randomCandidates(int count, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<Scalar> position(-1, 1);
+		std::uniform_real_distribution<Scalar> radius(0.005, 0.2);
+		std::uniform_int_distribution<int> bound(0, 2);
+
+		std::vector<Candidate> candidates(count);
+		for (Candidate& c : candidates)
+		{
+			Math::Vector3 center(position(generator), position(generator), position(generator));
+			Math::Vector3 offset = Math::Vector3(position(generator), position(generator), position(generator)) * 0.05;
+			Scalar r = radius(generator);
+
+			c.a = sphereQuadric(generator, center, r);
+			c.b = sphereQuadric(generator, center + offset, r);
+
+			// Unbounded, or a maximum somewhere around the radius of the spheres
+			if (bound(generator) > 0)
+				c.maximumRadius = r * std::uniform_real_distribution<Scalar>(0.5, 1.5)(generator);
+		}
+
+		return candidates;
+	}
+
+	Scalar relativeError(Scalar expected, Scalar actual)
+	{
+		return std::abs(expected - actual) / std::max(static_cast<Scalar>(1), std::abs(expected));
+	}
+
+	// Largest difference from the per candidate solve. With FMA contraction the two solves round differently, and a
+	// nearly singular A turns that into a shift of the minimizer along its flat direction, to a cost that is lower as
+	// often as higher. So the batch minimizer is checked by its bounds and by the SQEM it reaches, which may not exceed
+	// the per candidate one; singular sums must give the same (-1, -1, -1, 0) marker
+	Scalar compare(const std::vector<Candidate>& candidates, const Renderer::QuadricBatch& batch, bool& sameBranch)
+	{
+		Scalar error = 0;
+
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			Renderer::Quadric sum = candidates[i].a + candidates[i].b;
+
+			Scalar cost;
+			Math::Vector4 minimizer;
+			sum.getMinimumAndMinimizer(cost, minimizer, candidates[i].maximumRadius);
+
+			Renderer::Quadric batchSum = batch.getSum(i);
+			for (int k = 0; k < 16; k++)
+				error = std::max(error, relativeError(sum.A.data[k], batchSum.A.data[k]));
+			for (int k = 0; k < 4; k++)
+				error = std::max(error, relativeError(sum.b[k], batchSum.b[k]));
+			error = std::max(error, relativeError(sum.c, batchSum.c));
+
+			Math::Vector4 batchMinimizer = batch.getMinimizer(i);
+			if (minimizer[3] == 0)
+				for (int k = 0; k < 4; k++)
+					sameBranch &= batchMinimizer[k] == minimizer[k];
+			else
+			{
+				// A maximum under the minimum radius leaves either of them
+				Scalar low = std::min(0.01, candidates[i].maximumRadius);
+				Scalar high = std::max(0.01, candidates[i].maximumRadius);
+				sameBranch &= batchMinimizer[3] >= low && batchMinimizer[3] <= high;
+			}
+
+			error = std::max(error, relativeError(sum.evaluateSQEM(batchMinimizer), batch.getCost(i)));
+			error = std::max(error, relativeError(cost, std::max(cost, batch.getCost(i))));
+		}
+
+		return error;
+	}
+
+	void fill(const std::vector<Candidate>& candidates, size_t begin, size_t end, Renderer::QuadricBatch& batch)
+	{
+		batch.clear();
+		for (size_t i = begin; i < end; i++)
+			batch.add(candidates[i].a, candidates[i].b, candidates[i].maximumRadius);
+	}
+
+	// Runs body over all the candidates for the given number of passes, the checksum keeps the work observable
+	template <typename Body>
+	double nanosecondsPerCandidate(int passes, size_t count, const Body& body, Scalar& checksum)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (int p = 0; p < passes; p++)
+			checksum += body();
+
+		auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		return elapsed / (static_cast<double>(passes) * static_cast<double>(count));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int passes = 50;
+	int count = 4096;
+	for (int i = 1; i + 1 < argc; i++)
+		if (std::string(argv[i]) == "--iterations")
+			passes = std::max(1, std::stoi(argv[++i]));
+		else if (std::string(argv[i]) == "--candidates")
+			count = std::max(1, std::stoi(argv[++i]));
+
+	const Scalar tolerance = 1e-6;
+
+	std::vector<Candidate> candidates = randomCandidates(count, 42);
+
+	// Singular sums, THIERY spheres start from an empty quadric, on every lane of a vector
+	std::vector<Candidate> singular = randomCandidates(7, 7);
+	for (size_t i = 0; i < singular.size(); i += 2)
+		singular[i].a = singular[i].b = Renderer::Quadric();
+
+	Renderer::QuadricBatch batch;
+	bool valid = true;
+	Scalar checksum = 0;
+
+	std::cout << "operation,backend,reference_ns,current_ns,speedup,max_relative_error,valid" << std::endl;
+
+	auto reference = [&]()
+	{
+		Scalar total = 0;
+		for (const Candidate& c : candidates)
+		{
+			Scalar cost;
+			Math::Vector4 minimizer;
+			(c.a + c.b).getMinimumAndMinimizer(cost, minimizer, c.maximumRadius);
+			total += cost;
+		}
+		return total;
+	};
+
+	const std::pair<const char*, bool> modes[] = {{"candidate_solve_scalar", false}, {"candidate_solve", true}};
+	for (const auto& [name, vectorized] : modes)
+	{
+		// Timed in blocks, the way SphereMesh::solveCandidates fills and solves them
+		auto solve = [&]()
+		{
+			constexpr size_t BLOCK = 256;
+
+			Scalar total = 0;
+			for (size_t first = 0; first < candidates.size(); first += BLOCK)
+			{
+				fill(candidates, first, std::min(first + BLOCK, candidates.size()), batch);
+				vectorized ? batch.solve() : batch.solveScalar();
+
+				for (size_t i = 0; i < batch.size(); i++)
+					total += batch.getCost(i);
+			}
+			return total;
+		};
+
+		bool sameBranch = true;
+		fill(candidates, 0, candidates.size(), batch);
+		vectorized ? batch.solve() : batch.solveScalar();
+		Scalar maxError = compare(candidates, batch, sameBranch);
+
+		fill(singular, 0, singular.size(), batch);
+		vectorized ? batch.solve() : batch.solveScalar();
+		maxError = std::max(maxError, compare(singular, batch, sameBranch));
+
+		bool ok = sameBranch && maxError <= tolerance;
+		valid &= ok;
+
+		double referenceTime = nanosecondsPerCandidate(passes, candidates.size(), reference, checksum);
+		double currentTime = nanosecondsPerCandidate(passes, candidates.size(), solve, checksum);
+
+		std::cout << name << "," << (vectorized ? Math::SIMD::backend() : "scalar") << "," << std::fixed
+		          << std::setprecision(3) << referenceTime << "," << currentTime << "," << referenceTime / currentTime
+		          << "," << std::scientific << std::setprecision(2) << maxError << std::defaultfloat << ","
+		          << (ok ? "yes" : "NO") << std::endl;
+	}
+
+	// Printed so the timed loops have an observable result
+	std::cerr << "checksum " << checksum << std::endl;
+
+	return valid ? 0 : 1;
+}
@@ -0,0 +1,354 @@
+//
+// QueryBench.cpp
+// Throughput of the envelope queries of SphereMeshBVH (closest point, ray cast and sphere overlap) against a brute
+// force loop over all the primitives.
+//
+// Usage: query_bench [--queries N] [--target N] [--repetitions N] [--threads 1,2,4] [--seed N]
+//                    [--output results.csv] [model.obj ...]
+//
+// Every model is simplified to --target spheres and the BVH is built over its spheres, edge capsules and triangle
+// slabs. Seeded random queries are drawn around the bounding box: points, rays from a sphere around the model toward
+// points of the box, and spheres of up to 5% of the bounding box diagonal. The batched BVH queries are checked
+// against the brute force answers, then both are timed for every thread count (median of the repetitions, the brute
+// force splits its queries over the threads the same way). Results are written as CSV (query_bench.csv by default,
+// the pipeline logs to stdout); the exit code is non zero if any BVH answer differs from the brute force one.
+//
+
+#include <TriMesh.hpp>
+#include <SphereMesh.hpp>
+#include <SphereMeshBVH.hpp>
+#include <Region.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+namespace
+{
+	using Math::Scalar;
+	using Renderer::SphereMeshBVH;
+
+	struct QuerySettings
+	{
+		int queries = 100000;
+		int target = 250;
+		int repetitions = 5;
+		std::vector<int> threads = {1};
+		unsigned int seed = 42;
+		std::vector<std::string> models;
+		std::string output = "query_bench.csv";
+	};
+
+	struct Queries
+	{
+		std::vector<Math::Vector3> points;
+		std::vector<Renderer::Ray> rays;
+		std::vector<Math::Vector4> spheres;
+	};
+
+	std::vector<int> parseList(const std::string& list)
+	{
+		std::vector<int> values;
+		std::istringstream stream(list);
+		std::string token;
+
+		while (std::getline(stream, token, ','))
+			if (!token.empty())
+				values.push_back(std::max(1, std::stoi(token)));
+
+		return values;
+	}
+
+	QuerySettings parseArguments(int argc, char** argv)
+	{
+		QuerySettings settings;
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+
+			if (arg == "--queries" && i + 1 < argc)
+				settings.queries = std::max(1, std::stoi(argv[++i]));
+			else if (arg == "--target" && i + 1 < argc)
+				settings.target = std::max(1, std::stoi(argv[++i]));
+			else if (arg == "--repetitions" && i + 1 < argc)
+				settings.repetitions = std::max(1, std::stoi(argv[++i]));
+			else if (arg == "--threads" && i + 1 < argc)
+				settings.threads = parseList(argv[++i]);
+			else if (arg == "--seed" && i + 1 < argc)
+				settings.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+			else if (arg == "--output" && i + 1 < argc)
+				settings.output = argv[++i];
+			else
+				settings.models.push_back(arg);
+		}
+
+		if (settings.threads.empty())
+			settings.threads = {1};
+
+		if (settings.models.empty())
+		{
+			const std::string root = SPHERE_MESH_ASSETS_DIR;
+			settings.models = {root + "/bunny250.obj", root + "/dragon.obj", root + "/hand.obj", root + "/lion.obj"};
+		}
+
+		return settings;
+	}
+
+	Queries randomQueries(const Renderer::TriMesh& mesh, int count, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<Scalar> uniform(0, 1);
+
+		const Math::Vector3 boxMin = mesh.bbox.minCorner;
+		const Math::Vector3 diagonal = mesh.bbox.BDD();
+		const Scalar size = diagonal.magnitude();
+		const Math::Vector3 center = boxMin + diagonal * 0.5;
+
+		// Somewhere in the bounding box, grown by a tenth on every side
+		auto inBox = [&]()
+		{
+			return boxMin + Math::Vector3(diagonal[0] * (uniform(generator) * 1.2 - 0.1),
+			                              diagonal[1] * (uniform(generator) * 1.2 - 0.1),
+			                              diagonal[2] * (uniform(generator) * 1.2 - 0.1));
+		};
+
+		Queries queries;
+		queries.points.reserve(count);
+		queries.rays.reserve(count);
+		queries.spheres.reserve(count);
+
+		for (int i = 0; i < count; i++)
+			queries.points.push_back(inBox());
+
+		std::normal_distribution<Scalar> normal(0, 1);
+		for (int i = 0; i < count; i++)
+		{
+			Math::Vector3 outside(normal(generator), normal(generator), normal(generator));
+			outside.normalize();
+
+			Renderer::Ray ray;
+			ray.origin = center + outside * size;
+			ray.direction = inBox() - ray.origin;
+			ray.direction.normalize();
+			queries.rays.push_back(ray);
+		}
+
+		for (int i = 0; i < count; i++)
+			queries.spheres.emplace_back(inBox(), uniform(generator) * 0.05 * size);
+
+		return queries;
+	}
+
+	// The same answers as the BVH, from every primitive
+	namespace BruteForce
+	{
+		Renderer::EnvelopeHit closest(const SphereMeshBVH& bvh, const Math::Vector3& p)
+		{
+			Renderer::EnvelopeHit hit;
+			hit.distance = DBL_MAX;
+
+			for (int i = 0; i < static_cast<int>(bvh.primitives.size()); i++)
+			{
+				Scalar weights[3]{0, 0, 0};
+				Scalar d = SphereMeshBVH::signedDistance(bvh.primitives[i], p, weights);
+				if (d < hit.distance)
+				{
+					hit.distance = d;
+					hit.primitive = i;
+					std::copy(weights, weights + 3, hit.weights);
+				}
+			}
+
+			return hit;
+		}
+
+		Renderer::RayHit raycast(const SphereMeshBVH& bvh, const Renderer::Ray& ray)
+		{
+			Renderer::RayHit hit;
+
+			for (int i = 0; i < static_cast<int>(bvh.primitives.size()); i++)
+			{
+				Scalar t = SphereMeshBVH::rayDistance(bvh.primitives[i], ray);
+				if (t < hit.distance)
+				{
+					hit.distance = t;
+					hit.primitive = i;
+				}
+			}
+
+			return hit;
+		}
+
+		bool overlaps(const SphereMeshBVH& bvh, const Math::Vector4& sphere)
+		{
+			Scalar weights[3];
+			for (const Renderer::EnvelopePrimitive& primitive : bvh.primitives)
+				if (SphereMeshBVH::signedDistance(primitive, sphere.truncateToVector3(), weights) < sphere.coordinates.w)
+					return true;
+
+			return false;
+		}
+	}
+
+	// Same distance from both; the primitive may differ only where two of them are at the same distance
+	int mismatches(const SphereMeshBVH& bvh, const Queries& queries)
+	{
+		std::vector<Renderer::EnvelopeHit> closest;
+		std::vector<Renderer::RayHit> rays;
+		std::vector<std::uint8_t> overlaps;
+
+		bvh.closest(queries.points, closest);
+		bvh.raycast(queries.rays, rays);
+		bvh.overlaps(queries.spheres, overlaps);
+
+		int wrong = 0;
+		for (size_t i = 0; i < queries.points.size(); i++)
+		{
+			wrong += closest[i].distance != BruteForce::closest(bvh, queries.points[i]).distance;
+			wrong += rays[i].distance != BruteForce::raycast(bvh, queries.rays[i]).distance;
+			wrong += (overlaps[i] != 0) != BruteForce::overlaps(bvh, queries.spheres[i]);
+		}
+
+		return wrong;
+	}
+
+	double median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		size_t mid = values.size() / 2;
+
+		return values.size() % 2 == 0 ? (values[mid - 1] + values[mid]) / 2.0 : values[mid];
+	}
+
+	// Median seconds of a batch over the repetitions, the checksum keeps the answers observable
+	template <typename Batch>
+	double medianSeconds(int repetitions, const Batch& batch, Scalar& checksum)
+	{
+		std::vector<double> seconds;
+
+		for (int r = 0; r < repetitions; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			checksum += batch();
+			seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		return median(seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	QuerySettings settings = parseArguments(argc, argv);
+
+	Renderer::Region::initialize();
+
+	std::ofstream out(settings.output);
+	if (!out.is_open())
+	{
+		std::cerr << "Cannot open output file: " << settings.output << std::endl;
+		return 1;
+	}
+
+	out << "model,spheres,primitives,query,threads,queries,bvh_queries_per_s,brute_force_queries_per_s,speedup,valid"
+	    << std::endl;
+
+	bool valid = true;
+	Scalar checksum = 0;
+
+	for (const std::string& path : settings.models)
+	{
+		if (!std::filesystem::exists(path))
+		{
+			std::cerr << "Skipping missing model: " << path << std::endl;
+			continue;
+		}
+
+		Renderer::TriMesh mesh(path, nullptr);
+		Renderer::SphereMesh sm(&mesh, nullptr);
+		sm.initializeEdgeQueue();
+		sm.collapseSphereMesh(settings.target);
+
+		SphereMeshBVH bvh;
+		bvh.build(sm);
+
+		Queries queries = randomQueries(mesh, settings.queries, settings.seed);
+		const int wrong = mismatches(bvh, queries);
+		valid &= wrong == 0;
+
+		const int n = settings.queries;
+		const std::string model = std::filesystem::path(path).stem().string();
+
+		for (int threads : settings.threads)
+		{
+			omp_set_num_threads(threads);
+
+			std::vector<Renderer::EnvelopeHit> closest(n);
+			std::vector<Renderer::RayHit> rays(n);
+			std::vector<std::uint8_t> overlaps(n);
+
+			// BVH batch and brute force batch of every query type
+			auto point = [&]() { bvh.closest(queries.points, closest); return closest[0].distance; };
+			auto pointBrute = [&]()
+			{
+				#pragma omp parallel for schedule(dynamic, 256)
+				for (int i = 0; i < n; i++)
+					closest[i] = BruteForce::closest(bvh, queries.points[i]);
+				return closest[0].distance;
+			};
+
+			auto ray = [&]() { bvh.raycast(queries.rays, rays); return static_cast<Scalar>(rays[0].primitive); };
+			auto rayBrute = [&]()
+			{
+				#pragma omp parallel for schedule(dynamic, 256)
+				for (int i = 0; i < n; i++)
+					rays[i] = BruteForce::raycast(bvh, queries.rays[i]);
+				return static_cast<Scalar>(rays[0].primitive);
+			};
+
+			auto overlap = [&]() { bvh.overlaps(queries.spheres, overlaps); return static_cast<Scalar>(overlaps[0]); };
+			auto overlapBrute = [&]()
+			{
+				#pragma omp parallel for schedule(dynamic, 256)
+				for (int i = 0; i < n; i++)
+					overlaps[i] = BruteForce::overlaps(bvh, queries.spheres[i]) ? 1 : 0;
+				return static_cast<Scalar>(overlaps[0]);
+			};
+
+			auto report = [&](const char* query, double bvhSeconds, double bruteSeconds)
+			{
+				out << model << "," << sm.getTimedSphereSize() << "," << bvh.primitives.size() << "," << query << ","
+				    << threads << "," << n << "," << std::fixed << std::setprecision(0) << n / bvhSeconds << ","
+				    << n / bruteSeconds << "," << std::setprecision(2) << bruteSeconds / bvhSeconds
+				    << std::defaultfloat << "," << (wrong == 0 ? "yes" : "NO") << std::endl;
+			};
+
+			report("closest_point", medianSeconds(settings.repetitions, point, checksum),
+			       medianSeconds(settings.repetitions, pointBrute, checksum));
+			report("raycast", medianSeconds(settings.repetitions, ray, checksum), medianSeconds(settings.repetitions, rayBrute, checksum));
+			report("sphere_overlap", medianSeconds(settings.repetitions, overlap, checksum),
+			       medianSeconds(settings.repetitions, overlapBrute, checksum));
+		}
+
+		if (wrong > 0)
+			std::cerr << model << ": " << wrong << " BVH answers differ from the brute force ones" << std::endl;
+	}
+
+	// Printed so the timed loops have an observable result
+	std::cerr << "checksum " << checksum << std::endl;
+
+	return valid ? 0 : 1;
+}
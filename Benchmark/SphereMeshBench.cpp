@@ -0,0 +1,758 @@
+//
+// SphereMeshBench.cpp
+// Headless timing of the sphere-mesh pipeline over the bundled models.
+//
+// Usage: sphere_mesh_bench [--repetitions N] [--targets 1000,250,50] [--max-error 0.01] [--error-samples N]
+//                          [--precisions double,float] [--schedulers greedy,multiple-choice,batched] [--seed N]
+//                          [--threads 1,2,4,8] [--rings 2,3,4] [--neighbourhood-radius R] [--prune-errors 0,0.01]
+//                          [--vertex-orders file,spatial] [--chunk-vertices 0,20000] [--edits N] [--refine N]
+//                          [--sequence dir] [--output results.csv] [model.obj ...]
+//
+// Every stage is repeated N times and reported as one CSV row (median and sample standard deviation in seconds),
+// in a fixed order, so two runs on different commits can be compared with a plain diff. The results go to a file
+// (sphere_mesh_bench.csv by default) because the pipeline itself logs to stdout. After every target the distance from
+// the input surface to the sphere mesh is measured as well (error_<target> rows, relative to the bounding box
+// diagonal), --error-samples 0 turns it off. With --max-error a fresh sphere mesh is also collapsed in a single
+// error-bounded pass (collapse_error row, the reached sphere count is in the spheres column). Every precision in
+// --precisions is run as its own mode (OUR, OUR_FLOAT, ...), float ranks the candidate collapses with float solves.
+// Every scheduler in --schedulers is a mode as well, the multiple-choice one (_MC) is seeded with --seed, the batched
+// one is _BATCH. The quadric_error column is the summed sphere quadric error after every collapse_<target> stage,
+// comparable between schedulers, and the solves column is the number of quadric solves the stage took. With
+// --threads every mode is run again for each OpenMP thread count (_T<n>). --rings and --prune-errors do the same for
+// the depth of the initial neighbourhoods (_R<n>) and the cost bound over which initial pairs are pruned (_P<e>),
+// --neighbourhood-radius cuts every neighbourhood at that distance (relative to the bounding box diagonal). The
+// queue_size column holds the entries of the initial collapse queue. Every heap allocation of the process goes
+// through a counting operator new, allocations is the average over the spheres removed by a collapse_<target> stage.
+// Every order in --vertex-orders is a mode as well: file keeps the vertices as the OBJ lists them, spatial (_SPATIAL)
+// sorts them along a Morton curve at load, the load row includes the sort. Every size in --chunk-vertices (other than
+// 0, the unchunked run) is a mode where the initial spheres come from the chunked simplification with chunks of about
+// that many vertices (_C<n>), the init row covers the chunks and the stitch. The process also keeps track of its live
+// heap: peak_heap_mb is the most it held during the init, queue and collapse_<target> stages. With --edits every
+// target is followed by N drag edits of random spheres (seeded with --seed), each one applied with
+// SphereMesh::updateAfterEdit the way the editor does on release (edit_<target> rows, seconds per edit, the solves
+// column holds the quadric solves of all the edits); the next target is collapsed from the edited sphere mesh.
+// --refine runs SphereMesh::refineSpheres for up to N iterations after every target (refine_<target> rows, seconds
+// per iteration, the iterations are in the solves column) and measures the error again (error_refined_<target>);
+// the refined centers and radii are put back before going on, so the other rows don't depend on it.
+// --sequence takes a directory of poses of one mesh (Assets/Models/camel-poses, horse-gallop): the *-reference.obj
+// pose is simplified to every target, then all the poses with the same vertices and faces are refitted to it
+// (refit_<target> rows, the pose count is in the solves column) and saved as one .sphere-mesh-sequence file.
+//
+
+#include <TriMesh.hpp>
+#include <SphereMesh.hpp>
+#include <Region.hpp>
+#include <ApproximationError.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <omp.h>
+
+#ifndef SPHERE_MESH_ASSETS_DIR
+#define SPHERE_MESH_ASSETS_DIR "Assets/Models"
+#endif
+
+namespace
+{
+	std::atomic<long long> heapAllocations{0};
+	std::atomic<long long> heapBytes{0};
+	std::atomic<long long> heapPeakBytes{0};
+
+	void releaseHeap(void* p)
+	{
+		if (p != nullptr)
+			heapBytes.fetch_sub(static_cast<long long>(malloc_usable_size(p)), std::memory_order_relaxed);
+
+		std::free(p);
+	}
+
+	// Peak of the live heap from now on
+	void resetHeapPeak()
+	{
+		heapPeakBytes.store(heapBytes.load());
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+	{
+		long long live = heapBytes.fetch_add(static_cast<long long>(malloc_usable_size(p)), std::memory_order_relaxed) +
+		                 static_cast<long long>(malloc_usable_size(p));
+
+		long long peak = heapPeakBytes.load(std::memory_order_relaxed);
+		while (live > peak && !heapPeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	releaseHeap(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	releaseHeap(p);
+}
+
+namespace
+{
+	enum class Scheduler
+	{
+		GREEDY,
+		MULTIPLE_CHOICE,
+		BATCHED
+	};
+
+	struct BenchmarkSettings
+	{
+		int repetitions = 5;
+		std::vector<int> targets = {1000, 500, 250, 100, 50};
+		int errorSamples = 100000;
+		double maxError = 0;
+		std::vector<bool> floatCosts = {false};
+		std::vector<bool> spatialOrders = {false};
+		std::vector<Scheduler> schedulers = {Scheduler::GREEDY};
+		unsigned int seed = 42;
+		std::vector<int> threads;
+		std::vector<int> rings;
+		double neighbourhoodRadius = -1;
+		std::vector<double> pruneErrors;
+		std::vector<int> chunkVertices;
+		int edits = 0;
+		int refinements = 0;
+		std::vector<std::string> models;
+		std::vector<std::string> sequences;
+		std::string output = "sphere_mesh_bench.csv";
+	};
+
+	struct StageSamples
+	{
+		std::string model;
+		std::string mode;
+		std::string stage;
+		int spheres = 0;
+		std::vector<double> seconds;
+		Renderer::ApproximationError error;
+		bool hasError = false;
+		double quadricError = 0;
+		bool hasQuadricError = false;
+		long long solves = -1;
+		long long queueSize = -1;
+		double allocations = -1;
+		double peakHeap = -1;
+	};
+
+	class Stopwatch
+	{
+		private:
+			std::chrono::steady_clock::time_point start;
+
+		public:
+			Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+			[[nodiscard]] double elapsed() const
+			{
+				return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+	};
+
+	double median(std::vector<double> values)
+	{
+		if (values.empty())
+			return 0;
+
+		std::sort(values.begin(), values.end());
+		size_t mid = values.size() / 2;
+
+		return values.size() % 2 == 0 ? (values[mid - 1] + values[mid]) / 2.0 : values[mid];
+	}
+
+	double standardDeviation(const std::vector<double>& values)
+	{
+		if (values.size() < 2)
+			return 0;
+
+		double mean = 0;
+		for (double v : values)
+			mean += v;
+		mean /= static_cast<double>(values.size());
+
+		double sum = 0;
+		for (double v : values)
+			sum += (v - mean) * (v - mean);
+
+		return std::sqrt(sum / static_cast<double>(values.size() - 1));
+	}
+
+	double peakHeapMegabytes()
+	{
+		return static_cast<double>(heapPeakBytes.load()) / (1024.0 * 1024.0);
+	}
+
+	std::vector<int> parseTargets(const std::string& list)
+	{
+		std::vector<int> targets;
+		std::istringstream stream(list);
+		std::string token;
+
+		while (std::getline(stream, token, ','))
+			if (!token.empty())
+				targets.push_back(std::stoi(token));
+
+		std::sort(targets.begin(), targets.end(), std::greater<>());
+		return targets;
+	}
+
+	std::vector<double> parseErrors(const std::string& list)
+	{
+		std::vector<double> errors;
+		std::istringstream stream(list);
+		std::string token;
+
+		while (std::getline(stream, token, ','))
+			if (!token.empty())
+				errors.push_back(std::max(0.0, std::stod(token)));
+
+		return errors;
+	}
+
+	std::vector<bool> parsePrecisions(const std::string& list)
+	{
+		std::vector<bool> precisions;
+		std::istringstream stream(list);
+		std::string token;
+
+		while (std::getline(stream, token, ','))
+			if (token == "double" || token == "float")
+				precisions.push_back(token == "float");
+
+		return precisions.empty() ? std::vector<bool>{false} : precisions;
+	}
+
+	std::vector<bool> parseVertexOrders(const std::string& list)
+	{
+		std::vector<bool> orders;
+		std::istringstream stream(list);
+		std::string token;
+
+		while (std::getline(stream, token, ','))
+			if (token == "file" || token == "spatial")
+				orders.push_back(token == "spatial");
+
+		return orders.empty() ? std::vector<bool>{false} : orders;
+	}
+
+	std::vector<Scheduler> parseSchedulers(const std::string& list)
+	{
+		std::vector<Scheduler> schedulers;
+		std::istringstream stream(list);
+		std::string token;
+
+		while (std::getline(stream, token, ','))
+			if (token == "greedy")
+				schedulers.push_back(Scheduler::GREEDY);
+			else if (token == "multiple-choice")
+				schedulers.push_back(Scheduler::MULTIPLE_CHOICE);
+			else if (token == "batched")
+				schedulers.push_back(Scheduler::BATCHED);
+
+		return schedulers.empty() ? std::vector<Scheduler>{Scheduler::GREEDY} : schedulers;
+	}
+
+	std::string schedulerSuffix(Scheduler scheduler)
+	{
+		switch (scheduler)
+		{
+			case Scheduler::MULTIPLE_CHOICE: return "_MC";
+			case Scheduler::BATCHED: return "_BATCH";
+			default: return "";
+		}
+	}
+
+	std::vector<std::string> defaultModels()
+	{
+		const std::string root = SPHERE_MESH_ASSETS_DIR;
+
+		return {
+			root + "/bunny250.obj",
+			root + "/dragon.obj",
+			root + "/hand.obj",
+			root + "/lion.obj",
+			root + "/camel-poses/camel-reference.obj",
+			root + "/horse-gallop/horse-gallop-reference.obj"
+		};
+	}
+
+	BenchmarkSettings parseArguments(int argc, char** argv)
+	{
+		BenchmarkSettings settings;
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+
+			if (arg == "--repetitions" && i + 1 < argc)
+				settings.repetitions = std::max(1, std::stoi(argv[++i]));
+			else if (arg == "--targets" && i + 1 < argc)
+				settings.targets = parseTargets(argv[++i]);
+			else if (arg == "--max-error" && i + 1 < argc)
+				settings.maxError = std::max(0.0, std::stod(argv[++i]));
+			else if (arg == "--precisions" && i + 1 < argc)
+				settings.floatCosts = parsePrecisions(argv[++i]);
+			else if (arg == "--vertex-orders" && i + 1 < argc)
+				settings.spatialOrders = parseVertexOrders(argv[++i]);
+			else if (arg == "--schedulers" && i + 1 < argc)
+				settings.schedulers = parseSchedulers(argv[++i]);
+			else if (arg == "--seed" && i + 1 < argc)
+				settings.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+			else if (arg == "--threads" && i + 1 < argc)
+				settings.threads = parseTargets(argv[++i]);
+			else if (arg == "--rings" && i + 1 < argc)
+				settings.rings = parseTargets(argv[++i]);
+			else if (arg == "--neighbourhood-radius" && i + 1 < argc)
+				settings.neighbourhoodRadius = std::max(0.0, std::stod(argv[++i]));
+			else if (arg == "--prune-errors" && i + 1 < argc)
+				settings.pruneErrors = parseErrors(argv[++i]);
+			else if (arg == "--chunk-vertices" && i + 1 < argc)
+				settings.chunkVertices = parseTargets(argv[++i]);
+			else if (arg == "--refine" && i + 1 < argc)
+				settings.refinements = std::max(0, std::stoi(argv[++i]));
+			else if (arg == "--edits" && i + 1 < argc)
+				settings.edits = std::max(0, std::stoi(argv[++i]));
+			else if (arg == "--error-samples" && i + 1 < argc)
+				settings.errorSamples = std::max(0, std::stoi(argv[++i]));
+			else if (arg == "--sequence" && i + 1 < argc)
+				settings.sequences.push_back(argv[++i]);
+			else if (arg == "--output" && i + 1 < argc)
+				settings.output = argv[++i];
+			else
+				settings.models.push_back(arg);
+		}
+
+		if (settings.models.empty() && settings.sequences.empty())
+			settings.models = defaultModels();
+
+		return settings;
+	}
+
+	std::string modelName(const std::string& path)
+	{
+		return std::filesystem::path(path).stem().string();
+	}
+
+	// Moves random spheres by up to half their radius and scales their radius by 0.8 to 1.2, like a drag in the editor
+	void dragSpheres(Renderer::SphereMesh& sm, int edits, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_int_distribution<int> pick(0, static_cast<int>(sm.timedSpheres.size()) - 1);
+		std::uniform_real_distribution<double> offset(-0.5, 0.5);
+		std::uniform_real_distribution<double> scale(0.8, 1.2);
+
+		for (int e = 0; e < edits; e++)
+		{
+			int i = pick(generator);
+			while (sm.alias(i) != i)
+				i = pick(generator);
+
+			Renderer::Sphere& sphere = sm.timedSpheres[i].sphere;
+			sphere.center += Math::Vector3(offset(generator), offset(generator), offset(generator)) * sphere.radius;
+			sphere.radius *= scale(generator);
+
+			sm.updateAfterEdit(sphere.getID());
+		}
+	}
+
+	// Runs the whole pipeline once for a model, appending one sample to every stage it goes through
+	// rings and pruneError are left to the sphere mesh defaults when negative, chunkVertices 0 doesn't chunk
+	void runPipeline(const std::string& path, bool thiery, bool floatCosts, bool spatialOrder, Scheduler scheduler,
+	                 int threads, int rings, double pruneError, int chunkVertices, const BenchmarkSettings& settings,
+	                 std::map<std::string, StageSamples>& stages, std::vector<std::string>& order)
+	{
+		const std::string model = modelName(path);
+		std::ostringstream pruneSuffix;
+		if (pruneError >= 0)
+			pruneSuffix << "_P" << pruneError;
+		
+		const std::string mode = std::string(thiery ? "THIERY" : "OUR") + (floatCosts ? "_FLOAT" : "") +
+		                         (spatialOrder ? "_SPATIAL" : "") + schedulerSuffix(scheduler) + (threads > 0 ? "_T" + std::to_string(threads) : "") +
+		                         (rings > 0 ? "_R" + std::to_string(rings) : "") + pruneSuffix.str() +
+		                         (chunkVertices > 0 ? "_C" + std::to_string(chunkVertices) : "");
+
+		auto record = [&](const std::string& stage, int spheres, double seconds)
+		{
+			auto it = stages.find(stage);
+			if (it == stages.end())
+			{
+				order.push_back(stage);
+				StageSamples samples;
+				samples.model = model;
+				samples.mode = mode;
+				samples.stage = stage;
+				samples.spheres = spheres;
+				it = stages.emplace(stage, std::move(samples)).first;
+			}
+
+			it->second.spheres = spheres;
+			it->second.seconds.push_back(seconds);
+			return &it->second;
+		};
+
+		Stopwatch loadTimer;
+		Renderer::TriMesh mesh(path, nullptr, spatialOrder);
+		record("load", static_cast<int>(mesh.vertices.size()), loadTimer.elapsed());
+
+		Stopwatch curvatureTimer;
+		mesh.computeVerticesCurvatureIGL();
+		record("curvature", static_cast<int>(mesh.vertices.size()), curvatureTimer.elapsed());
+
+		std::unique_ptr<Renderer::ApproximationErrorEvaluator> evaluator;
+		if (settings.errorSamples > 0)
+			evaluator = std::make_unique<Renderer::ApproximationErrorEvaluator>(mesh, settings.errorSamples);
+
+		// A chunked sphere mesh is only bound at construction, so that the whole per vertex state is never built
+		resetHeapPeak();
+		Stopwatch initTimer;
+		std::unique_ptr<Renderer::SphereMesh> sphereMesh;
+		if (chunkVertices > 0)
+			sphereMesh = std::make_unique<Renderer::SphereMesh>(&mesh, nullptr, Renderer::SphereMesh::Deferred{});
+		else
+			sphereMesh = std::make_unique<Renderer::SphereMesh>(&mesh, nullptr);
+		Renderer::SphereMesh& sm = *sphereMesh;
+		double initSeconds = initTimer.elapsed();
+		
+		// Like the editor, THIERY mode and the neighbourhood settings are switched on after construction and applied
+		// by a reset
+		if (thiery || rings > 0 || settings.neighbourhoodRadius >= 0 || pruneError >= 0 || chunkVertices > 0)
+		{
+			Stopwatch resetTimer;
+			sm.CHUNK_VERTICES = chunkVertices;
+			sm.IMPLEMENT_THIERY_2013 = thiery;
+			if (rings > 0)
+				sm.NEIGHBOURHOOD_RINGS = rings;
+			if (settings.neighbourhoodRadius >= 0)
+				sm.NEIGHBOURHOOD_RADIUS = settings.neighbourhoodRadius;
+			if (pruneError >= 0)
+				sm.CANDIDATE_PRUNE_ERROR = pruneError;
+			sm.resetSphereMesh();
+			initSeconds = resetTimer.elapsed();
+		}
+		record("init", sm.getTimedSphereSize(), initSeconds)->peakHeap = peakHeapMegabytes();
+
+		sm.FLOAT_CANDIDATE_COSTS = floatCosts;
+
+		resetHeapPeak();
+		Stopwatch queueTimer;
+		sm.initializeEdgeQueue();
+		StageSamples* queued = record("queue", sm.getTimedSphereSize(), queueTimer.elapsed());
+		queued->queueSize = sm.getQueueSize();
+		queued->peakHeap = peakHeapMegabytes();
+
+		for (int target : settings.targets)
+		{
+			if (target >= sm.getTimedSphereSize())
+				continue;
+
+			long long solvedBefore = sm.getSolvedCollapses();
+			int spheresBefore = sm.getTimedSphereSize();
+			long long allocationsBefore = heapAllocations.load();
+			resetHeapPeak();
+			Stopwatch collapseTimer;
+			if (scheduler == Scheduler::MULTIPLE_CHOICE)
+				sm.collapseSphereMeshMultipleChoice(target, settings.seed);
+			else if (scheduler == Scheduler::BATCHED)
+				sm.collapseSphereMeshBatched(target);
+			else
+				sm.collapseSphereMesh(target);
+			double collapseSeconds = collapseTimer.elapsed();
+			long long allocations = heapAllocations.load() - allocationsBefore;
+
+			StageSamples* collapsed = record("collapse_" + std::to_string(target), sm.getTimedSphereSize(),
+			                                 collapseSeconds);
+			collapsed->quadricError = sm.getQuadricError();
+			collapsed->hasQuadricError = true;
+			collapsed->solves = sm.getSolvedCollapses() - solvedBefore;
+			collapsed->allocations = static_cast<double>(allocations) / std::max(1, spheresBefore - sm.getTimedSphereSize());
+			collapsed->peakHeap = peakHeapMegabytes();
+
+			if (evaluator)
+			{
+				Stopwatch errorTimer;
+				Renderer::ApproximationError error = evaluator->evaluate(sm);
+				StageSamples* samples = record("error_" + std::to_string(target), sm.getTimedSphereSize(), errorTimer.elapsed());
+				samples->error = error;
+				samples->hasError = true;
+			}
+
+			if (settings.refinements > 0)
+			{
+				std::vector<Renderer::TimedSphere> collapsedSpheres = sm.timedSpheres;
+
+				Stopwatch refineTimer;
+				auto iterations = sm.refineSpheres(settings.refinements);
+				double refineSeconds = refineTimer.elapsed();
+
+				const int count = std::max<int>(1, static_cast<int>(iterations.size()) - 1);
+				record("refine_" + std::to_string(target), sm.getTimedSphereSize(), refineSeconds / count)->solves =
+					static_cast<long long>(iterations.size()) - 1;
+
+				if (evaluator)
+				{
+					Stopwatch errorTimer;
+					Renderer::ApproximationError error = evaluator->evaluate(sm);
+					StageSamples* samples = record("error_refined_" + std::to_string(target), sm.getTimedSphereSize(),
+					                               errorTimer.elapsed());
+					samples->error = error;
+					samples->hasError = true;
+				}
+
+				sm.timedSpheres = collapsedSpheres;
+			}
+
+			if (settings.edits > 0)
+			{
+				solvedBefore = sm.getSolvedCollapses();
+				Stopwatch editTimer;
+				dragSpheres(sm, settings.edits, settings.seed + target);
+				record("edit_" + std::to_string(target), sm.getTimedSphereSize(), editTimer.elapsed() / settings.edits)
+					->solves = sm.getSolvedCollapses() - solvedBefore;
+			}
+		}
+
+		std::string folder = std::filesystem::temp_directory_path().string() + "/";
+		Stopwatch saveTimer;
+		sm.saveTXT(folder, model + "_" + mode + ".sphere-mesh");
+		record("save", sm.getTimedSphereSize(), saveTimer.elapsed());
+
+		Stopwatch plyTimer;
+		sm.savePLY(folder, model + "_" + mode + ".ply");
+		record("save_ply", sm.getTimedSphereSize(), plyTimer.elapsed());
+
+		if (settings.maxError <= 0)
+			return;
+
+		sm.resetSphereMesh();
+
+		Stopwatch errorBoundTimer;
+		sm.collapseSphereMeshUnderError(settings.maxError);
+		StageSamples* bounded = record("collapse_error", sm.getTimedSphereSize(), errorBoundTimer.elapsed());
+
+		if (evaluator)
+		{
+			bounded->error = evaluator->evaluate(sm);
+			bounded->hasError = true;
+		}
+	}
+
+	// One simplification of the reference pose and a refit of every pose for each target
+	void runSequence(const std::string& directory, const BenchmarkSettings& settings,
+	                 std::map<std::string, StageSamples>& stages, std::vector<std::string>& order)
+	{
+		const std::string model = std::filesystem::path(directory).filename().string();
+
+		auto record = [&](const std::string& stage, int spheres, double seconds)
+		{
+			auto it = stages.find(stage);
+			if (it == stages.end())
+			{
+				order.push_back(stage);
+				StageSamples samples;
+				samples.model = model;
+				samples.mode = "SEQUENCE";
+				samples.stage = stage;
+				samples.spheres = spheres;
+				it = stages.emplace(stage, std::move(samples)).first;
+			}
+
+			it->second.spheres = spheres;
+			it->second.seconds.push_back(seconds);
+			return &it->second;
+		};
+
+		std::vector<std::string> paths;
+		std::string referencePath;
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+			if (entry.path().extension() == ".obj")
+			{
+				const std::string stem = entry.path().stem().string();
+				paths.push_back(entry.path().string());
+				if (stem.size() > 10 && stem.compare(stem.size() - 10, 10, "-reference") == 0)
+					referencePath = entry.path().string();
+			}
+
+		if (referencePath.empty())
+		{
+			std::cerr << "No *-reference.obj pose in " << directory << std::endl;
+			return;
+		}
+
+		std::sort(paths.begin(), paths.end());
+
+		Renderer::TriMesh reference(referencePath, nullptr);
+		reference.computeVerticesCurvatureIGL();
+
+		Stopwatch loadTimer;
+		std::vector<std::vector<Math::Vector3>> poses;
+		for (const std::string& path : paths)
+		{
+			Renderer::TriMesh pose(path, nullptr);
+			if (pose.vertices.size() != reference.vertices.size() || pose.faces.size() != reference.faces.size())
+				continue;
+
+			std::vector<Math::Vector3>& positions = poses.emplace_back();
+			positions.reserve(pose.vertices.size());
+			for (const Renderer::Vertex& v : pose.vertices)
+				positions.push_back(v.position);
+		}
+		record("load_poses", static_cast<int>(poses.size()), loadTimer.elapsed());
+
+		Stopwatch initTimer;
+		Renderer::SphereMesh sm(&reference, nullptr);
+		record("init", sm.getTimedSphereSize(), initTimer.elapsed());
+
+		std::vector<std::vector<Math::Vector4>> fitted;
+		for (int target : settings.targets)
+		{
+			if (target >= sm.getTimedSphereSize())
+				continue;
+
+			Stopwatch collapseTimer;
+			sm.collapseSphereMesh(target);
+			record("collapse_" + std::to_string(target), sm.getTimedSphereSize(), collapseTimer.elapsed());
+
+			Stopwatch refitTimer;
+			fitted = sm.refitToPoses(poses);
+			record("refit_" + std::to_string(target), sm.getTimedSphereSize(), refitTimer.elapsed())->solves =
+				static_cast<long long>(poses.size());
+		}
+
+		std::string folder = std::filesystem::temp_directory_path().string() + "/";
+		Stopwatch saveTimer;
+		sm.saveSequenceTXT(folder, model + ".sphere-mesh-sequence", fitted);
+		record("save", sm.getTimedSphereSize(), saveTimer.elapsed());
+	}
+
+	void writeRows(std::ostream& out, const std::map<std::string, StageSamples>& stages,
+	               const std::vector<std::string>& order)
+	{
+		for (const std::string& stage : order)
+		{
+			const StageSamples& s = stages.at(stage);
+			out << s.model << "," << s.mode << "," << s.stage << "," << s.spheres << "," << s.seconds.size() << ","
+			    << std::setprecision(6) << std::fixed << median(s.seconds) << "," << standardDeviation(s.seconds);
+
+			// The error is deterministic (fixed seed), the last repetition is as good as any
+			if (s.hasError)
+				out << "," << s.error.maxRelative << "," << s.error.meanRelative << "," << s.error.rmsRelative;
+			else
+				out << ",,,";
+
+			out << ",";
+			if (s.hasQuadricError)
+				out << std::scientific << s.quadricError;
+
+			out << ",";
+			if (s.solves >= 0)
+				out << s.solves;
+
+			out << ",";
+			if (s.queueSize >= 0)
+				out << s.queueSize;
+
+			out << ",";
+			if (s.allocations >= 0)
+				out << std::fixed << std::setprecision(1) << s.allocations << std::setprecision(6);
+
+			out << ",";
+			if (s.peakHeap >= 0)
+				out << std::fixed << std::setprecision(1) << s.peakHeap << std::setprecision(6);
+
+			out << std::defaultfloat << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSettings settings = parseArguments(argc, argv);
+
+	Renderer::Region::initialize();
+
+	std::ofstream out(settings.output);
+	if (!out.is_open())
+	{
+		std::cerr << "Cannot open output file: " << settings.output << std::endl;
+		return 1;
+	}
+
+	out << "model,mode,stage,spheres,repetitions,median_s,stdev_s,max_error_bdd,mean_error_bdd,rms_error_bdd,"
+	       "quadric_error,solves,queue_size,allocations,peak_heap_mb" << std::endl;
+
+	for (const std::string& path : settings.models)
+	{
+		if (!std::filesystem::exists(path))
+		{
+			std::cerr << "Skipping missing model: " << path << std::endl;
+			continue;
+		}
+
+		for (bool thiery : {false, true})
+			for (bool floatCosts : settings.floatCosts)
+				for (bool spatialOrder : settings.spatialOrders)
+					for (Scheduler scheduler : settings.schedulers)
+						for (int threads : settings.threads.empty() ? std::vector<int>{0} : settings.threads)
+							for (int rings : settings.rings.empty() ? std::vector<int>{0} : settings.rings)
+								for (double prune : settings.pruneErrors.empty() ? std::vector<double>{-1} : settings.pruneErrors)
+									for (int chunk : settings.chunkVertices.empty() ? std::vector<int>{0} : settings.chunkVertices)
+									{
+										if (threads > 0)
+											omp_set_num_threads(threads);
+
+										std::map<std::string, StageSamples> stages;
+										std::vector<std::string> order;
+
+										for (int r = 0; r < settings.repetitions; r++)
+											runPipeline(path, thiery, floatCosts, spatialOrder, scheduler, threads, rings,
+											            prune, chunk, settings, stages, order);
+
+										writeRows(out, stages, order);
+									}
+	}
+
+	for (const std::string& directory : settings.sequences)
+	{
+		std::map<std::string, StageSamples> stages;
+		std::vector<std::string> order;
+
+		for (int r = 0; r < settings.repetitions; r++)
+			runSequence(directory, settings, stages, order);
+
+		writeRows(out, stages, order);
+	}
+
+	std::cout << "Benchmark results written to " << settings.output << std::endl;
+	return 0;
+}
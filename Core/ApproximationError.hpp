@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Vector3.hpp>
+#include <SphereMeshBVH.hpp>
+
+#include <vector>
+
+namespace Renderer
+{
+	class TriMesh;
+	class SphereMesh;
+
+	// Distances from the input surface to the sphere-mesh envelope, absolute and relative to the bounding box diagonal
+	struct ApproximationError
+	{
+		int samples{0};
+
+		Math::Scalar max{0};
+		Math::Scalar mean{0};
+		Math::Scalar rms{0};
+
+		Math::Scalar maxRelative{0};
+		Math::Scalar meanRelative{0};
+		Math::Scalar rmsRelative{0};
+	};
+
+	// One-sided Hausdorff and mean distance of a TriMesh to a SphereMesh. The surface is sampled once (all the
+	// vertices plus seeded area-weighted points on the faces), so repeated evaluations are comparable
+	class ApproximationErrorEvaluator
+	{
+		private:
+			std::vector<Math::Vector3> samples;
+			Math::Scalar BDDSize{1};
+
+			SphereMeshBVH bvh;
+
+		public:
+			explicit ApproximationErrorEvaluator(const TriMesh& mesh, int surfaceSamples = 100000, unsigned int seed = 42);
+
+			[[nodiscard]] int getSampleCount() const;
+
+			ApproximationError evaluate(SphereMesh& sm);
+	};
+}
@@ -4,6 +4,7 @@
 #include <Vector4.hpp>
 
 #include <TimedSphere.hpp>
+#include <InlineVector.hpp>
 
 #include <functional>
 #include <ostream>
@@ -16,7 +17,6 @@ namespace Renderer
 			Quadric error;
 			Math::Vector4 centerRadius;
             Math::Scalar cost{};
-			Region region;
 	    
 #ifdef REGISTER_EPSILON
 			Math::Scalar epsilonOfCollapse{-1};
@@ -24,7 +24,11 @@ namespace Renderer
 		
 			int timestamp{-1};
 			
-			std::vector<int> toCollapse;
+			// The cost is only a lower bound, the collapse is solved once it reaches the top of the queue
+			bool lazy{false};
+			
+			// A pair, and the spheres it engulfs, fit inline: queue entries never allocate on their own
+			InlineVector<int, 4> toCollapse;
             
             EdgeCollapse();
             EdgeCollapse(int i, int j, int _timestamp);
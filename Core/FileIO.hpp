@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace Renderer
+{
+	// FNV-1a over raw bytes, chainable through the seed
+	inline std::uint64_t hashBytes(const void* data, size_t size, std::uint64_t seed = 1469598103934665603ULL)
+	{
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			seed ^= bytes[i];
+			seed *= 1099511628211ULL;
+		}
+		return seed;
+	}
+
+	// Binary writer with its own buffer. Everything goes to <path>.tmp, commit() renames it over the final path, so a
+	// reader never sees a half written file. A writer destroyed without commit removes the temporary file
+	class BufferedWriter
+	{
+		private:
+			std::string path;
+			std::string temporaryPath;
+			std::FILE* file{nullptr};
+			std::vector<char> buffer;
+			size_t used{0};
+			bool failed{false};
+
+			void flush();
+
+		public:
+			explicit BufferedWriter(const std::string& path, size_t bufferSize = 1 << 20);
+			~BufferedWriter();
+
+			BufferedWriter(const BufferedWriter&) = delete;
+			BufferedWriter& operator = (const BufferedWriter&) = delete;
+
+			[[nodiscard]] bool isOpen() const { return file != nullptr; }
+
+			void write(const void* data, size_t size);
+
+			template <typename T>
+			void write(const T& value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+				write(&value, sizeof(T));
+			}
+
+			// Element count followed by the elements
+			template <typename T>
+			void writeArray(const std::vector<T>& values)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+				write(static_cast<std::uint64_t>(values.size()));
+				write(values.data(), values.size() * sizeof(T));
+			}
+
+			// Text output. Doubles are written as the shortest decimal that reads back to the same value
+			void writeText(std::string_view text) { write(text.data(), text.size()); }
+			void writeDecimal(double value);
+			void writeInteger(std::int64_t value);
+
+			bool commit();
+	};
+
+	// Read-only memory map of a whole file (read into memory where mmap is not available)
+	class MappedFile
+	{
+		private:
+			const char* bytes{nullptr};
+			size_t length{0};
+			std::vector<char> fallback;
+
+		public:
+			explicit MappedFile(const std::string& path);
+			~MappedFile();
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator = (const MappedFile&) = delete;
+
+			[[nodiscard]] bool isOpen() const { return bytes != nullptr; }
+			[[nodiscard]] const char* data() const { return bytes; }
+			[[nodiscard]] size_t size() const { return length; }
+	};
+
+	// Sequential reads over a mapped file. A read past the end fails the reader instead of throwing, the caller
+	// checks ok() once the values it needs have been read
+	class BinaryReader
+	{
+		private:
+			const char* cursor;
+			const char* end;
+			bool failed{false};
+
+		public:
+			BinaryReader(const char* data, size_t size) : cursor(data), end(data + size) {}
+			explicit BinaryReader(const MappedFile& file) : BinaryReader(file.data(), file.size()) {}
+
+			[[nodiscard]] bool ok() const { return !failed; }
+
+			// Pointer to the next size bytes, nullptr if the file is shorter than that
+			const char* take(size_t size)
+			{
+				if (failed || static_cast<size_t>(end - cursor) < size)
+				{
+					failed = true;
+					return nullptr;
+				}
+
+				const char* result = cursor;
+				cursor += size;
+				return result;
+			}
+
+			template <typename T>
+			T read()
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "only plain values can be read");
+				T value{};
+				if (const char* source = take(sizeof(T)))
+					std::memcpy(&value, source, sizeof(T));
+				return value;
+			}
+
+			// Reads an array written by BufferedWriter::writeArray, the elements are copied out of the map
+			template <typename T>
+			std::vector<T> readArray()
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "only plain values can be read");
+				auto count = read<std::uint64_t>();
+
+				std::vector<T> values;
+				if (failed || count > static_cast<std::uint64_t>(end - cursor) / sizeof(T))
+				{
+					failed = true;
+					return values;
+				}
+
+				values.resize(count);
+				std::memcpy(values.data(), take(count * sizeof(T)), count * sizeof(T));
+				return values;
+			}
+	};
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+namespace Renderer
+{
+	// Vector of trivially copyable values that keeps up to N of them inline. Only a longer one goes to the heap, so
+	// building, copying and moving a short one never allocates
+	template <typename T, std::uint32_t N>
+	class InlineVector
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "InlineVector copies its values as raw memory");
+
+		private:
+			T inlineValues[N];
+			std::unique_ptr<T[]> heapValues;
+			std::uint32_t count{0};
+			std::uint32_t capacity{N};
+
+			T* storage() { return heapValues ? heapValues.get() : inlineValues; }
+			[[nodiscard]] const T* storage() const { return heapValues ? heapValues.get() : inlineValues; }
+
+			void grow(std::uint32_t minimum)
+			{
+				std::uint32_t newCapacity = std::max(minimum, 2 * capacity);
+				std::unique_ptr<T[]> values(new T[newCapacity]);
+				std::copy(begin(), end(), values.get());
+
+				heapValues = std::move(values);
+				capacity = newCapacity;
+			}
+
+		public:
+			InlineVector() = default;
+
+			InlineVector(const InlineVector& other) { assign(other.begin(), other.end()); }
+
+			InlineVector(InlineVector&& other) noexcept { *this = std::move(other); }
+
+			InlineVector& operator = (const InlineVector& other)
+			{
+				if (this != &other)
+					assign(other.begin(), other.end());
+
+				return *this;
+			}
+
+			InlineVector& operator = (InlineVector&& other) noexcept
+			{
+				if (this == &other)
+					return *this;
+
+				if (other.heapValues)
+				{
+					heapValues = std::move(other.heapValues);
+					capacity = other.capacity;
+				}
+				else
+				{
+					heapValues.reset();
+					capacity = N;
+					std::copy(other.inlineValues, other.inlineValues + other.count, inlineValues);
+				}
+
+				count = other.count;
+				other.count = 0;
+				other.capacity = N;
+
+				return *this;
+			}
+
+			template <typename Iterator>
+			void assign(Iterator first, Iterator last)
+			{
+				auto size = static_cast<std::uint32_t>(std::distance(first, last));
+
+				count = 0;
+				if (size > capacity)
+					grow(size);
+
+				std::copy(first, last, storage());
+				count = size;
+			}
+
+			void push_back(const T& value)
+			{
+				if (count == capacity)
+					grow(count + 1);
+
+				storage()[count++] = value;
+			}
+
+			void emplace_back(const T& value) { push_back(value); }
+
+			void clear() { count = 0; }
+
+			T* begin() { return storage(); }
+			T* end() { return storage() + count; }
+			[[nodiscard]] const T* begin() const { return storage(); }
+			[[nodiscard]] const T* end() const { return storage() + count; }
+
+			T& operator [] (size_t i) { return storage()[i]; }
+			const T& operator [] (size_t i) const { return storage()[i]; }
+
+			T& front() { return storage()[0]; }
+			T& back() { return storage()[count - 1]; }
+			[[nodiscard]] const T& front() const { return storage()[0]; }
+			[[nodiscard]] const T& back() const { return storage()[count - 1]; }
+
+			[[nodiscard]] size_t size() const { return count; }
+			[[nodiscard]] bool empty() const { return count == 0; }
+	};
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Renderer
+{
+	// Content-addressed store of preprocessed models. A mesh entry is keyed by the bytes of its OBJ file, a sphere
+	// mesh entry by the mesh geometry and the initialisation settings: an edited model or different settings just
+	// miss, an entry is never stale. Entries are written atomically, deleting the directory is always safe
+	class PreprocessCache
+	{
+		private:
+			std::string directory;
+
+		public:
+			bool enabled{true};
+
+			explicit PreprocessCache(std::string directory = ".preprocessed");
+
+			[[nodiscard]] const std::string& getDirectory() const { return directory; }
+
+			// Empty when the cache is disabled or the file can't be read. A spatially ordered mesh has its own entry
+			[[nodiscard]] std::string meshEntry(const std::string& objPath, bool spatialOrder = false) const;
+			[[nodiscard]] std::string sphereMeshEntry(std::uint64_t key) const;
+	};
+}
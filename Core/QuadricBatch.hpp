@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Math.hpp>
+#include <Vector4.hpp>
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+namespace Renderer
+{
+	class Quadric;
+
+	// Candidate collapses solved together: every candidate is the sum of two sphere quadrics, minimized within its
+	// radius bounds as Quadric::getMinimumAndMinimizer does (Quadric3 solve when the radius is out of bounds). The
+	// quadrics are stored field by field, so that the AVX backend of Math/SIMD.hpp solves four candidates at a time;
+	// solveScalar runs the same code one candidate at a time and is the reference the vector version is checked
+	// against (quadric_bench). A is symmetric, only its upper triangle is stored
+	class QuadricBatch
+	{
+		public:
+			// A (upper triangle, row by row), b and c
+			static constexpr int FIELDS = 15;
+
+		private:
+			std::vector<Math::Scalar> first[FIELDS];
+			std::vector<Math::Scalar> second[FIELDS];
+			std::vector<Math::Scalar> minimumRadius, maximumRadius;
+
+			std::vector<Math::Scalar> sum[FIELDS];
+			std::vector<Math::Scalar> minimizer[4];
+			std::vector<Math::Scalar> cost;
+
+			void resizeResults();
+
+			template <typename Lanes>
+			void solveRange(size_t begin, size_t end);
+
+		public:
+			void clear();
+			[[nodiscard]] size_t size() const { return minimumRadius.size(); }
+
+			// Index of the candidate, the radius bounds are those of Quadric::getMinimumAndMinimizer
+			size_t add(const Quadric& a, const Quadric& b, Math::Scalar maximum = DBL_MAX, Math::Scalar minimum = 0.01);
+
+			void solve();
+			void solveScalar();
+
+			[[nodiscard]] Quadric getSum(size_t i) const;
+			[[nodiscard]] Math::Vector4 getMinimizer(size_t i) const;
+			[[nodiscard]] Math::Scalar getCost(size_t i) const { return cost[i]; }
+	};
+}
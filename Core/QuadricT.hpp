@@ -0,0 +1,179 @@
+#pragma once
+
+#include <Quadric.hpp>
+
+#include <cmath>
+#include <limits>
+
+namespace Renderer
+{
+	// Sphere quadric on a plain scalar type, used to evaluate candidate collapses in float while the quadrics kept on
+	// the spheres, and the solve of the collapses actually executed, stay in Math::Scalar.
+	//
+	// Only this kernel is templated: Vector3/4, Matrix4, Quadric and the collapse structures (EdgeCollapse,
+	// TimedSphere, the queue) keep Math::Scalar, so the stored state doesn't shrink in float. Templating them would
+	// reach through the whole Math library and the renderer, which share Math::Scalar.
+	//
+	// A is symmetric, only its upper triangle is stored. The quadric can be re-centered on an origin sphere before the
+	// conversion: Q(o + d) = d'Ad + (2Ao + b)'d + Q(o), so that the constant term doesn't dwarf the cost in float.
+	template <typename T>
+	class QuadricT
+	{
+		private:
+			static constexpr int index(int i, int j)
+			{
+				return i <= j ? i * 4 - i * (i - 1) / 2 + (j - i) : j * 4 - j * (j - 1) / 2 + (i - j);
+			}
+
+			// Gaussian elimination with partial pivoting on the leading n x n block, x is overwritten with the solution
+			static bool solve(T M[4][4], T x[4], int n)
+			{
+				T scale = 0;
+				for (int i = 0; i < n; i++)
+					for (int j = 0; j < n; j++)
+						scale = std::max(scale, std::abs(M[i][j]));
+
+				const T tolerance = scale * std::numeric_limits<T>::epsilon();
+
+				for (int k = 0; k < n; k++)
+				{
+					int pivot = k;
+					for (int i = k + 1; i < n; i++)
+						if (std::abs(M[i][k]) > std::abs(M[pivot][k]))
+							pivot = i;
+
+					if (std::abs(M[pivot][k]) <= tolerance)
+						return false;
+
+					if (pivot != k)
+					{
+						for (int j = 0; j < n; j++)
+							std::swap(M[k][j], M[pivot][j]);
+						std::swap(x[k], x[pivot]);
+					}
+
+					for (int i = k + 1; i < n; i++)
+					{
+						T f = M[i][k] / M[k][k];
+						for (int j = k; j < n; j++)
+							M[i][j] -= f * M[k][j];
+						x[i] -= f * x[k];
+					}
+				}
+
+				for (int k = n - 1; k >= 0; k--)
+				{
+					for (int j = k + 1; j < n; j++)
+						x[k] -= M[k][j] * x[j];
+					x[k] /= M[k][k];
+				}
+
+				return true;
+			}
+
+			// Same as Quadric3: the radius is fixed and only the center is solved for
+			void constrainedMinimizer(T radius, T result[4]) const
+			{
+				T M[4][4];
+				T x[4];
+
+				for (int i = 0; i < 3; i++)
+				{
+					for (int j = 0; j < 3; j++)
+						M[i][j] = A[index(i, j)];
+
+					x[i] = -(b[i] + 2 * radius * A[index(3, i)]) / 2;
+				}
+
+				if (!solve(M, x, 3))
+					x[0] = x[1] = x[2] = 0;
+
+				result[0] = x[0];
+				result[1] = x[1];
+				result[2] = x[2];
+				result[3] = radius;
+			}
+
+		public:
+			T A[10]{};
+			T b[4]{};
+			T c{0};
+
+			QuadricT() = default;
+
+			explicit QuadricT(const Quadric& q, const Math::Vector4& origin = Math::Vector4(0, 0, 0, 0))
+			{
+				Math::Scalar o[4] = {origin.coordinates.x, origin.coordinates.y, origin.coordinates.z, origin.coordinates.w};
+				Math::Scalar qb[4] = {q.b.coordinates.x, q.b.coordinates.y, q.b.coordinates.z, q.b.coordinates.w};
+
+				Math::Scalar shiftedC = q.c;
+
+				for (int i = 0; i < 4; i++)
+				{
+					Math::Scalar Ao = 0;
+					for (int j = 0; j < 4; j++)
+						Ao += q.A.data[i * 4 + j] * o[j];
+
+					b[i] = static_cast<T>(2 * Ao + qb[i]);
+					shiftedC += o[i] * Ao + qb[i] * o[i];
+
+					for (int j = i; j < 4; j++)
+						A[index(i, j)] = static_cast<T>(q.A.data[i * 4 + j]);
+				}
+
+				c = static_cast<T>(shiftedC);
+			}
+
+			void operator += (const QuadricT& other)
+			{
+				for (int i = 0; i < 10; i++)
+					A[i] += other.A[i];
+				for (int i = 0; i < 4; i++)
+					b[i] += other.b[i];
+				c += other.c;
+			}
+
+			T evaluateSQEM(const T s[4]) const
+			{
+				T result = c;
+
+				for (int i = 0; i < 4; i++)
+				{
+					T As = 0;
+					for (int j = 0; j < 4; j++)
+						As += A[index(i, j)] * s[j];
+
+					result += s[i] * As + b[i] * s[i];
+				}
+
+				return result;
+			}
+
+			// Mirrors Quadric::getMinimumAndMinimizer, radii are relative to the origin the quadric was built around.
+			// Returns false when A is singular at this precision, the caller is expected to fall back to Quadric
+			bool getMinimumAndMinimizer(T& min, T minimizer[4], T maximumRadius = std::numeric_limits<T>::max(),
+										T minimumRadius = static_cast<T>(0.01)) const
+			{
+				T M[4][4];
+
+				for (int i = 0; i < 4; i++)
+				{
+					for (int j = 0; j < 4; j++)
+						M[i][j] = A[index(i, j)];
+
+					minimizer[i] = -b[i] / 2;
+				}
+
+				if (!solve(M, minimizer, 4))
+					return false;
+
+				if (minimizer[3] < minimumRadius)
+					constrainedMinimizer(minimumRadius, minimizer);
+				else if (minimizer[3] > maximumRadius)
+					constrainedMinimizer(maximumRadius, minimizer);
+
+				min = evaluateSQEM(minimizer);
+				return true;
+			}
+	};
+}
@@ -27,7 +27,6 @@ namespace Renderer {
             void generateUUID();
         
         public:
-            set_of_int vertices;
 			set_of_int neighbourSpheres;
         
             Math::Scalar quadricWeights{};
@@ -41,15 +40,15 @@ namespace Renderer {
 
             Sphere();
             Sphere(const Sphere& sphere);
-            Sphere(Vertex& vertex, int vertexIdx, Math::Scalar targetSphereRadius);
+            Sphere(const Vertex& vertex, Math::Scalar targetSphereRadius);
             Sphere(const Math::Vector3& center, Math::Scalar radius);
         
-			void init(Vertex& vertex, int vertexIdx, Math::Scalar targetSphereRadius);
-			void initTHIERY(Vertex& vertex);
-            void addVertex(Vertex& vertex, int index);
+			void init(const Vertex& vertex, Math::Scalar targetSphereRadius);
+			void initTHIERY(const Vertex& vertex);
 			void addNeighbourSphere(int sphereIndex);
         
             [[nodiscard]] int getID() const;
+			void setID(int id); // Only to restore a saved sphere, the mapper and the vertices refer to it by id
 
             [[nodiscard]] Sphere lerp(const Sphere &s, Math::Scalar t) const;
             bool containsVertex(const Math::Vector3& vertex);
@@ -8,7 +8,10 @@
 #include <Vector4.hpp>
 
 #include <TriMesh.hpp>
+#include <PreprocessCache.hpp>
 #include <Quadric.hpp>
+#include <QuadricT.hpp>
+#include <QuadricBatch.hpp>
 #include <Region.hpp>
 #include <EdgeCollapse.hpp>
 #include <TimedSphere.hpp>
@@ -52,6 +55,46 @@ namespace Renderer
 			
 			int performedOperations{0};
 			int numberOfActiveSpheres {0};
+			
+			Math::Scalar lastCollapseCost{0};
+			long long solvedCollapses{0};
+			
+			// Bound over which pairs were left out of the initial queue, DBL_MAX when none are missing
+			Math::Scalar prunedCost{DBL_MAX};
+			
+			// Per sphere state read on every queue pop, packed apart from the spheres themselves (same indices as
+			// timedSpheres): the union-find link to the sphere it was merged into (itself while active, -1 once
+			// removed), the operation that last changed it and the lower bound of its quadric
+			std::vector<int> aliases;
+			std::vector<int> timestamps;
+			std::vector<QuadricBound> quadricBounds;
+			
+			// Sphere every vertex was first given to, the one it belongs to now is alias(vertexOwners[v]): a merge
+			// moves no vertex
+			std::vector<int> vertexOwners;
+			
+			// Spheres no collapse may take (same indices as timedSpheres), only set while a chunk of the chunked
+			// simplification is collapsed: the spheres shared with other chunks stay as they are until the stitch
+			std::vector<std::uint8_t> lockedSpheres;
+			[[nodiscard]] bool isLocked(int i) const { return !lockedSpheres.empty() && lockedSpheres[i] != 0; }
+			
+			// Kept between edits, so that an edit only visits the neighbourhood of its sphere: the faces around every
+			// vertex (CSR, built on the first edit) and the vertices of every sphere as of operation, built again
+			// once anything else has changed the spheres
+			struct EditState
+			{
+				std::vector<int> faceOffsets;
+				std::vector<int> faces;
+				std::vector<std::vector<int>> sphereVertices;
+				int operation{-1};
+			};
+			EditState editState;
+			
+			void prepareEditState();
+			// Quadric of the sphere vertex v started as, normalized as initializeFromReferenceMesh leaves it
+			Quadric initialVertexQuadric(int v) const;
+			// Same, on other positions and normals of the vertices (a pose) but the same faces
+			Quadric initialVertexQuadric(const std::vector<Vertex>& vertices, int v) const;
             
             std::unordered_set<Triangle> triangle;
             std::unordered_set<Edge> edge;
@@ -73,10 +116,36 @@ namespace Renderer
             void initializeSpheres(std::vector<Vertex>& vertices, Math::Scalar initialRadius);
             
             void computeSpheresProperties(const std::vector<Vertex>& vertices, const std::vector<Face>& faces);
+			Quadric faceQuadric(const std::vector<Vertex>& vertices, const Face& face, Math::Scalar sigma,
+			                    Math::Scalar& weight) const;
             void updateSpheres();
-            void initializeEdgeQueue();
+			
+			// Everything up to the edge queue: one sphere per vertex with its quadric, and the neighbourhoods
+			void initializeFromReferenceMesh();
+			
+			// Same, through the chunked simplification (see CHUNK_VERTICES): the spheres are those left by the chunk
+			// passes. False if a chunk could not go through the disk, nothing is initialized then
+			bool initializeFromChunks();
+			
+			// Sphere mesh of one chunk: a submesh of the parent with its settings and bounding box diagonal, the
+			// locked spheres are left out of every collapse
+			SphereMesh(TriMesh* chunk, const SphereMesh& parent, std::vector<std::uint8_t> locked);
+			
+			// solved receives (center, radius, cost) of every initial collapse, cached provides them instead of
+			// solving; both follow the order in which the neighbour pairs are visited
+			void initializeEdgeQueue(std::vector<Math::Scalar>* solved, const std::vector<Math::Scalar>* cached);
+			
+			[[nodiscard]] std::uint64_t preprocessedKey() const;
+			bool loadPreprocessed(const std::string& entry);
+			void savePreprocessed(const std::string& entry, const std::vector<Math::Scalar>& solutions) const;
 			
 			void updateConnectivityAfterCollapses();
+			std::vector<int> exportIndices();
+			// Triangles and edges as exported indices, without the ones that touch a removed sphere
+			void exportConnectivity(std::vector<std::int32_t>& triangles, std::vector<std::int32_t>& edges);
+			
+			std::vector<Math::Vector4> fitPose(const std::vector<Math::Vector3>& positions,
+			                                   const std::vector<int>& spheres) const;
             
             void drawSpheresOverEdge(const Edge &e, int nSpheres = 4, Math::Scalar rescaleRadii = 1.0, Math::Scalar minRadiiScale = 0.3);
             void drawSpheresOverTriangle(const Triangle& t, int nSpheres = 4, Math::Scalar size = 1.0, Math::Scalar minRadiiScale = 0.3);
@@ -92,18 +161,39 @@ namespace Renderer
         
             void renderSphere(const Math::Vector3& center, Math::Scalar radius, const Math::Vector3& color);
 			
-			void updateNeighborsOf(Sphere& s);
+			int addTimedSphere(const Sphere& sphere, int aliasID, int timestamp);
+			void clearTimedSpheres(size_t capacity = 0);
+			
+			void updateNeighborsOf(int sphereIndex);
+			void flattenAliases();
 		
 			bool engulfsAnything(EdgeCollapse& e);
+			int mergeSpheres(const EdgeCollapse& e, int timestamp);
+			std::vector<int> executeConcurrently(std::vector<EdgeCollapse>& accepted);
 			void execute(const EdgeCollapse& e);
+			bool collapseUntil(int n, Math::Scalar maxCost);
+			void saveCheckpointIfDue(std::chrono::steady_clock::time_point& lastCheckpoint) const;
 			void addPotentialCollapse(int i, int j);
+			void updateQuadricBound(int sphereIndex);
+			[[nodiscard]] Math::Scalar collapseCostBound(int i, int j) const;
 			
 			bool isOutOfDate(const EdgeCollapse& e);
+			void gatherCollapse(EdgeCollapse& e);
+			Math::Scalar maximumRadius(const EdgeCollapse& e);
 			void updateCost(EdgeCollapse& e);
+			void solveCollapse(EdgeCollapse& e, bool lowPrecision);
+			// Candidates solved together by one thread, small enough for the block to stay in cache
+			static constexpr size_t CANDIDATE_BLOCK = 256;
+			void solveCandidates(std::vector<EdgeCollapse>& candidates, size_t first = 0);
+			void solveCandidateBatch(std::vector<EdgeCollapse>& candidates, size_t first, size_t last,
+			                         QuadricBatch& batch);
+			void rebuildEdgeQueue();
+			void restorePrunedCandidates();
 			
 			bool debugCheckNoLoops(); // Check that in the graphs there are no loops
 			
 			void extendSpheresNeighboursOneStep();
+			void buildNeighbourhoods();
 			
 		    // ONLY FOR IMPLEMENTATION OF THIERY-ET-AL-2013
 		    static bool normalTest(const Vertex& v, const Vertex& v1);
@@ -113,13 +203,96 @@ namespace Renderer
             std::vector<TimedSphere> timedSpheres;
 			
 			bool IMPLEMENT_THIERY_2013{false};
+			
+			// Rank the candidate collapses with float quadric solves (QuadricT<float>), executed collapses are still
+			// solved in double and the quadrics, spheres and queue entries stay in Math::Scalar
+			bool FLOAT_CANDIDATE_COSTS{false};
+			
+			// Weight of the principal curvatures in the sphere quadrics, 0 skips the curvature computation altogether
+			Math::Scalar CURVATURE_SIGMA{1.0};
+			
+			// Initial neighbourhoods: rings of the mesh adjacency around every vertex, optionally cut at a distance
+			// relative to the bounding box diagonal (0 for no cut). 0 rings keeps the 1-ring extended twice
+			int NEIGHBOURHOOD_RINGS{0};
+			Math::Scalar NEIGHBOURHOOD_RADIUS{0};
+			
+			// Initial pairs whose cost bound is over this error (relative to the bounding box diagonal) are only queued
+			// once the greedy pass gets there, 0 queues them all
+			Math::Scalar CANDIDATE_PRUNE_ERROR{0};
+			
+			// While CHECKPOINT_PATH is set, the greedy and batched collapses save a checkpoint there every
+			// CHECKPOINT_INTERVAL seconds (the batched one between batches). The multiple-choice scheduler ignores it
+			// with a warning: its random state is not part of a checkpoint
+			std::string CHECKPOINT_PATH;
+			Math::Scalar CHECKPOINT_INTERVAL{600};
+			
+			// Collapses around a merged sphere are queued with a lower bound of their cost and only solved when they
+			// reach the top of the queue
+			bool LAZY_COLLAPSE_COSTS{true};
+			
+			// Multiple-choice scheduler: candidates drawn for every proposed collapse, and largest share of the active
+			// spheres a single round may collapse
+			int MULTIPLE_CHOICE_SAMPLES{8};
+			Math::Scalar MULTIPLE_CHOICE_ROUND_FRACTION{1.0 / 32};
+			
+			// Batched scheduler: most collapses executed together, and how much more than the cheapest one of a batch
+			// (as a distance relative to the bounding box diagonal) the others may cost
+			int BATCH_SIZE{64};
+			Math::Scalar BATCH_COST_SLACK{0.001};
+			
+			// Chunked simplification, for meshes whose per vertex spheres don't fit in memory. With CHUNK_VERTICES set,
+			// the spheres are built by splitting the mesh in space into chunks of about that many vertices; the chunks
+			// are simplified in parallel down to CHUNK_SPHERE_FRACTION of their spheres, without touching the ones
+			// they share with other chunks, and written to CHUNK_DIRECTORY (the temporary directory when empty). The
+			// sphere mesh is stitched from those files, the collapses that follow are the global pass.
+			// Only the per vertex spheres, neighbourhoods and queue are bounded by the chunk size: the reference mesh
+			// (with its curvatures) and a few per vertex and per face index arrays stay in memory, so the peak is
+			// about the mesh plus CHUNK_THREADS chunks (all OpenMP threads when 0) being simplified at once
+			int CHUNK_VERTICES{0};
+			Math::Scalar CHUNK_SPHERE_FRACTION{0.1};
+			std::string CHUNK_DIRECTORY;
+			int CHUNK_THREADS{0};
+			
+			// Refinement pass (refineSpheres): weight of the current sphere in its fit, relative to the area of its
+			// vertices, so that a sphere only reached through small barycentric weights doesn't move far to close
+			// their distances
+			Math::Scalar REFINEMENT_DAMPING{0.01};
 		
 			int alias(int alias);
 			Sphere& currentSphere(int id) { return timedSpheres[alias(id)].sphere; }
 			bool isTimedSphereAlive(int id);
+			[[nodiscard]] bool isTimedSphereRemoved(int id) const { return aliases[id] < 0; }
+			
+			// Copy of the spheres and of their packed state, enough for the editor to undo an edit
+			struct Snapshot
+			{
+				std::vector<TimedSphere> spheres;
+				std::vector<int> aliases;
+				std::vector<int> timestamps;
+				std::vector<QuadricBound> quadricBounds;
+				std::vector<int> vertexOwners;
+			};
+			
+			[[nodiscard]] Snapshot snapshot() const;
+			// The collapse queue is solved again before the next collapse, its entries may refer to the undone state
+			void restore(const Snapshot& snapshot);
+			
+			// Brings everything downstream of a sphere moved or resized in the editor up to date, visiting only its
+			// neighbourhood. The vertices of the sphere and of its neighbours go to the nearest of these spheres; the
+			// ones that got other vertices get the quadric of those, are solved again (all but the edited sphere,
+			// which stays where it was put) and have their collapses queued again. Their triangles, edges and neighbour
+			// links are those of the faces around their vertices
+			void updateAfterEdit(int sphereID);
         
             SphereMesh(const SphereMesh& sm);
             SphereMesh(TriMesh* mesh, Shader* shader, Math::Scalar vertexSphereRadius = 0.1f);
+			// Only binds the mesh, the spheres are built by the first resetSphereMesh: settings such as
+			// CHUNK_VERTICES apply before any per vertex state exists
+			struct Deferred {};
+			SphereMesh(TriMesh* mesh, Shader* shader, Deferred);
+			// Starts from the preprocessed state (sphere quadrics, neighbourhoods and initial collapse costs) of a
+			// previous open of the same mesh with the same settings, and records it on a miss
+			SphereMesh(TriMesh* mesh, Shader* shader, const PreprocessCache& cache);
         
             SphereMesh& operator = (const SphereMesh& sm);
         
@@ -127,6 +300,9 @@ namespace Renderer
             [[nodiscard]] int getRenderCalls() const;
             int getTriangleSize();
             int getEdgeSize();
+			
+			[[nodiscard]] const std::unordered_set<Triangle>& getTriangles() const { return triangle; }
+			[[nodiscard]] const std::unordered_set<Edge>& getEdges() const { return edge; }
         
             void resetRenderCalls();
         
@@ -140,18 +316,78 @@ namespace Renderer
             void renderConnectivity(int spheresPerEdge, Math::Scalar sphereSize);
         
             void renderSphereVertices(int i);
+			
+			// Vertices of every sphere, recovered from the owners with a counting sort: those of sphere i are
+			// sphereVertices[vertexOffsets[i]] to sphereVertices[vertexOffsets[i + 1] - 1], in increasing order.
+			// Merged and removed spheres have none
+			void gatherSphereVertices(std::vector<int>& vertexOffsets, std::vector<int>& sphereVertices);
+			std::vector<int> getSphereVertices(int sphereIndex);
             
             int collapse(int sphereIndexA, int sphereIndexB);
+			
+            void initializeEdgeQueue();
             
             bool collapseSphereMesh();
             bool collapseSphereMesh(int n);
 			
+			// Collapses as long as the cheapest collapse stays under maxError (relative to the bounding box diagonal),
+			// never going below n spheres. Returns true if it stopped because of the error bound or of n
+			bool collapseSphereMeshUnderError(Math::Scalar maxError, int n = 1);
+			[[nodiscard]] Math::Scalar getLastCollapseError() const;
+			
+			// Randomized alternative to the greedy queue (Wu and Kobbelt, multiple-choice simplification): candidates
+			// are sampled and solved in parallel, the best independent ones are collapsed concurrently. The result
+			// only depends on the seed
+			bool collapseSphereMeshMultipleChoice(int n, unsigned int seed = 42);
+			
+			// Greedy order, but the cheapest collapses with disjoint 1-rings are popped and executed together
+			bool collapseSphereMeshBatched(int n);
+			
+			// Animation sequences: the sphere mesh of the reference pose refitted to other poses of the same mesh (same
+			// vertices and faces, a pose is the list of vertex positions in the order of the OBJ file). Every sphere
+			// keeps its vertices, only center and radius change; the poses are refitted in parallel. A pose of the
+			// wrong size gets no spheres
+			std::vector<std::vector<Math::Vector4>> refitToPoses(const std::vector<std::vector<Math::Vector3>>& poses);
+			void saveSequenceTXT(const std::string& path, const std::string& fileName,
+			                     const std::vector<std::vector<Math::Vector4>>& poses);
+			
+			// Refinement after the collapses, the fitting stage of Thiery et al.: every vertex of the input goes to the
+			// closest primitive of the envelope (sphere, edge capsule or triangle slab), then every sphere takes the
+			// center and radius that best fit the distances of the vertices on its primitives, weighted by the area
+			// around them. The spheres are solved in parallel, the vertices are assigned in parallel. Stops after
+			// maxIterations, or once an iteration lowers the mean squared distance by less than threshold (relative)
+			// or not at all. Only centers and radii change, a later collapse starts again from the quadrics
+			struct RefinementIteration
+			{
+				// Area weighted RMS distance of the vertices to the envelope, relative to the bounding box diagonal
+				Math::Scalar energy{0};
+				// Share of the way to the solved spheres the iteration went, 0 for the starting state
+				Math::Scalar step{0};
+				double seconds{0};
+			};
+			std::vector<RefinementIteration> refineSpheres(int maxIterations = 20, Math::Scalar threshold = 1e-3);
+			
+			// Complete state of an ongoing simplification. Collapsing a loaded checkpoint to the same target gives the
+			// same sphere mesh as the run that saved it
+			bool saveCheckpoint(const std::string& path) const;
+			bool loadCheckpoint(const std::string& path);
+			
+			// Entries in the collapse queue, stale ones included
+			[[nodiscard]] int getQueueSize();
+			
+			// Quadric solves since construction, candidates included
+			[[nodiscard]] long long getSolvedCollapses() const;
+			
+			// Sum over the active spheres of their quadric evaluated at the sphere itself
+			[[nodiscard]] Math::Scalar getQuadricError() const;
+			
 			[[nodiscard]] int getTimedSphereSize() const;
         
             void loadFromYaml(const std::string& path);
         
             void saveYAML(const std::string& path = ".", const std::string& fileName = "SphereMesh.yaml");
             void saveTXT(const std::string& path = ".", const std::string& fileName = "SphereMesh.txt");
+			void savePLY(const std::string& path = ".", const std::string& fileName = "SphereMesh.ply");
             void saveTXTToAutoPath();
         
             void addEdge(int selectedSphereID);
@@ -163,7 +399,8 @@ namespace Renderer
             void clear();
     };
 	
-	inline bool includes(std::vector<int>& A, int B)
+	template <typename Container>
+	inline bool includes(const Container& A, int B)
 	{
 		return std::find(A.begin(), A.end(), B) != A.end();
 	}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Vector3.hpp>
+#include <Vector4.hpp>
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+namespace Renderer
+{
+	class SphereMesh;
+
+	// One piece of the sphere-mesh envelope: a sphere (count = 1), the capsule swept along an edge (count = 2) or the
+	// slab swept over a triangle (count = 3), with the centers and radii of its spheres copied in
+	struct EnvelopePrimitive
+	{
+		int count{0};
+		int spheres[3]{-1, -1, -1};
+		Math::Vector3 centers[3];
+		Math::Scalar radii[3]{0, 0, 0};
+
+		Math::Vector3 boxMin;
+		Math::Vector3 boxMax;
+	};
+
+	// Closest point of the envelope to a query: the signed distance (exact outside the envelope, a lower bound of
+	// the depth inside), the primitive it lies on and the barycentric weights of its spheres
+	struct EnvelopeHit
+	{
+		Math::Scalar distance{0};
+		int primitive{-1};
+		Math::Scalar weights[3]{0, 0, 0};
+	};
+
+	// Ray with a unit direction, hits further than maxDistance are ignored
+	struct Ray
+	{
+		Math::Vector3 origin;
+		Math::Vector3 direction;
+		Math::Scalar maxDistance{DBL_MAX};
+	};
+	
+	// First point of the envelope along a ray, distance 0 when the origin is inside. primitive is -1 on a miss
+	struct RayHit
+	{
+		Math::Scalar distance{DBL_MAX};
+		int primitive{-1};
+	};
+	
+	// Queries over the envelope of a sphere mesh: closest point, first hit along a ray and overlap with a sphere. The
+	// single queries are const and can run concurrently, the batched ones split their queries over the OpenMP threads
+	class SphereMeshBVH
+	{
+		private:
+			struct Node
+			{
+				Math::Vector3 boxMin;
+				Math::Vector3 boxMax;
+				Math::Scalar maxRadius{0};
+				int left{-1};
+				int right{-1};
+				int first{0};
+				int count{0};
+			};
+
+			static constexpr int LEAF_SIZE = 4;
+			
+			// Sphere tracing along capsules and slabs: most steps, and the distance (relative to the largest radius
+			// of the primitive) at which a ray counts as on the surface. A ray still short of the surface after
+			// those steps is grazing it, the rest of its interval is searched in RAY_SEARCH_STEPS ternary steps for
+			// a point on the surface, then as many bisections for the first one
+			static constexpr int RAY_STEPS = 64;
+			static constexpr Math::Scalar RAY_EPSILON = 1e-4;
+			static constexpr int RAY_SEARCH_STEPS = 64;
+
+			std::vector<Node> nodes;
+			std::vector<int> order;
+
+			int buildNode(int first, int count);
+
+		public:
+			std::vector<EnvelopePrimitive> primitives;
+
+			void build(SphereMesh& sm);
+			void build(const std::vector<EnvelopePrimitive>& envelope);
+
+			[[nodiscard]] bool empty() const;
+			[[nodiscard]] EnvelopeHit closest(const Math::Vector3& p) const;
+			[[nodiscard]] RayHit raycast(const Ray& ray) const;
+			
+			// Whether a sphere (center and radius) touches the envelope, and which primitives it touches
+			[[nodiscard]] bool overlaps(const Math::Vector4& sphere) const;
+			void overlapping(const Math::Vector4& sphere, std::vector<int>& touched) const;
+			
+			void closest(const std::vector<Math::Vector3>& points, std::vector<EnvelopeHit>& hits) const;
+			void raycast(const std::vector<Ray>& rays, std::vector<RayHit>& hits) const;
+			void overlaps(const std::vector<Math::Vector4>& spheres, std::vector<std::uint8_t>& results) const;
+
+			static Math::Scalar signedDistance(const EnvelopePrimitive& primitive, const Math::Vector3& p,
+											   Math::Scalar weights[3]);
+
+			static Math::Scalar sphereDistance(const Math::Vector3& c, Math::Scalar r, const Math::Vector3& p);
+			static Math::Scalar coneDistance(const Math::Vector3& c0, Math::Scalar r0, const Math::Vector3& c1,
+											 Math::Scalar r1, const Math::Vector3& p, Math::Scalar& t);
+			static Math::Scalar slabDistance(const EnvelopePrimitive& primitive, const Math::Vector3& p,
+											 Math::Scalar weights[3]);
+			
+			// Distance along the ray to one primitive, DBL_MAX when it misses
+			static Math::Scalar rayDistance(const EnvelopePrimitive& primitive, const Ray& ray);
+	};
+}
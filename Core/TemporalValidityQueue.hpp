@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <queue>
 #include <vector>
@@ -17,7 +18,24 @@ namespace Renderer
 	class TemporalValidityQueue
 	{
 		private:
-			std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<>> q;
+			// The underlying container is exposed so that a checkpoint restores the heap exactly as it was, ties included
+			class Heap : public std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<>>
+			{
+				public:
+					std::vector<EdgeCollapse>& entries() { return c; }
+					[[nodiscard]] const std::vector<EdgeCollapse>& entries() const { return c; }
+					
+					// Same as top() followed by pop(), but the entry is moved out instead of copied
+					EdgeCollapse extract()
+					{
+						std::pop_heap(c.begin(), c.end(), comp);
+						EdgeCollapse e = std::move(c.back());
+						c.pop_back();
+						return e;
+					}
+			};
+			
+			Heap q;
 			
 			std::vector<TimedSphere>* spheres;
 			std::unordered_map<int, int>* sphereMapper;
@@ -29,7 +47,10 @@ namespace Renderer
 			explicit TemporalValidityQueue(std::vector<TimedSphere>& spheres, std::unordered_map<int, int>& sphereMapper);
 		
 			void push(const EdgeCollapse& collapsableEdge);
-			EdgeCollapse top();
+			void push(EdgeCollapse&& collapsableEdge);
+			[[nodiscard]] const EdgeCollapse& top() const;
+			EdgeCollapse extractTop();
+			[[nodiscard]] Math::Scalar topCost() const;
 			
 			void pop();
 		
@@ -37,6 +58,10 @@ namespace Renderer
 			void setQueueDirty();
 		
 			void clear();
+			
+			// Entries in heap order, assign() takes them back as they are
+			[[nodiscard]] const std::vector<EdgeCollapse>& entries() const;
+			void assign(std::vector<EdgeCollapse> heapEntries);
 			bool empty();
 		
 			int size();
@@ -12,15 +12,24 @@ namespace Renderer
 {
 	class Sphere;
 	
+	// Lower bound of a sphere quadric, q(x) >= minimumError + minimumCurvature * |x - minimizer|^2, which bounds from
+	// below the cost of any collapse involving the sphere
+	struct QuadricBound
+	{
+		Math::Vector4 minimizer;
+		Math::Scalar minimumError{0};
+		Math::Scalar minimumCurvature{0};
+	};
+	
+	// Only the sphere itself: its alias, timestamp and quadric bound are read on every queue pop and are packed in
+	// their own arrays in the SphereMesh
 	class TimedSphere {
 		public:
 			Sphere sphere;
-			int timestamp;
-			int alias;
 			
 			TimedSphere(const TimedSphere& other);
-			explicit TimedSphere(const Sphere& sphere, int alias, int timestamp);
+			explicit TimedSphere(const Sphere& sphere);
 			
-			bool operator == (const TimedSphere& rhs) const;
+			TimedSphere& operator = (const TimedSphere& other) = default;
 	};
 }
@@ -9,6 +9,7 @@
 #define RenderableMesh_h
 
 #include <Shader.hpp>
+#include <PreprocessCache.hpp>
 
 #include <Vector3.hpp>
 #include <Quaternion.hpp>
@@ -16,6 +17,7 @@
 #include <vector>
 #include <string>
 #include <cfloat>
+#include <cstdint>
 
 namespace Renderer {
     struct Face
@@ -33,11 +35,9 @@ namespace Renderer {
         Math::Vector3 color;
         
         Math::Vector2 curvature;
-		
-		int referenceSphere;
 
-        Vertex() : position(Math::Vector3()), normal(Math::Vector3(1, 0, 0)), referenceSphere(-1) {}
-        Vertex(const Math::Vector3& p, const Math::Vector3& n) : position(p), normal(n), referenceSphere(-1) {}
+        Vertex() : position(Math::Vector3()), normal(Math::Vector3(1, 0, 0)) {}
+        Vertex(const Math::Vector3& p, const Math::Vector3& n) : position(p), normal(n) {}
     };
 
     struct AABB
@@ -73,11 +73,27 @@ namespace Renderer {
         
             GLuint VAO, VBO, EBO;
         
+            // Per-draw material colors, passed as uniforms: the vertex buffer only holds positions and normals
+            Math::Vector3 fillColor = Math::Vector3(1, 1, 1);
             Math::Vector3 wireframeColor;
             bool wireframeColorSetted = false;
         
+            bool curvatureComputed = false;
+        
+            // Preprocessed entry the mesh was loaded from or saved to, empty when the mesh doesn't go through the cache
+            std::string preprocessedEntry;
+        
+            // Index in the OBJ file of every vertex, empty while the vertices are in file order
+            std::vector<int> fileIndices;
+        
+            bool loadOBJ(const std::string& pathToLoadFrom);
+            void sortSpatially();
+            void finishLoading();
+        
             void setup();
-            void updateGPUVertexData();
+        
+            void setMaterial(const Math::Vector3& ambient);
+            void drawElements();
         
             void updateBBOX();
         
@@ -93,10 +109,15 @@ namespace Renderer {
             Math::Scalar getCotAlpha(Vertex v, Vertex adjVertex);
             Math::Scalar getCotBeta(Vertex v, Vertex adjVertex);
         
-            void computeVerticesCurvatureIGL();
-        
             void computeVerticesCurvature();
         
+            [[nodiscard]] std::string curvatureCachePath() const;
+            bool loadCurvatureCache();
+            void saveCurvatureCache() const;
+        
+            bool loadPreprocessed();
+            void savePreprocessed() const;
+        
         public:
             AABB bbox;
             std::string path;
@@ -108,8 +129,21 @@ namespace Renderer {
             bool isFilled;
             bool isBlended;
         
-            TriMesh(const std::string& pathToLoadFrom, Shader* shader);
+            // Keep the principal curvatures in a sidecar file next to the model (<model>.curvature, <model>.sorted.curvature
+            // for a spatially ordered mesh)
+            bool cacheCurvature{true};
+        
+            // With spatialOrder the vertices are sorted along a Z-order (Morton) curve over the bounding box and the
+            // faces by their first vertex, so vertices close in space are close in memory as well
+            TriMesh(const std::string& pathToLoadFrom, Shader* shader, bool spatialOrder = false);
+            // Positions, normals, colors, faces and (once computed) curvatures come from the cache when the OBJ was
+            // opened before, otherwise the OBJ is parsed and the entry written
+            TriMesh(const std::string& pathToLoadFrom, Shader* shader, const PreprocessCache& cache,
+                    bool spatialOrder = false);
             TriMesh(const std::vector<Vertex>& vertices, const std::vector<Face>& faces, Shader* shader);
+            // Part of another mesh: its vertices at vertexIndices, as they are there (normals and curvatures are not
+            // recomputed), and faces indexing them in that order. Never drawn nor cached
+            TriMesh(const TriMesh& mesh, const std::vector<int>& vertexIndices, const std::vector<Face>& faces);
         
             TriMesh& operator = (const TriMesh& other) {
                 this->vertices = other.vertices;
@@ -123,8 +157,11 @@ namespace Renderer {
                 this->EBO = other.EBO;
                 
                 this->ID = other.ID;
+                this->fillColor = other.fillColor;
+                this->curvatureComputed = other.curvatureComputed;
                 this->isWireframe = other.isWireframe;
                 this->bbox = other.bbox;
+                this->fileIndices = other.fileIndices;
 				
 				return *this;
             }
@@ -136,6 +173,24 @@ namespace Renderer {
 			
 			void updateVertexNormals();
         
+            // Principal curvatures are only needed by the curvature-weighted sphere quadrics, they are computed (or
+            // read back from the cache) on first use
+            void ensureCurvature();
+            void computeVerticesCurvatureIGL();
+            [[nodiscard]] bool hasCurvature() const { return curvatureComputed; }
+        
+            // Files written for or read from outside (YAML sphere meshes, animation poses) index the vertices as the
+            // OBJ file does
+            [[nodiscard]] bool isSpatiallyOrdered() const { return !fileIndices.empty(); }
+            [[nodiscard]] int toFileIndex(int vertexIndex) const
+            {
+                return fileIndices.empty() ? vertexIndex : fileIndices[vertexIndex];
+            }
+            [[nodiscard]] std::vector<int> fileToVertexIndices() const;
+        
+            // FNV-1a hash of positions and faces, identifies the geometry independently of the file it came from
+            [[nodiscard]] std::uint64_t getContentHash() const;
+        
             void scale(const Math::Vector3& scale);
             void translate(const Math::Vector3& translate);
             
@@ -160,6 +215,7 @@ namespace Renderer {
             void setWireframeColor(const Math::Vector3& color);
         
             void render();
+            void renderWithWireframeOverlay(const Math::Vector3& overlayColor);
     };
 }
 
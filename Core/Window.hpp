@@ -7,6 +7,7 @@
 
 #include <TriMesh.hpp>
 #include <Shader.hpp>
+#include <UniformBuffer.hpp>
 #include <Camera.hpp>
 
 #include <SphereMesh.hpp>
@@ -104,6 +105,11 @@ namespace Renderer {
             Renderer::TriMesh* mesh{};
             Renderer::SphereMesh* sm{};
             Renderer::Camera* mainCamera;
+            UniformBuffer cameraUniforms;
+            UniformBuffer lightUniforms;
+            PreprocessCache preprocessCache;
+            // Meshes opened from the editor get their vertices in Morton order, takes effect on the next load
+            bool spatialVertexOrder{false};
             bool commandPressed;
             Math::Scalar lastX, lastY;
         
@@ -117,7 +123,7 @@ namespace Renderer {
             bool renderConnectivity;
             float sphereSize{};
         
-            std::vector<std::vector<TimedSphere>> sphereBuffer;
+            std::vector<SphereMesh::Snapshot> sphereBuffer;
             
             int connectivitySpheresPerEdge;
             Math::Scalar connectivitySpheresSize;
@@ -129,9 +135,9 @@ namespace Renderer {
         
             void renderImGUI();
             void renderMenu();
-            void renderSphereMesh(const Math::Matrix4& perspective);
+            void renderSphereMesh();
         
-            void addSphereVectorToBuffer(const std::vector<TimedSphere>& spheres);
+            void addSphereVectorToBuffer(const SphereMesh::Snapshot& spheres);
             void removeLastSphereVectorFromBuffer();
         
             void displayErrorMessage(const std::string& message);
@@ -0,0 +1,110 @@
+#include <ApproximationError.hpp>
+#include <TriMesh.hpp>
+#include <SphereMesh.hpp>
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace Renderer
+{
+	ApproximationErrorEvaluator::ApproximationErrorEvaluator(const TriMesh& mesh, int surfaceSamples, unsigned int seed)
+	{
+		BDDSize = mesh.bbox.BDD().magnitude();
+		if (BDDSize <= 0)
+			BDDSize = 1;
+
+		samples.reserve(mesh.vertices.size() + surfaceSamples);
+
+		for (const Vertex& v : mesh.vertices)
+			samples.push_back(v.position);
+
+		if (mesh.faces.empty() || surfaceSamples <= 0)
+			return;
+
+		std::vector<Math::Scalar> cumulativeArea(mesh.faces.size());
+		Math::Scalar totalArea = 0;
+
+		for (int f = 0; f < static_cast<int>(mesh.faces.size()); f++)
+		{
+			const Face& face = mesh.faces[f];
+			const Math::Vector3& a = mesh.vertices[face.i].position;
+			const Math::Vector3& b = mesh.vertices[face.j].position;
+			const Math::Vector3& c = mesh.vertices[face.k].position;
+
+			totalArea += Math::Vector3::cross(b - a, c - a).magnitude() / 2;
+			cumulativeArea[f] = totalArea;
+		}
+
+		if (totalArea <= 0)
+			return;
+
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<Math::Scalar> uniform(0, 1);
+
+		for (int s = 0; s < surfaceSamples; s++)
+		{
+			Math::Scalar target = uniform(generator) * totalArea;
+			auto it = std::lower_bound(cumulativeArea.begin(), cumulativeArea.end(), target);
+			const Face& face = mesh.faces[std::min<size_t>(it - cumulativeArea.begin(), mesh.faces.size() - 1)];
+
+			// Uniform point in the triangle by folding the unit square
+			Math::Scalar u = uniform(generator);
+			Math::Scalar v = uniform(generator);
+			if (u + v > 1)
+			{
+				u = 1 - u;
+				v = 1 - v;
+			}
+
+			const Math::Vector3& a = mesh.vertices[face.i].position;
+			const Math::Vector3& b = mesh.vertices[face.j].position;
+			const Math::Vector3& c = mesh.vertices[face.k].position;
+
+			samples.push_back(a + (b - a) * u + (c - a) * v);
+		}
+	}
+
+	int ApproximationErrorEvaluator::getSampleCount() const
+	{
+		return static_cast<int>(samples.size());
+	}
+
+	// Samples inside the envelope are at distance zero, the measure is one-sided from the surface to the spheres
+	ApproximationError ApproximationErrorEvaluator::evaluate(SphereMesh& sm)
+	{
+		ApproximationError result;
+
+		bvh.build(sm);
+		if (bvh.empty() || samples.empty())
+			return result;
+
+		const int n = static_cast<int>(samples.size());
+		Math::Scalar maxDistance = 0;
+		Math::Scalar sum = 0;
+		Math::Scalar sumSquared = 0;
+
+		#pragma omp parallel for schedule(dynamic, 1024) reduction(max:maxDistance) reduction(+:sum, sumSquared)
+		for (int i = 0; i < n; i++)
+		{
+			Math::Scalar d = std::max(static_cast<Math::Scalar>(0), bvh.closest(samples[i]).distance);
+
+			maxDistance = std::max(maxDistance, d);
+			sum += d;
+			sumSquared += d * d;
+		}
+
+		result.samples = n;
+		result.max = maxDistance;
+		result.mean = sum / n;
+		result.rms = std::sqrt(sumSquared / n);
+
+		result.maxRelative = result.max / BDDSize;
+		result.meanRelative = result.mean / BDDSize;
+		result.rmsRelative = result.rms / BDDSize;
+
+		return result;
+	}
+}
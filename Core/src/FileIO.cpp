@@ -0,0 +1,146 @@
+#include <FileIO.hpp>
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FILE_IO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Renderer
+{
+	BufferedWriter::BufferedWriter(const std::string& path, size_t bufferSize) : path(path),
+		temporaryPath(path + ".tmp"), buffer(bufferSize)
+	{
+		std::error_code error;
+		std::filesystem::path parent = std::filesystem::path(path).parent_path();
+		if (!parent.empty())
+			std::filesystem::create_directories(parent, error);
+
+		file = std::fopen(temporaryPath.c_str(), "wb");
+	}
+
+	BufferedWriter::~BufferedWriter()
+	{
+		if (file == nullptr)
+			return;
+
+		std::fclose(file);
+		std::remove(temporaryPath.c_str());
+	}
+
+	void BufferedWriter::flush()
+	{
+		if (file != nullptr && used > 0 && std::fwrite(buffer.data(), 1, used, file) != used)
+			failed = true;
+
+		used = 0;
+	}
+
+	void BufferedWriter::write(const void* data, size_t size)
+	{
+		if (file == nullptr || failed)
+			return;
+
+		if (used + size > buffer.size())
+			flush();
+
+		// Larger than the whole buffer: straight to the file
+		if (size > buffer.size())
+		{
+			if (std::fwrite(data, 1, size, file) != size)
+				failed = true;
+			return;
+		}
+
+		std::memcpy(buffer.data() + used, data, size);
+		used += size;
+	}
+
+	void BufferedWriter::writeDecimal(double value)
+	{
+		char text[32];
+		auto result = std::to_chars(text, text + sizeof(text), value);
+		write(text, result.ptr - text);
+	}
+
+	void BufferedWriter::writeInteger(std::int64_t value)
+	{
+		char text[24];
+		auto result = std::to_chars(text, text + sizeof(text), value);
+		write(text, result.ptr - text);
+	}
+
+	bool BufferedWriter::commit()
+	{
+		if (file == nullptr)
+			return false;
+
+		flush();
+		bool closed = std::fclose(file) == 0;
+		file = nullptr;
+
+		std::error_code error;
+		if (failed || !closed)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		return true;
+	}
+
+	MappedFile::MappedFile(const std::string& path)
+	{
+#ifdef FILE_IO_MMAP
+		int descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return;
+
+		struct stat status{};
+		if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+		{
+			void* map = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (map != MAP_FAILED)
+			{
+				bytes = static_cast<const char*>(map);
+				length = static_cast<size_t>(status.st_size);
+			}
+		}
+
+		close(descriptor);
+#else
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in.is_open())
+			return;
+
+		fallback.resize(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		if (!fallback.empty() && in.read(fallback.data(), static_cast<std::streamsize>(fallback.size())))
+		{
+			bytes = fallback.data();
+			length = fallback.size();
+		}
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+#ifdef FILE_IO_MMAP
+		if (bytes != nullptr)
+			munmap(const_cast<char*>(bytes), length);
+#endif
+	}
+}
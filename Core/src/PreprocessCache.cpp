@@ -0,0 +1,40 @@
+#include <PreprocessCache.hpp>
+#include <FileIO.hpp>
+
+#include <cstdio>
+#include <utility>
+
+namespace Renderer
+{
+	namespace
+	{
+		std::string hexKey(std::uint64_t key)
+		{
+			char text[17];
+			std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(key));
+			return text;
+		}
+	}
+
+	PreprocessCache::PreprocessCache(std::string directory) : directory(std::move(directory)) {}
+
+	std::string PreprocessCache::meshEntry(const std::string& objPath, bool spatialOrder) const
+	{
+		if (!enabled)
+			return {};
+
+		MappedFile file(objPath);
+		if (!file.isOpen())
+			return {};
+
+		return directory + "/" + hexKey(hashBytes(file.data(), file.size())) + (spatialOrder ? ".sorted.mesh" : ".mesh");
+	}
+
+	std::string PreprocessCache::sphereMeshEntry(std::uint64_t key) const
+	{
+		if (!enabled)
+			return {};
+
+		return directory + "/" + hexKey(key) + ".spheremesh";
+	}
+}
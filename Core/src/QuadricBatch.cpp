@@ -0,0 +1,260 @@
+#include <QuadricBatch.hpp>
+
+#include <Quadric.hpp>
+#include <SIMD.hpp>
+
+namespace Renderer
+{
+	namespace
+	{
+		// One candidate at a time
+		struct ScalarLanes
+		{
+			using Value = Math::Scalar;
+			using Mask = bool;
+
+			static constexpr size_t WIDTH = 1;
+
+			static Value load(const Math::Scalar* p) { return *p; }
+			static void store(Math::Scalar* p, Value v) { *p = v; }
+			static Value broadcast(Math::Scalar s) { return s; }
+
+			static Mask less(Value a, Value b) { return a < b; }
+			static Mask equal(Value a, Value b) { return a == b; }
+			static Mask either(Mask a, Mask b) { return a || b; }
+			static Value select(Mask m, Value a, Value b) { return m ? a : b; }
+		};
+
+#if defined(MATH_SIMD_AVX)
+		// Four candidates per register, the arithmetic goes through the GCC/Clang vector operators of __m256d
+		struct AVXLanes
+		{
+			using Value = __m256d;
+			using Mask = __m256d;
+
+			static constexpr size_t WIDTH = 4;
+
+			static Value load(const Math::Scalar* p) { return _mm256_loadu_pd(p); }
+			static void store(Math::Scalar* p, Value v) { _mm256_storeu_pd(p, v); }
+			static Value broadcast(Math::Scalar s) { return _mm256_set1_pd(s); }
+
+			static Mask less(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+			static Mask equal(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+			static Mask either(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+			static Value select(Mask m, Value a, Value b) { return _mm256_blendv_pd(b, a, m); }
+		};
+#endif
+
+		void pack(const Quadric& q, std::vector<Math::Scalar>* fields)
+		{
+			int k = 0;
+			for (int r = 0; r < 4; r++)
+				for (int c = r; c < 4; c++)
+					fields[k++].push_back(q.A.data[4 * r + c]);
+
+			for (int r = 0; r < 4; r++)
+				fields[k++].push_back(q.b[r]);
+
+			fields[k].push_back(q.c);
+		}
+	}
+
+	void QuadricBatch::clear()
+	{
+		for (int k = 0; k < FIELDS; k++)
+		{
+			first[k].clear();
+			second[k].clear();
+		}
+
+		minimumRadius.clear();
+		maximumRadius.clear();
+	}
+
+	size_t QuadricBatch::add(const Quadric& a, const Quadric& b, Math::Scalar maximum, Math::Scalar minimum)
+	{
+		pack(a, first);
+		pack(b, second);
+
+		minimumRadius.push_back(minimum);
+		maximumRadius.push_back(maximum);
+
+		return minimumRadius.size() - 1;
+	}
+
+	// The steps of Quadric::getMinimumAndMinimizer, term by term: Matrix4::setInverse, the Quadric3 solve through
+	// Matrix3::setInverse, the evaluation. Both bounded and unbounded minimizers are computed for every lane and
+	// the right one is selected
+	template <typename Lanes>
+	void QuadricBatch::solveRange(size_t begin, size_t end)
+	{
+		using V = typename Lanes::Value;
+
+		const V zero = Lanes::broadcast(0);
+		const V one = Lanes::broadcast(1);
+		const V two = Lanes::broadcast(2);
+		const V minusOne = Lanes::broadcast(-1);
+
+		for (size_t i = begin; i < end; i += Lanes::WIDTH)
+		{
+			V q[FIELDS];
+			for (int k = 0; k < FIELDS; k++)
+			{
+				q[k] = Lanes::load(&first[k][i]) + Lanes::load(&second[k][i]);
+				Lanes::store(&sum[k][i], q[k]);
+			}
+
+			const V m[16] = {q[0], q[1], q[2], q[3],
+			                 q[1], q[4], q[5], q[6],
+			                 q[2], q[5], q[7], q[8],
+			                 q[3], q[6], q[8], q[9]};
+			const V b[4] = {q[10], q[11], q[12], q[13]};
+			const V c = q[14];
+
+			V inv[16];
+			inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+			         m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+			inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] -
+			         m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+			inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+			         m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+			inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] -
+			          m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+			inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] -
+			         m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+			inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+			         m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+			inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] -
+			         m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+			inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+			          m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+			inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] +
+			         m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+			inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] -
+			         m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+			inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] +
+			          m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+			inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] -
+			          m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+			inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] -
+			         m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+			inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] +
+			         m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+			inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] -
+			          m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+			inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] +
+			          m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+			const V det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+			const auto singular = Lanes::equal(det, zero);
+			const V inverseDet = one / det;
+
+			V h[4];
+			for (int k = 0; k < 4; k++)
+				h[k] = -b[k] / two;
+
+			V x[4];
+			for (int r = 0; r < 4; r++)
+				x[r] = ((inv[4 * r] * inverseDet) * h[0] + (inv[4 * r + 1] * inverseDet) * h[1]) +
+				       ((inv[4 * r + 2] * inverseDet) * h[2] + (inv[4 * r + 3] * inverseDet) * h[3]);
+
+			// Out of bounds the radius is fixed on the bound it crossed and only the center is solved for
+			const V lower = Lanes::load(&minimumRadius[i]);
+			const V upper = Lanes::load(&maximumRadius[i]);
+			const auto belowMinimum = Lanes::less(x[3], lower);
+			const auto bounded = Lanes::either(belowMinimum, Lanes::less(upper, x[3]));
+			const V radius = Lanes::select(belowMinimum, lower, upper);
+
+			const V a[9] = {m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]};
+
+			V g[3];
+			for (int k = 0; k < 3; k++)
+				g[k] = -(b[k] + two * radius * m[12 + k]) / two;
+
+			const V t1 = a[0] * a[4], t2 = a[0] * a[5], t3 = a[1] * a[3];
+			const V t4 = a[2] * a[3], t5 = a[1] * a[6], t6 = a[2] * a[6];
+
+			const V det3 = t1 * a[8] - t2 * a[7] - t3 * a[8] + t4 * a[7] + t5 * a[5] - t6 * a[4];
+			const auto singular3 = Lanes::equal(det3, zero);
+			const V inverseDet3 = one / det3;
+
+			const V n[9] = {(a[4] * a[8] - a[5] * a[7]) * inverseDet3, -(a[1] * a[8] - a[2] * a[7]) * inverseDet3,
+			                (a[1] * a[5] - a[2] * a[4]) * inverseDet3, -(a[3] * a[8] - a[5] * a[6]) * inverseDet3,
+			                (a[0] * a[8] - t6) * inverseDet3, -(t2 - t4) * inverseDet3,
+			                (a[3] * a[7] - a[4] * a[6]) * inverseDet3, -(a[0] * a[7] - t5) * inverseDet3,
+			                (t1 - t3) * inverseDet3};
+
+			for (int r = 0; r < 3; r++)
+			{
+				V center = Lanes::select(singular3, zero, n[3 * r] * g[0] + n[3 * r + 1] * g[1] + n[3 * r + 2] * g[2]);
+				x[r] = Lanes::select(bounded, center, x[r]);
+			}
+			x[3] = Lanes::select(bounded, radius, x[3]);
+
+			// Quadric::minimizer gives up on a singular A with this sphere
+			for (int r = 0; r < 3; r++)
+				x[r] = Lanes::select(singular, minusOne, x[r]);
+			x[3] = Lanes::select(singular, zero, x[3]);
+
+			V Ax[4];
+			for (int r = 0; r < 4; r++)
+				Ax[r] = (m[4 * r] * x[0] + m[4 * r + 1] * x[1]) + (m[4 * r + 2] * x[2] + m[4 * r + 3] * x[3]);
+
+			const V error = (x[0] * Ax[0] + x[1] * Ax[1] + x[2] * Ax[2] + x[3] * Ax[3]) +
+			                (b[0] * x[0] + b[1] * x[1] + b[2] * x[2] + b[3] * x[3]) + c;
+
+			for (int r = 0; r < 4; r++)
+				Lanes::store(&minimizer[r][i], x[r]);
+			Lanes::store(&cost[i], error);
+		}
+	}
+
+	void QuadricBatch::resizeResults()
+	{
+		for (auto& field : sum)
+			field.resize(size());
+		for (auto& coordinate : minimizer)
+			coordinate.resize(size());
+		cost.resize(size());
+	}
+
+	void QuadricBatch::solve()
+	{
+		resizeResults();
+
+#if defined(MATH_SIMD_AVX)
+		const size_t vectorized = size() - size() % AVXLanes::WIDTH;
+
+		solveRange<AVXLanes>(0, vectorized);
+		solveRange<ScalarLanes>(vectorized, size());
+#else
+		solveRange<ScalarLanes>(0, size());
+#endif
+	}
+
+	void QuadricBatch::solveScalar()
+	{
+		resizeResults();
+		solveRange<ScalarLanes>(0, size());
+	}
+
+	Quadric QuadricBatch::getSum(size_t i) const
+	{
+		Quadric q;
+
+		int k = 0;
+		for (int r = 0; r < 4; r++)
+			for (int c = r; c < 4; c++, k++)
+				q.A.data[4 * r + c] = q.A.data[4 * c + r] = sum[k][i];
+
+		q.b = Math::Vector4(sum[10][i], sum[11][i], sum[12][i], sum[13][i]);
+		q.c = sum[14][i];
+
+		return q;
+	}
+
+	Math::Vector4 QuadricBatch::getMinimizer(size_t i) const
+	{
+		return {minimizer[0][i], minimizer[1][i], minimizer[2][i], minimizer[3][i]};
+	}
+}
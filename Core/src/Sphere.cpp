@@ -23,7 +23,6 @@ namespace Renderer {
     Sphere::Sphere(const Sphere& other)
     {
         this->renderedMeshID = other.renderedMeshID;
-        this->vertices = other.vertices;
         this->quadricWeights = other.quadricWeights;
         this->quadric = other.quadric;
         this->region = other.region;
@@ -33,9 +32,9 @@ namespace Renderer {
 		this->neighbourSpheres = other.neighbourSpheres;
     }
 
-    Sphere::Sphere(Vertex& vertex, int vertexIdx, Math::Scalar k)
+    Sphere::Sphere(const Vertex& vertex, Math::Scalar k)
     {
-		init(vertex, vertexIdx, k);
+		init(vertex, k);
     }
 
     Sphere::Sphere(const Math::Vector3& center, Math::Scalar radius)
@@ -48,7 +47,7 @@ namespace Renderer {
         generateUUID();
     }
 	
-	void Sphere::init (Vertex& vertex, int vertexIdx, Math::Scalar k)
+	void Sphere::init (const Vertex& vertex, Math::Scalar k)
 	{
 		quadric = Quadric::initializeQuadricFromVertex(vertex, k) * 1e-6;
 		
@@ -61,12 +60,9 @@ namespace Renderer {
 		this->quadricWeights = 1e-6;
 		
 		generateUUID();
-		
-		vertex.referenceSphere = this->getID();
-		this->vertices.insert(vertexIdx);
 	}
 	
-	void Sphere::initTHIERY (Renderer::Vertex &vertex)
+	void Sphere::initTHIERY (const Renderer::Vertex &vertex)
 	{
 		quadric = Quadric(); // Removing "OUR" regularizer
 		this->quadricWeights = 0;
@@ -88,11 +84,10 @@ namespace Renderer {
     {
         return this->renderedMeshID;
     }
-	
-    void Sphere::addVertex(Vertex& vertex, int index)
+
+    void Sphere::setID(int id)
     {
-		vertex.referenceSphere = this->getID();
-        vertices.insert(index);
+        this->renderedMeshID = id;
     }
 	
 #ifdef USE_THIEF_SPHERE_METHOD
@@ -5,14 +5,23 @@
 
 #include <YAMLUtils.hpp>
 #include <ScopeTimer.hpp>
+#include <GLState.hpp>
+#include <FileIO.hpp>
+#include <SphereMeshBVH.hpp>
 
 #include <omp.h>
 
+#include <Eigen/Dense>
+
+#include <algorithm>
 #include <filesystem>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
 
 
-// TODO: Define a stop criteria for the collapsing of the timedSpheres-mesh (error of the quadrics)
 // TODO: Define a way to avoid using the EPSILON/improve its usage
 // TODO: Implement a link function for the spheres, when clicking two spheres I can link them, also with three, in
 //  the first case I generate a new edge, in the second case I generate a new triangle, I need to discard the
@@ -26,6 +35,10 @@ namespace Renderer {
         BDDSize = sm.BDDSize;
 	    
 	    timedSpheres = sm.timedSpheres;
+		aliases = sm.aliases;
+		timestamps = sm.timestamps;
+		quadricBounds = sm.quadricBounds;
+		vertexOwners = sm.vertexOwners;
 		
         triangle = sm.triangle;
         edge = sm.edge;
@@ -43,49 +56,74 @@ namespace Renderer {
         
         BDDSize = mesh->bbox.BDD().magnitude();
 
-        initializeSphereMeshTriangles(mesh->faces);
-        initializeSpheres(mesh->vertices, 0.01 * BDDSize);
-        
-        computeSpheresProperties(mesh->vertices, mesh->faces);
-        updateSpheres();
-		
-	    for (const Triangle& t : triangle)
-	    {
-		    timedSpheres[t.i].sphere.addNeighbourSphere(t.j);
-		    timedSpheres[t.i].sphere.addNeighbourSphere(t.k);
-		    timedSpheres[t.j].sphere.addNeighbourSphere(t.i);
-		    timedSpheres[t.j].sphere.addNeighbourSphere(t.k);
-		    timedSpheres[t.k].sphere.addNeighbourSphere(t.i);
-		    timedSpheres[t.k].sphere.addNeighbourSphere(t.j);
-	    }
-		
-		if (IMPLEMENT_THIERY_2013)
-			addGeometricallyCloseNeighbours(0.05 * BDDSize);
-		else
-		{
-	        extendSpheresNeighboursOneStep();
-	        extendSpheresNeighboursOneStep();
-		}
+        initializeFromReferenceMesh();
         initializeEdgeQueue();
     }
 	
-	void SphereMesh::resetSphereMesh()
+	SphereMesh::SphereMesh(TriMesh* mesh, Shader* shader, const PreprocessCache& cache) : referenceMesh(mesh)
 	{
-		timedSpheres.clear();
-		triangle.clear();
-		edge.clear();
-		edgeQueue.clear();
-		sphereMapper.clear();
+		this->sphereShader = shader;
+		renderType = RenderType::BILLBOARDS;
 		
-		performedOperations = 0;
-		numberOfActiveSpheres = 0;
+		BDDSize = mesh->bbox.BDD().magnitude();
+		
+		const std::string entry = cache.sphereMeshEntry(preprocessedKey());
+		if (!entry.empty() && loadPreprocessed(entry))
+			return;
+		
+		initializeFromReferenceMesh();
+		
+		std::vector<Math::Scalar> solutions;
+		initializeEdgeQueue(&solutions, nullptr);
+		
+		if (!entry.empty())
+			savePreprocessed(entry, solutions);
+	}
+	
+	SphereMesh::SphereMesh(TriMesh* mesh, Shader* shader, Deferred) : referenceMesh(mesh)
+	{
+		this->sphereShader = shader;
+		renderType = RenderType::BILLBOARDS;
+		
+		BDDSize = mesh->bbox.BDD().magnitude();
+	}
+	
+	SphereMesh::SphereMesh(TriMesh* chunk, const SphereMesh& parent, std::vector<std::uint8_t> locked)
+		: referenceMesh(chunk)
+	{
+		sphereShader = nullptr;
+		renderType = RenderType::BILLBOARDS;
+		
+		// Distances are relative to the whole mesh
+		BDDSize = parent.BDDSize;
 		
+		IMPLEMENT_THIERY_2013 = parent.IMPLEMENT_THIERY_2013;
+		FLOAT_CANDIDATE_COSTS = parent.FLOAT_CANDIDATE_COSTS;
+		CURVATURE_SIGMA = parent.CURVATURE_SIGMA;
+		NEIGHBOURHOOD_RINGS = parent.NEIGHBOURHOOD_RINGS;
+		NEIGHBOURHOOD_RADIUS = parent.NEIGHBOURHOOD_RADIUS;
+		CANDIDATE_PRUNE_ERROR = parent.CANDIDATE_PRUNE_ERROR;
+		LAZY_COLLAPSE_COSTS = parent.LAZY_COLLAPSE_COSTS;
+		
+		initializeFromReferenceMesh();
+		lockedSpheres = std::move(locked);
+		initializeEdgeQueue();
+	}
+	
+	void SphereMesh::initializeFromReferenceMesh()
+	{
 		initializeSphereMeshTriangles(referenceMesh->faces);
 		initializeSpheres(referenceMesh->vertices, 0.01 * BDDSize);
 		
 		computeSpheresProperties(referenceMesh->vertices, referenceMesh->faces);
 		updateSpheres();
 		
+		if (!IMPLEMENT_THIERY_2013 && NEIGHBOURHOOD_RINGS > 0)
+		{
+			buildNeighbourhoods();
+			return;
+		}
+		
 		for (const Triangle& t : triangle)
 		{
 			timedSpheres[t.i].sphere.addNeighbourSphere(t.j);
@@ -103,6 +141,21 @@ namespace Renderer {
 			extendSpheresNeighboursOneStep();
 			extendSpheresNeighboursOneStep();
 		}
+	}
+	
+	void SphereMesh::resetSphereMesh()
+	{
+		clearTimedSpheres();
+		triangle.clear();
+		edge.clear();
+		edgeQueue.clear();
+		sphereMapper.clear();
+		
+		performedOperations = 0;
+		numberOfActiveSpheres = 0;
+		
+		if (CHUNK_VERTICES <= 0 || !initializeFromChunks())
+			initializeFromReferenceMesh();
 		initializeEdgeQueue();
 	}
 	
@@ -114,8 +167,9 @@ namespace Renderer {
 			{
 				bool check = (timedSpheres[i].sphere.center - timedSpheres[j].sphere.center).magnitude()
 				             - (timedSpheres[i].sphere.radius + timedSpheres[j].sphere.radius) <= epsilon;
-				Vertex& vi = referenceMesh->vertices[*timedSpheres[i].sphere.vertices.begin()];
-				Vertex& vj = referenceMesh->vertices[*timedSpheres[j].sphere.vertices.begin()];
+				// Still one sphere per vertex
+				Vertex& vi = referenceMesh->vertices[i];
+				Vertex& vj = referenceMesh->vertices[j];
 				if (check && normalTest(vi, vj))
 				{
 					timedSpheres[i].sphere.neighbourSpheres.insert(j);
@@ -125,28 +179,126 @@ namespace Renderer {
 		}
 	}
 	
-	void SphereMesh::updateNeighborsOf(Sphere& s)
+	// Rewritten in place: only the links to merged and removed spheres are dropped, and the survivors of merged ones
+	// only take a new node when they are not already neighbours
+	void SphereMesh::updateNeighborsOf(int sphereIndex)
 	{
-		set_of_int newNeighbors;
+		set_of_int& neighbours = timedSpheres[sphereIndex].sphere.neighbourSpheres;
+		
+		static thread_local std::vector<int> survivors;
+		survivors.clear();
 		
-		int sphereAlias = alias(sphereMapper[s.getID()]);
-		for (int i : s.neighbourSpheres)
+		int sphereAlias = alias(sphereIndex);
+		for (auto it = neighbours.begin(); it != neighbours.end();)
 		{
-			int j = alias(i);
-			if (j != sphereAlias)
-				newNeighbors.insert(j);
+			int j = alias(*it);
+			if (j == *it && j != sphereAlias)
+			{
+				++it;
+				continue;
+			}
+			
+			if (j >= 0 && j != sphereAlias)
+				survivors.push_back(j);
+			it = neighbours.erase(it);
 		}
 		
-		s.neighbourSpheres = newNeighbors;
+		neighbours.insert(survivors.begin(), survivors.end());
+	}
+	
+	void SphereMesh::gatherSphereVertices(std::vector<int>& vertexOffsets, std::vector<int>& sphereVertices)
+	{
+		const int n = static_cast<int>(timedSpheres.size());
+		const int vertexCount = static_cast<int>(vertexOwners.size());
+		
+		std::vector<int> owner(vertexCount);
+		for (int v = 0; v < vertexCount; v++)
+			owner[v] = alias(vertexOwners[v]);
+		
+		vertexOffsets.assign(n + 1, 0);
+		for (int o : owner)
+			if (o >= 0)
+				vertexOffsets[o + 1]++;
+		
+		for (int i = 0; i < n; i++)
+			vertexOffsets[i + 1] += vertexOffsets[i];
+		
+		sphereVertices.resize(vertexOffsets[n]);
+		std::vector<int> next(vertexOffsets.begin(), vertexOffsets.end() - 1);
+		for (int v = 0; v < vertexCount; v++)
+			if (owner[v] >= 0)
+				sphereVertices[next[owner[v]]++] = v;
+	}
+	
+	std::vector<int> SphereMesh::getSphereVertices(int sphereIndex)
+	{
+		std::vector<int> sphereVertices;
+		for (int v = 0; v < vertexOwners.size(); v++)
+			if (alias(vertexOwners[v]) == sphereIndex)
+				sphereVertices.push_back(v);
+		
+		return sphereVertices;
+	}
+	
+	int SphereMesh::addTimedSphere(const Sphere& sphere, int aliasID, int timestamp)
+	{
+		timedSpheres.emplace_back(sphere);
+		aliases.push_back(aliasID);
+		timestamps.push_back(timestamp);
+		quadricBounds.emplace_back();
+		
+		return static_cast<int>(timedSpheres.size()) - 1;
+	}
+	
+	void SphereMesh::clearTimedSpheres(size_t capacity)
+	{
+		timedSpheres.clear();
+		aliases.clear();
+		timestamps.clear();
+		quadricBounds.clear();
+		
+		timedSpheres.reserve(capacity);
+		aliases.reserve(capacity);
+		timestamps.reserve(capacity);
+		quadricBounds.reserve(capacity);
+	}
+	
+	SphereMesh::Snapshot SphereMesh::snapshot() const
+	{
+		return {timedSpheres, aliases, timestamps, quadricBounds, vertexOwners};
+	}
+	
+	void SphereMesh::restore(const Snapshot& snapshot)
+	{
+		timedSpheres = snapshot.spheres;
+		aliases = snapshot.aliases;
+		timestamps = snapshot.timestamps;
+		quadricBounds = snapshot.quadricBounds;
+		vertexOwners = snapshot.vertexOwners;
+		
+		editState.operation = -1;
+		edgeQueue.setQueueDirty();
 	}
 	
+	// Path compression only writes a link that actually changes, once the aliases are flattened concurrent lookups
+	// are read-only. A removed sphere, and the ones merged into it, resolve to -1
 	int SphereMesh::alias(int i)
 	{
-		int j = timedSpheres[i].alias;
+		int j = aliases[i];
 		
-		if (i == j) return i;
+		if (i == j || j < 0) return j;
 		
-		return timedSpheres[i].alias = alias(j);
+		int root = alias(j);
+		if (root != j)
+			aliases[i] = root;
+		
+		return root;
+	}
+	
+	void SphereMesh::flattenAliases()
+	{
+		for (int i = 0; i < timedSpheres.size(); i++)
+			alias(i);
 	}
 	
 	void SphereMesh::extendSpheresNeighboursOneStep()
@@ -163,9 +315,99 @@ namespace Renderer {
 			timedSpheres[i].sphere.neighbourSpheres.erase(i);
 	}
 	
+	// Breadth-first visit of the mesh adjacency from every vertex, up to NEIGHBOURHOOD_RINGS rings. When it is set,
+	// only the vertices within NEIGHBOURHOOD_RADIUS are kept, the walk itself is not cut so the relation stays
+	// symmetric. The visits run in parallel, their results are gathered in a CSR and the neighbour sets filled from it
+	void SphereMesh::buildNeighbourhoods()
+	{
+		const int n = static_cast<int>(timedSpheres.size());
+		const std::vector<Face>& faces = referenceMesh->faces;
+		
+		std::vector<int> adjacencyOffsets(n + 1, 0);
+		for (const Face& f : faces)
+			for (int v : {f.i, f.j, f.k})
+				adjacencyOffsets[v + 1] += 2;
+		
+		for (int i = 0; i < n; i++)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		
+		std::vector<int> adjacency(adjacencyOffsets.back());
+		std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (const Face& f : faces)
+		{
+			adjacency[fill[f.i]++] = f.j;
+			adjacency[fill[f.i]++] = f.k;
+			adjacency[fill[f.j]++] = f.i;
+			adjacency[fill[f.j]++] = f.k;
+			adjacency[fill[f.k]++] = f.i;
+			adjacency[fill[f.k]++] = f.j;
+		}
+		
+		const int rings = NEIGHBOURHOOD_RINGS;
+		const Math::Scalar radius = NEIGHBOURHOOD_RADIUS > 0 ? NEIGHBOURHOOD_RADIUS * BDDSize : DBL_MAX;
+		const Math::Scalar radiusSquared = radius == DBL_MAX ? DBL_MAX : radius * radius;
+		
+		std::vector<std::vector<int>> visits(n);
+		
+		#pragma omp parallel
+		{
+			std::vector<int> visitedFrom(n, -1);
+			std::vector<int> frontier, next;
+			
+			#pragma omp for schedule(dynamic, 256)
+			for (int source = 0; source < n; source++)
+			{
+				const Math::Vector3& origin = referenceMesh->vertices[source].position;
+				std::vector<int>& visited = visits[source];
+				
+				visitedFrom[source] = source;
+				frontier.assign(1, source);
+				
+				for (int ring = 0; ring < rings && !frontier.empty(); ring++)
+				{
+					next.clear();
+					for (int v : frontier)
+						for (int k = adjacencyOffsets[v]; k < adjacencyOffsets[v + 1]; k++)
+						{
+							int w = adjacency[k];
+							if (visitedFrom[w] == source)
+								continue;
+							
+							visitedFrom[w] = source;
+							next.push_back(w);
+							
+							if ((referenceMesh->vertices[w].position - origin).squareMagnitude() <= radiusSquared)
+								visited.push_back(w);
+						}
+					
+					std::swap(frontier, next);
+				}
+			}
+		}
+		
+		std::vector<int> neighbourOffsets(n + 1, 0);
+		for (int i = 0; i < n; i++)
+			neighbourOffsets[i + 1] = neighbourOffsets[i] + static_cast<int>(visits[i].size());
+		
+		std::vector<int> neighbours(neighbourOffsets.back());
+		for (int i = 0; i < n; i++)
+		{
+			std::copy(visits[i].begin(), visits[i].end(), neighbours.begin() + neighbourOffsets[i]);
+			std::vector<int>().swap(visits[i]);
+		}
+		
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int i = 0; i < n; i++)
+		{
+			set_of_int& neighbourSpheres = timedSpheres[i].sphere.neighbourSpheres;
+			neighbourSpheres.reserve(neighbourOffsets[i + 1] - neighbourOffsets[i]);
+			neighbourSpheres.insert(neighbours.begin() + neighbourOffsets[i], neighbours.begin() + neighbourOffsets[i + 1]);
+		}
+	}
+	
 	bool SphereMesh::isTimedSphereAlive(int id)
 	{
-		return timedSpheres[id].alias == id;
+		return aliases[id] == id;
 	}
 
     int SphereMesh::getPerSphereVertexCount() const {
@@ -194,6 +436,10 @@ namespace Renderer {
 		
 		BDDSize = sm.BDDSize;
 		timedSpheres = sm.timedSpheres;
+		aliases = sm.aliases;
+		timestamps = sm.timestamps;
+		quadricBounds = sm.quadricBounds;
+		vertexOwners = sm.vertexOwners;
 		triangle = sm.triangle;
 		edge = sm.edge;
 		
@@ -210,19 +456,21 @@ namespace Renderer {
 
     void SphereMesh::initializeSpheres(std::vector<Vertex>& vertices, Math::Scalar initialRadius)
     {
-		timedSpheres.clear();
-        timedSpheres.reserve(vertices.size());
+		clearTimedSpheres(vertices.size());
+		
+		vertexOwners.resize(vertices.size());
+		std::iota(vertexOwners.begin(), vertexOwners.end(), 0);
 		
 	    for (int i = 0; i < vertices.size(); i++)
 	    {
-			auto newSphere = Sphere(vertices[i], i, initialRadius);
+			auto newSphere = Sphere(vertices[i], initialRadius);
 			
 			if (IMPLEMENT_THIERY_2013)
 				newSphere.initTHIERY(vertices[i]);
 			
-		    timedSpheres.emplace_back(newSphere, timedSpheres.size(), performedOperations);
+		    int index = addTimedSphere(newSphere, static_cast<int>(timedSpheres.size()), performedOperations);
 			
-			sphereMapper[newSphere.getID()] = static_cast<int>(timedSpheres.size()) - 1;
+			sphereMapper[newSphere.getID()] = index;
 		}
 	    
 	    numberOfActiveSpheres = static_cast<int>(timedSpheres.size());
@@ -230,22 +478,196 @@ namespace Renderer {
 	
 	void SphereMesh::addPotentialCollapse(int i, int j)
 	{
+		if (isLocked(i) || isLocked(j))
+			return;
+		
 		EdgeCollapse e = EdgeCollapse(i, j, performedOperations);
-		updateCost(e);
-		edgeQueue.push(e);
+		
+		if (LAZY_COLLAPSE_COSTS)
+		{
+			e.cost = collapseCostBound(i, j);
+			e.lazy = true;
+		}
+		else
+			updateCost(e);
+		
+		edgeQueue.push(std::move(e));
+	}
+	
+	// The quadric is split around its unconstrained minimizer, q(x) = q(m) + (x - m)^T A (x - m) >= q(m) + l |x - m|^2
+	// with l the smallest eigenvalue of A. The quadrics are sums of squares, a singular one is only bounded by zero
+	void SphereMesh::updateQuadricBound(int sphereIndex)
+	{
+		QuadricBound& s = quadricBounds[sphereIndex];
+		const Quadric& q = timedSpheres[sphereIndex].sphere.quadric;
+		
+		s.minimumError = 0;
+		s.minimumCurvature = 0;
+		
+		// A is symmetric, the storage order doesn't matter
+		Eigen::Matrix4d A;
+		for (int k = 0; k < 16; k++)
+			A(k / 4, k % 4) = q.A.data[k];
+		
+		Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> solver(A);
+		const Eigen::Vector4d& eigenvalues = solver.eigenvalues();
+		
+		if (solver.info() != Eigen::Success || eigenvalues[0] <= eigenvalues[3] * 1e-9)
+			return;
+		
+		Eigen::Vector4d b(q.b[0], q.b[1], q.b[2], q.b[3]);
+		Eigen::Vector4d m = solver.eigenvectors() *
+		                    (solver.eigenvectors().transpose() * b).cwiseQuotient(eigenvalues) * -0.5;
+		
+		s.minimizer = Math::Vector4(m[0], m[1], m[2], m[3]);
+		s.minimumError = std::max(static_cast<Math::Scalar>(0), q.evaluateSQEM(s.minimizer));
+		s.minimumCurvature = eigenvalues[0];
+	}
+	
+	// The sum of the two quadric bounds is smallest at the weighted mean of the two minimizers. The radius bounds of a
+	// collapse only make its cost larger, so this holds in THIERY mode as well
+	Math::Scalar SphereMesh::collapseCostBound(int i, int j) const
+	{
+		const QuadricBound& a = quadricBounds[i];
+		const QuadricBound& b = quadricBounds[j];
+		
+		Math::Scalar bound = a.minimumError + b.minimumError;
+		
+		if (a.minimumCurvature > 0 && b.minimumCurvature > 0)
+			bound += a.minimumCurvature * b.minimumCurvature / (a.minimumCurvature + b.minimumCurvature) *
+			         (a.minimizer - b.minimizer).squareMagnitude();
+		
+		return bound;
 	}
 
     void SphereMesh::initializeEdgeQueue()
     {
-	    edgeQueue = TemporalValidityQueue(timedSpheres, sphereMapper);
+	    initializeEdgeQueue(nullptr, nullptr);
+    }
+	
+	void SphereMesh::initializeEdgeQueue(std::vector<Math::Scalar>* solved, const std::vector<Math::Scalar>* cached)
+	{
+		edgeQueue = TemporalValidityQueue(timedSpheres, sphereMapper);
 		performedOperations = 0;
+		editState.operation = -1;
+		lastCollapseCost = 0;
 		numberOfActiveSpheres = static_cast<int>(timedSpheres.size());
 		
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < static_cast<int>(timedSpheres.size()); i++)
+			updateQuadricBound(i);
+		
+		const Math::Scalar pruneCost = CANDIDATE_PRUNE_ERROR > 0 ? std::pow(CANDIDATE_PRUNE_ERROR * BDDSize, 2) : DBL_MAX;
+		prunedCost = DBL_MAX;
+		
+		// Candidates are solved a block per thread at a time, so that they are still in cache when they are pushed.
+		// Those past the end of the cached solves are solved together
+		const size_t chunk = CANDIDATE_BLOCK * static_cast<size_t>(omp_get_max_threads());
+		const size_t cachedCandidates = cached != nullptr ? cached->size() / 5 : 0;
+		size_t seen = 0;
+		
+		std::vector<EdgeCollapse> candidates;
+		candidates.reserve(chunk);
+		
+		auto pushCandidates = [&]()
+		{
+			size_t fromCache = std::min(candidates.size(), cachedCandidates - std::min(seen, cachedCandidates));
+			for (size_t k = 0; k < fromCache; k++)
+			{
+				EdgeCollapse& e = candidates[k];
+				const Math::Scalar* values = cached->data() + 5 * (seen + k);
+				
+				gatherCollapse(e);
+				e.centerRadius = Math::Vector4(values[0], values[1], values[2], values[3]);
+				e.cost = values[4];
+			}
+			
+			solveCandidates(candidates, fromCache);
+			seen += candidates.size();
+			
+			for (EdgeCollapse& e : candidates)
+			{
+				if (solved != nullptr)
+					solved->insert(solved->end(), {e.centerRadius[0], e.centerRadius[1], e.centerRadius[2],
+					                               e.centerRadius[3], e.cost});
+				
+				edgeQueue.push(std::move(e));
+			}
+			
+			candidates.clear();
+		};
+		
 		for (int i = 0; i < timedSpheres.size(); i++)
 			for (int j : timedSpheres[i].sphere.neighbourSpheres)
-				if (i > j)
-					addPotentialCollapse(i, j);
-    }
+			{
+				if (i <= j || isLocked(i) || isLocked(j))
+					continue;
+				
+				if (pruneCost < DBL_MAX && collapseCostBound(i, j) > pruneCost)
+				{
+					prunedCost = pruneCost;
+					continue;
+				}
+				
+				candidates.emplace_back(i, j, performedOperations);
+				if (candidates.size() == chunk)
+					pushCandidates();
+			}
+		
+		pushCandidates();
+	}
+	
+	// For collapses that went around the queue: every current neighbour pair is solved again
+	void SphereMesh::rebuildEdgeQueue()
+	{
+		flattenAliases();
+		
+		std::vector<EdgeCollapse> candidates;
+		for (int i = 0; i < timedSpheres.size(); i++)
+			if (aliases[i] == i && !isLocked(i))
+				for (int j : timedSpheres[i].sphere.neighbourSpheres)
+					if (i > alias(j) && !isLocked(alias(j)))
+						candidates.emplace_back(i, alias(j), performedOperations);
+		
+		solveCandidates(candidates);
+		
+		edgeQueue.clear();
+		for (EdgeCollapse& e : candidates)
+			edgeQueue.push(std::move(e));
+		
+		prunedCost = DBL_MAX;
+	}
+	
+	// Pairs pruned from the initial queue are between spheres no collapse has touched yet, every other pair was queued
+	// when one of its spheres was merged. They go back in before anything costlier than their bound is popped
+	void SphereMesh::restorePrunedCandidates()
+	{
+		flattenAliases();
+		
+		std::vector<EdgeCollapse> candidates;
+		for (int i = 0; i < timedSpheres.size(); i++)
+			if (aliases[i] == i && timestamps[i] == 0 && !isLocked(i))
+				for (int j : timedSpheres[i].sphere.neighbourSpheres)
+				{
+					int k = alias(j);
+					if (i > k && timestamps[k] == 0 && !isLocked(k) && collapseCostBound(i, k) > prunedCost)
+						candidates.emplace_back(i, k, performedOperations);
+				}
+		
+		if (LAZY_COLLAPSE_COSTS)
+			for (EdgeCollapse& e : candidates)
+			{
+				e.cost = collapseCostBound(e.toCollapse[0], e.toCollapse[1]);
+				e.lazy = true;
+			}
+		else
+			solveCandidates(candidates);
+		
+		for (EdgeCollapse& e : candidates)
+			edgeQueue.push(std::move(e));
+		
+		prunedCost = DBL_MAX;
+	}
 	
     RenderType SphereMesh::getRenderType() {
         return this->renderType;
@@ -265,7 +687,10 @@ namespace Renderer {
 
     void SphereMesh::computeSpheresProperties(const std::vector<Vertex>& vertices, const std::vector<Face>& faces)
     {
-        const Math::Scalar sigma = 1.0;
+        const Math::Scalar sigma = CURVATURE_SIGMA;
+        
+        if (sigma != 0)
+            referenceMesh->ensureCurvature();
         
         for (const Face& j : faces)
         {
@@ -273,22 +698,8 @@ namespace Renderer {
             int i1 = j.j;
             int i2 = j.k;
             
-            Math::Vector3 v0 = vertices[i0].position;
-            Math::Vector3 v1 = vertices[i1].position;
-            Math::Vector3 v2 = vertices[i2].position;
-            Math::Vector3 normal = getTriangleNormal(v0, v1, v2);
-            
-            Math::Scalar area = 0.5 * (v1 - v0).cross(v2 - v0).magnitude();
-            Math::Scalar weight = area / 3.0;
-            
-            Math::Scalar totalK1 = (vertices[i0].curvature[0] + vertices[i1].curvature[0] + vertices[i2]
-					.curvature[0]) / 3.0;
-            Math::Scalar totalK2 = (vertices[i0].curvature[1] + vertices[i1].curvature[1] + vertices[i2]
-					.curvature[1]) / 3.0;
-            
-            weight *= (1 + sigma * BDDSize * BDDSize * ((totalK1 * totalK1) + (totalK2 * totalK2)));
-            
-            Quadric q = Quadric(v0, normal) * weight;
+            Math::Scalar weight;
+            Quadric q = faceQuadric(vertices, j, sigma, weight);
 	        
 	        timedSpheres[i0].sphere.quadric += q;
 	        timedSpheres[i1].sphere.quadric += q;
@@ -300,6 +711,31 @@ namespace Renderer {
         }
     }
 
+	// Plane quadric of a face, weighted by a third of its area and, with sigma set, by the curvature at its vertices
+	Quadric SphereMesh::faceQuadric(const std::vector<Vertex>& vertices, const Face& face, Math::Scalar sigma,
+	                                Math::Scalar& weight) const
+	{
+		Math::Vector3 v0 = vertices[face.i].position;
+		Math::Vector3 v1 = vertices[face.j].position;
+		Math::Vector3 v2 = vertices[face.k].position;
+		Math::Vector3 normal = getTriangleNormal(v0, v1, v2);
+		
+		Math::Scalar area = 0.5 * (v1 - v0).cross(v2 - v0).magnitude();
+		weight = area / 3.0;
+		
+		if (sigma != 0)
+		{
+			Math::Scalar totalK1 = (vertices[face.i].curvature[0] + vertices[face.j].curvature[0] +
+			                        vertices[face.k].curvature[0]) / 3.0;
+			Math::Scalar totalK2 = (vertices[face.i].curvature[1] + vertices[face.j].curvature[1] +
+			                        vertices[face.k].curvature[1]) / 3.0;
+			
+			weight *= (1 + sigma * BDDSize * BDDSize * ((totalK1 * totalK1) + (totalK2 * totalK2)));
+		}
+		
+		return Quadric(v0, normal) * weight;
+	}
+	
     void SphereMesh::updateSpheres()
     {
         for (TimedSphere& i : timedSpheres)
@@ -330,7 +766,7 @@ namespace Renderer {
 
     void SphereMesh::clear ()
     {
-        timedSpheres.clear();
+        clearTimedSpheres();
         triangle.clear();
         edge.clear();
     }
@@ -470,7 +906,7 @@ namespace Renderer {
             vertexCount = (int)vertices.size();
 
             glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
+            GLState::bindVertexArray(VAO);
 
             glGenBuffers(1, &VBO);
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -484,7 +920,7 @@ namespace Renderer {
             glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
             glEnableVertexAttribArray(0);
 
-            glBindVertexArray(0);
+            GLState::bindVertexArray(0);
         }
         
         perSphereVertices = vertexCount;
@@ -497,14 +933,13 @@ namespace Renderer {
         sphereShader->setFloat("material.shininess", 0);
         sphereShader->setFloat("radius", static_cast<float>(radius));
 
-        glDisable(GL_CULL_FACE);
-        glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
+        GLState::disable(GL_CULL_FACE);
+        GLState::disable(GL_BLEND);
+        GLState::enable(GL_DEPTH_TEST);
+        GLState::polygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, (int)indices.size(), GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
-        glUseProgram(0);
+        GLState::bindVertexArray(VAO);
+        GLState::drawElements(GL_TRIANGLES, (int)indices.size(), GL_UNSIGNED_INT, nullptr);
     }
 
     void SphereMesh::renderOneSphere(const Math::Vector3& center, Math::Scalar radius, const Math::Vector3& color) {
@@ -603,7 +1038,7 @@ namespace Renderer {
             }
 
             glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
+            GLState::bindVertexArray(VAO);
 
             glGenBuffers(1, &VBO);
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -617,7 +1052,7 @@ namespace Renderer {
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
             glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(unsigned int), faces.data(), GL_STATIC_DRAW);
 
-            glBindVertexArray(0);
+            GLState::bindVertexArray(0);
         }
         
         perSphereVertices = vertexCount;
@@ -630,11 +1065,9 @@ namespace Renderer {
         sphereShader->setFloat("material.shininess", 0);
         sphereShader->setFloat("radius", static_cast<float>(radius));
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, (int)faces.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        glUseProgram(0);
+        GLState::polygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        GLState::bindVertexArray(VAO);
+        GLState::drawElements(GL_TRIANGLES, (int)faces.size(), GL_UNSIGNED_INT, 0);
     }
 
     void SphereMesh::renderSpheresOnly()
@@ -643,14 +1076,11 @@ namespace Renderer {
 		
         for (int i = 0; i < timedSpheres.size(); i++)
         {
-            if (timedSpheres[i].sphere.radius <= 0 && isTimedSphereAlive(i))
-            {
-//                std::cout << "Sphere [" << i << "] has radius = " << timedSpheres[i].sphere.radius << std::endl;
+			// The aliases are packed, merged spheres are skipped without loading them
+            if (!isTimedSphereAlive(i) || timedSpheres[i].sphere.radius <= 0)
                 continue;
-            }
 			
-			if (isTimedSphereAlive(i))
-                renderSphere(timedSpheres[i].sphere.center, timedSpheres[i].sphere.radius, timedSpheres[i].sphere.color);
+            renderSphere(timedSpheres[i].sphere.center, timedSpheres[i].sphere.radius, timedSpheres[i].sphere.color);
         }
     }
 
@@ -660,99 +1090,231 @@ namespace Renderer {
 			return;
 		
 		int idx = sphereMapper[i];
-		for (auto &vertex: timedSpheres[idx].sphere.vertices)
+		for (int vertex : getSphereVertices(idx))
 			renderSphere(referenceMesh->vertices[vertex].position, 0.02 * BDDSize, Math::Vector3(0, 1, 0));
     }
 	
-	void SphereMesh::updateCost(EdgeCollapse& e)
+	// Sums the quadrics of the spheres to collapse
+	void SphereMesh::gatherCollapse(EdgeCollapse& e)
 	{
 		e.error = Quadric();
 		for(int c : e.toCollapse)
 			e.error += currentSphere(c).quadric;
+	}
+	
+	// Thiery et al. bound the radius by 3/4 of the width of the union of the regions of the spheres. The width is
+	// taken from the spheres directly, so a candidate doesn't carry a region of its own
+	Math::Scalar SphereMesh::maximumRadius(const EdgeCollapse& e)
+	{
+		if (!IMPLEMENT_THIERY_2013)
+			return DBL_MAX;
 		
-
-		if (IMPLEMENT_THIERY_2013)
+		const Region& first = currentSphere(e.toCollapse.front()).region;
+		Math::Scalar width = DBL_MAX;
+		
+		for (size_t d = 0; d < first.min.size(); d++)
 		{
-			e.region.clear();
+			Math::Scalar min = first.min[d];
+			Math::Scalar max = first.max[d];
 			for (int c : e.toCollapse)
-				e.region.unionWith(currentSphere(c).region);
+			{
+				const Region& region = currentSphere(c).region;
+				min = std::min(min, region.min[d]);
+				max = std::max(max, region.max[d]);
+			}
 			
-			e.error.getMinimumAndMinimizer(e.cost, e.centerRadius, e.region.getWidth() * (3.0 / 4.0));
-		}
-		else
-		{
-			e.error.getMinimumAndMinimizer(e.cost, e.centerRadius);
+			width = std::min(width, max - min);
 		}
-		e.cost /= (e.toCollapse.size() - 1);
+		
+		return width * (3.0 / 4.0);
 	}
 	
-	bool SphereMesh::isOutOfDate(const EdgeCollapse& e)
+	void SphereMesh::updateCost(EdgeCollapse& e)
 	{
-		for (int c : e.toCollapse)
-			if (timedSpheres[alias(c)].timestamp > e.timestamp)
-				return true;
-		
-		return false;
+		gatherCollapse(e);
+		solveCollapse(e, FLOAT_CANDIDATE_COSTS);
 	}
 	
-	bool SphereMesh::debugCheckNoLoops()
+	// Finds center, radius and cost of a collapse whose quadric is already summed. In low precision the quadric is
+	// re-centered on the first sphere and solved in float, a singular system falls back to the full precision solve
+	void SphereMesh::solveCollapse(EdgeCollapse& e, bool lowPrecision)
 	{
-		for (int i = 0; i < timedSpheres.size(); i++)
+		Math::Scalar maximumRadius = this->maximumRadius(e);
+		bool solved = false;
+		
+		if (lowPrecision)
 		{
-			if (alias(i) != i) continue;
+			const Sphere& first = currentSphere(e.toCollapse.front());
+			Math::Vector4 origin = Math::Vector4(first.center, first.radius);
 			
-			for (int j : timedSpheres[i].sphere.neighbourSpheres)
-				if (alias(j) == i)
-				{
-					std::cerr << "Loop detected between " << i << " and " << j << std::endl;
-					return false;
-				}
+			float cost;
+			float minimizer[4];
+			float maximum = maximumRadius == DBL_MAX ? FLT_MAX : static_cast<float>(maximumRadius - first.radius);
+			float minimum = static_cast<float>(0.01 - first.radius);
+			
+			solved = QuadricT<float>(e.error, origin).getMinimumAndMinimizer(cost, minimizer, maximum, minimum);
+			
+			if (solved)
+			{
+				e.cost = cost;
+				e.centerRadius = origin + Math::Vector4(minimizer[0], minimizer[1], minimizer[2], minimizer[3]);
+			}
 		}
-
-		return true;
-	}
-	
-	bool SphereMesh::normalTest(const Vertex& vA, const Vertex& vB)
-	{
-		Math::Vector3 directionAB = (vB.position - vA.position);
 		
-		bool doesAseeB = directionAB.dot(vA.normal) > 0;
-		bool doesBseeA = directionAB.dot(vB.normal) < 0;
+		if (!solved)
+			e.error.getMinimumAndMinimizer(e.cost, e.centerRadius, maximumRadius);
 		
-		return !(doesAseeB && doesBseeA);
+		e.cost /= (e.toCollapse.size() - 1);
+		
+		#pragma omp atomic
+		solvedCollapses++;
 	}
 	
-	void SphereMesh::execute(const EdgeCollapse& e)
+	// Candidates are independent of each other: once the aliases are flattened the solves only read the spheres.
+	// In full precision they go through QuadricBatch in blocks, one block per thread at a time
+	void SphereMesh::solveCandidates(std::vector<EdgeCollapse>& candidates, size_t first)
 	{
-		performedOperations++;
-		numberOfActiveSpheres -= e.toCollapse.size() - 1;
+		flattenAliases();
 		
-		int merged = alias(e.toCollapse.front());
-		for (int i : e.toCollapse)
+		if (FLOAT_CANDIDATE_COSTS)
 		{
-			timedSpheres[i].alias = merged;
-			sphereMapper.erase(timedSpheres[i].sphere.getID());
+			#pragma omp parallel for schedule(dynamic, 64)
+			for (int k = static_cast<int>(first); k < static_cast<int>(candidates.size()); k++)
+				updateCost(candidates[k]);
+			
+			return;
+		}
+		
+		const size_t unsolved = candidates.size() - std::min(first, candidates.size());
+		const auto blocks = static_cast<int>((unsolved + CANDIDATE_BLOCK - 1) / CANDIDATE_BLOCK);
+		
+		#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < blocks; k++)
+		{
+			static thread_local QuadricBatch batch;
+			
+			size_t begin = first + k * CANDIDATE_BLOCK;
+			solveCandidateBatch(candidates, begin, std::min(candidates.size(), begin + CANDIDATE_BLOCK), batch);
+		}
+	}
+	
+	// Same result as updateCost up to the rounding of FMA contraction. The quadric of a collapse of more than two
+	// spheres is split before its last sphere, so that it is summed in the same order as by gatherCollapse
+	void SphereMesh::solveCandidateBatch(std::vector<EdgeCollapse>& candidates, size_t first, size_t last,
+	                                     QuadricBatch& batch)
+	{
+		batch.clear();
+		
+		for (size_t k = first; k < last; k++)
+		{
+			EdgeCollapse& e = candidates[k];
+			Math::Scalar maximumRadius = this->maximumRadius(e);
+			const Quadric& lastQuadric = currentSphere(e.toCollapse.back()).quadric;
+			
+			if (e.toCollapse.size() == 2)
+			{
+				batch.add(currentSphere(e.toCollapse.front()).quadric, lastQuadric, maximumRadius);
+				continue;
+			}
+			
+			Quadric head;
+			for (size_t c = 0; c + 1 < e.toCollapse.size(); c++)
+				head += currentSphere(e.toCollapse[c]).quadric;
+			
+			batch.add(head, lastQuadric, maximumRadius);
+		}
+		
+		batch.solve();
+		
+		for (size_t k = first; k < last; k++)
+		{
+			EdgeCollapse& e = candidates[k];
+			
+			e.error = batch.getSum(k - first);
+			e.centerRadius = batch.getMinimizer(k - first);
+			e.cost = batch.getCost(k - first) / (e.toCollapse.size() - 1);
+		}
+		
+		#pragma omp atomic
+		solvedCollapses += static_cast<long long>(last - first);
+	}
+	
+	bool SphereMesh::isOutOfDate(const EdgeCollapse& e)
+	{
+		for (int c : e.toCollapse)
+			if (timestamps[alias(c)] > e.timestamp)
+				return true;
+		
+		return false;
+	}
+	
+	bool SphereMesh::debugCheckNoLoops()
+	{
+		for (int i = 0; i < timedSpheres.size(); i++)
+		{
+			if (alias(i) != i) continue;
+			
+			for (int j : timedSpheres[i].sphere.neighbourSpheres)
+				if (alias(j) == i)
+				{
+					std::cerr << "Loop detected between " << i << " and " << j << std::endl;
+					return false;
+				}
+		}
+
+		return true;
+	}
+	
+	bool SphereMesh::normalTest(const Vertex& vA, const Vertex& vB)
+	{
+		Math::Vector3 directionAB = (vB.position - vA.position);
+		
+		bool doesAseeB = directionAB.dot(vA.normal) > 0;
+		bool doesBseeA = directionAB.dot(vB.normal) < 0;
+		
+		return !(doesAseeB && doesBseeA);
+	}
+	
+	// Folds the spheres of a collapse into the first one. Only those spheres are written (their vertices follow through
+	// the aliases), collapses with disjoint spheres can be merged concurrently
+	int SphereMesh::mergeSpheres(const EdgeCollapse& e, int timestamp)
+	{
+		int merged = alias(e.toCollapse.front());
+		for (int i : e.toCollapse)
+		{
+			aliases[i] = merged;
 			timedSpheres[merged].sphere.neighbourSpheres += timedSpheres[i].sphere.neighbourSpheres;
-			if (merged != i)
-				for (auto& vertex : timedSpheres[i].sphere.vertices)
-					timedSpheres[merged].sphere.addVertex(referenceMesh->vertices[vertex], vertex);
+			
+			// Grown in place, the regions of all the spheres have one bound per direction
+			if (IMPLEMENT_THIERY_2013 && i != merged)
+				timedSpheres[merged].sphere.region.unionWith(timedSpheres[i].sphere.region);
 		}
 		
 		timedSpheres[merged].sphere.quadric = e.error;
 		timedSpheres[merged].sphere.center = e.centerRadius.toQuaternion().immaginary;
 		timedSpheres[merged].sphere.radius = e.centerRadius.coordinates.w;
 		
-		if (IMPLEMENT_THIERY_2013)
-			timedSpheres[merged].sphere.region = e.region;
+		timestamps[merged] = timestamp;
+		updateQuadricBound(merged);
+		return merged;
+	}
+	
+	void SphereMesh::execute(const EdgeCollapse& e)
+	{
+		performedOperations++;
+		numberOfActiveSpheres -= e.toCollapse.size() - 1;
 		
-		timedSpheres[merged].timestamp = performedOperations;
+		for (int i : e.toCollapse)
+			sphereMapper.erase(timedSpheres[i].sphere.getID());
+		
+		int merged = mergeSpheres(e, performedOperations);
 		sphereMapper[timedSpheres[merged].sphere.getID()] = merged;
 		
-		updateNeighborsOf(timedSpheres[merged].sphere);
+		updateNeighborsOf(merged);
 		
 		for (int i : timedSpheres[merged].sphere.neighbourSpheres)
 			if (i != merged && alias(i) != merged)
-				updateNeighborsOf(timedSpheres[i].sphere);
+				updateNeighborsOf(i);
 		
 		for (int i : timedSpheres[merged].sphere.neighbourSpheres)
 			addPotentialCollapse(merged, i);
@@ -760,6 +1322,53 @@ namespace Renderer {
 		debugCheckNoLoops();
 	}
 
+	// Executes collapses that share no sphere at once: the merges run in parallel, then the 1-rings of the merged
+	// spheres are rewritten in terms of the surviving spheres. Returns the merged spheres
+	std::vector<int> SphereMesh::executeConcurrently(std::vector<EdgeCollapse>& accepted)
+	{
+		for (EdgeCollapse& e : accepted)
+		{
+			e.timestamp = ++performedOperations;
+			numberOfActiveSpheres -= static_cast<int>(e.toCollapse.size()) - 1;
+			for (int c : e.toCollapse)
+				sphereMapper.erase(timedSpheres[c].sphere.getID());
+		}
+		
+		std::vector<int> merged(accepted.size());
+		
+		#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < static_cast<int>(accepted.size()); k++)
+			merged[k] = mergeSpheres(accepted[k], accepted[k].timestamp);
+		
+		std::vector<int> affected;
+		for (int m : merged)
+		{
+			sphereMapper[timedSpheres[m].sphere.getID()] = m;
+			
+			affected.push_back(m);
+			affected.insert(affected.end(), timedSpheres[m].sphere.neighbourSpheres.begin(),
+			                timedSpheres[m].sphere.neighbourSpheres.end());
+		}
+		
+		flattenAliases();
+		
+		std::sort(affected.begin(), affected.end());
+		affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+		affected.erase(std::remove_if(affected.begin(), affected.end(), [this](int i)
+		{
+			return aliases[i] != i;
+		}), affected.end());
+		
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int k = 0; k < static_cast<int>(affected.size()); k++)
+			updateNeighborsOf(affected[k]);
+		
+		if (!accepted.empty())
+			lastCollapseCost = accepted.back().cost;
+		
+		return merged;
+	}
+	
     bool SphereMesh::collapseSphereMesh()
     {
 	    return collapseSphereMesh(numberOfActiveSpheres - 1);
@@ -812,8 +1421,12 @@ namespace Renderer {
 		{
 			Vertex& v = referenceMesh->vertices[vi];
 			Math::Scalar distanceSquared = (v.position - center).squareMagnitude();
-			int si = alias(vi);
-			if (distanceSquared < radiusSquared && !includes(e.toCollapse, si))
+			if (distanceSquared >= radiusSquared)
+				continue;
+			
+			// A locked sphere stays out of the collapse even when it is engulfed
+			int si = alias(vertexOwners[vi]);
+			if (si >= 0 && !isLocked(si) && !includes(e.toCollapse, si))
 			{
 				e.toCollapse.emplace_back(si);
 				updateCost(e);
@@ -826,23 +1439,80 @@ namespace Renderer {
 
     bool SphereMesh::collapseSphereMesh(int n)
     {
+		collapseUntil(n, DBL_MAX);
+		
+        return numberOfActiveSpheres <= n;
+    }
+	
+	bool SphereMesh::collapseSphereMeshUnderError(Math::Scalar maxError, int n)
+	{
+		Math::Scalar maxDistance = maxError * BDDSize;
+		
+		return collapseUntil(n, maxDistance * maxDistance) || numberOfActiveSpheres <= n;
+	}
+	
+	// The cost of a collapse is a squared distance (the sphere quadrics are normalized by their weights), so
+	// sqrt(cost) / BDD is the relative error reported by getLastCollapseError
+	Math::Scalar SphereMesh::getLastCollapseError() const
+	{
+		return std::sqrt(std::max(lastCollapseCost, static_cast<Math::Scalar>(0))) / BDDSize;
+	}
+	
+	// Greedy collapses until n spheres are left or the cheapest valid collapse costs more than maxCost. Stale entries
+	// are skipped, so the first valid entry over the bound is the cheapest one left and the pass can stop there
+	bool SphereMesh::collapseUntil(int n, Math::Scalar maxCost)
+	{
+		bool stoppedOnCost = false;
+		
+		if (edgeQueue.isQueueDirty())
+			rebuildEdgeQueue();
+		
 	    auto start = std::chrono::high_resolution_clock::now();
-	    while (!edgeQueue.empty())
+		auto lastCheckpoint = std::chrono::steady_clock::now();
+	    while (!edgeQueue.empty() || prunedCost < DBL_MAX)
 	    {
-		    EdgeCollapse e = edgeQueue.top();
-		    edgeQueue.pop();
+			if (prunedCost < DBL_MAX && (edgeQueue.empty() || edgeQueue.topCost() > prunedCost))
+			{
+				restorePrunedCandidates();
+				continue;
+			}
+			
+		    EdgeCollapse e = edgeQueue.extractTop();
 		    
 		    if (isOutOfDate(e)) continue;
 			
+			// A lazy entry on top is solved and ranked again with its actual cost
+			if (e.lazy)
+			{
+				e.lazy = false;
+				updateCost(e);
+				edgeQueue.push(std::move(e));
+				continue;
+			}
+			
 			if (!IMPLEMENT_THIERY_2013)
 				if (engulfsAnything(e))
 				{
-					edgeQueue.push(e);
+					edgeQueue.push(std::move(e));
 					continue;
 				}
 			
+			// Candidates may have been ranked in float, the collapse that is executed is always solved in full precision
+			if (FLOAT_CANDIDATE_COSTS)
+				solveCollapse(e, false);
+			
+			if (e.cost > maxCost)
+			{
+				edgeQueue.push(std::move(e));
+				stoppedOnCost = true;
+				break;
+			}
+			
+			lastCollapseCost = e.cost;
 		    execute(e);
 			
+			saveCheckpointIfDue(lastCheckpoint);
+			
 			if (numberOfActiveSpheres <= n) break;
 	    }
 	    auto stop = std::chrono::high_resolution_clock::now();
@@ -852,144 +1522,990 @@ namespace Renderer {
 		
         updateConnectivityAfterCollapses();
 		
-        return numberOfActiveSpheres <= n;
-    }
+		return stoppedOnCost;
+	}
 
-    int SphereMesh::collapse(int i, int j)
-    {
-		int aliasI = alias(sphereMapper[i]);
-		int aliasJ = alias(sphereMapper[j]);
+	void SphereMesh::saveCheckpointIfDue(std::chrono::steady_clock::time_point& lastCheckpoint) const
+	{
+		if (CHECKPOINT_PATH.empty() ||
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - lastCheckpoint).count() < CHECKPOINT_INTERVAL)
+			return;
 		
-		if (aliasI == aliasJ)
-			return aliasI;
+		saveCheckpoint(CHECKPOINT_PATH);
+		lastCheckpoint = std::chrono::steady_clock::now();
+	}
+	
+	// Rounds of multiple-choice collapses. A round draws a random sample of the current neighbour pairs and solves
+	// it in parallel, in groups of MULTIPLE_CHOICE_SAMPLES: the best candidate of a group is its proposal. The
+	// cheapest proposals are taken in order, skipping those that share a sphere with one already taken. The cost of
+	// a collapse only depends on its own spheres, so the taken ones stay exact and are merged concurrently; the
+	// neighbourhoods are rewritten afterwards. Nothing depends on the thread count, the same seed always gives the
+	// same sphere mesh
+	bool SphereMesh::collapseSphereMeshMultipleChoice(int n, unsigned int seed)
+	{
+		// A round proposes this many collapses for every one it may take
+		constexpr size_t MULTIPLE_CHOICE_PROPOSALS_PER_COLLAPSE = 4;
 		
-		EdgeCollapse e = EdgeCollapse(aliasI, aliasJ, performedOperations);
-	    updateCost(e);
+		// A checkpoint doesn't hold the state of the generator, a resumed run would draw other samples
+		if (!CHECKPOINT_PATH.empty())
+			std::cerr << "The multiple-choice scheduler doesn't save checkpoints, CHECKPOINT_PATH is ignored" << std::endl;
 		
-	    execute(e);
-	    updateConnectivityAfterCollapses();
+		std::mt19937 generator(seed);
+		const int samples = std::max(1, MULTIPLE_CHOICE_SAMPLES);
 		
-		return aliasI;
-    }
-	
-	void SphereMesh::saveYAML(const std::string& path, const std::string& fn)
-    {
-        YAML::Emitter out;
-
-        out << YAML::Comment("Sphere Mesh YAML @ author Davide Paolillo");
-        out << YAML::BeginMap;
-            out << YAML::Key << "Reference Mesh" << YAML::Value << referenceMesh->path;
-            out << YAML::Key << "Sphere Mesh Resolution" << YAML::Value << numberOfActiveSpheres;
-            out << YAML::Key << "Performed Operations" << YAML::Value << performedOperations;
-            out << YAML::Key << "Number of Active Spheres" << YAML::Value << numberOfActiveSpheres;
-            out << YAML::Key << "Spheres" << YAML::Value;
-            out << YAML::BeginSeq;
-                for (auto & i : timedSpheres)
-                {
-                    out << YAML::BeginMap;
-                        out << YAML::Key << "Center" << YAML::Value;
-                        YAMLSerializeVector3(out, i.sphere.center);
-                        out << YAML::Key << "Radius" << YAML::Value << i.sphere.radius;
-                        out << YAML::Key << "Quadric" << YAML::Value;
-                        YAMLSerializeQuadric(out, i.sphere.quadric);
-                        out << YAML::Key << "Color" << YAML::Value;
-                        YAMLSerializeVector3(out, i.sphere.color);
-						out << YAML::Key << "Alias" << YAML::Value << i.alias;
-						out << YAML::Key << "Neighbours" << YAML::Value;
-						out << YAML::BeginSeq;
-						for (int j : i.sphere.neighbourSpheres)
-							out << j;
-						out << YAML::EndSeq;
-						out << YAML::Key << "Vertices" << YAML::Value;
-						out << YAML::BeginSeq;
-						for (auto & vertex : i.sphere.vertices)
-							out << vertex;
-						out << YAML::EndSeq;
-						out << YAML::Key << "Quadric Weights" << YAML::Value << i.sphere.quadricWeights;
-                    out << YAML::EndMap;
-                }
-            out << YAML::EndSeq;
-            out << YAML::Key << "Connectivity" << YAML::Value;
-            out << YAML::BeginMap;
-                out << YAML::Key << "Edges" << YAML::Value;
-                out << YAML::BeginSeq;
-                    for (auto & i : edge)
-                    {
-                        out << YAML::BeginMap;
-                            out << YAML::Key << "E0" << YAML::Value << i.i;
-                            out << YAML::Key << "E1" << YAML::Value << i.j;
-                        out << YAML::EndMap;
-                    }
-                out << YAML::EndSeq;
-                out << YAML::Key << "Triangles" << YAML::Value;
-                out << YAML::BeginSeq;
-                    for (auto & i : triangle)
-                    {
-                        out << YAML::BeginMap;
-                            out << YAML::Key << "T0" << YAML::Value << i.i;
-                            out << YAML::Key << "T1" << YAML::Value << i.j;
-                            out << YAML::Key << "T2" << YAML::Value << i.k;
-                        out << YAML::EndMap;
-                    }
-                out << YAML::EndSeq;
-            out << YAML::EndMap;
-        out << YAML::EndMap;
-
-        namespace fs = std::__fs::filesystem;
-
-        fs::path cwd = fs::current_path();
-
-        std::string separator = std::string(1, fs::path::preferred_separator);
-
-        const std::string& filePath = fn;
-        std::string folderPath = "." + separator;
-        if (path != ".")
-            folderPath = path;
-
-        std::ofstream fout(folderPath + filePath);
-        std::cout << "File location: " << folderPath + filePath << std::endl;
-        fout << out.c_str();
-        fout.close();
-    }
-
-    void SphereMesh::loadFromYaml(const std::string& path)
-    {
-        triangle.clear();
-        edge.clear();
-        timedSpheres.clear();
-		sphereMapper.clear();
-        
-        std::ifstream stream(path);
-        std::stringstream strStream;
-        strStream << stream.rdbuf();
-
-        YAML::Node data = YAML::Load(strStream.str());
+		std::vector<int> member(timedSpheres.size(), -1);
 		
-		performedOperations = data["Performed Operations"].as<int>();
-		numberOfActiveSpheres = data["Number of Active Spheres"].as<int>();
+		// Per round buffers, cleared at the start of every round but never freed
+		std::vector<Pair> pairs;
+		std::vector<EdgeCollapse> candidates, proposals, accepted;
 		
-		int i = 0;
-        for (const auto& node : data["Spheres"]) {
-            Sphere s;
-            
-            s.center = node["Center"].as<Math::Vector3>();
-            s.radius = node["Radius"].as<Math::Scalar>();
-            s.quadric = node["Quadric"].as<Renderer::Quadric>();
-            s.color = node["Color"].as<Math::Vector3>();
-			s.quadricWeights = node["Quadric Weights"].as<Math::Scalar>();
-			s.vertices.clear();
-			for (const auto& vertex : node["Vertices"])
-				s.addVertex(referenceMesh->vertices[vertex.as<int>()], vertex.as<int>());
-			s.neighbourSpheres.clear();
-			for (const auto& neighbour : node["Neighbours"])
-				s.neighbourSpheres.insert(neighbour.as<int>());
-
-            timedSpheres.emplace_back(Sphere(s), node["Alias"].as<int>(), performedOperations);
-			sphereMapper[s.getID()] = i++;
-        }
-        
-        for (const auto& node : data["Connectivity"]["Triangles"]) {
-            Triangle t;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int round = 0; numberOfActiveSpheres > n; round++)
+		{
+			flattenAliases();
+			
+			pairs.clear();
+			for (int i = 0; i < timedSpheres.size(); i++)
+				if (aliases[i] == i && !isLocked(i))
+					for (int j : timedSpheres[i].sphere.neighbourSpheres)
+						if (i > alias(j) && !isLocked(alias(j)))
+							pairs.emplace_back(i, alias(j));
+			
+			if (pairs.empty())
+				break;
+			
+			auto collapses = static_cast<size_t>(std::ceil(numberOfActiveSpheres * MULTIPLE_CHOICE_ROUND_FRACTION));
+			collapses = std::clamp<size_t>(collapses, 1, static_cast<size_t>(numberOfActiveSpheres - n));
+			
+			const size_t groups = collapses * MULTIPLE_CHOICE_PROPOSALS_PER_COLLAPSE;
+			
+			const size_t sampled = std::min(pairs.size(), groups * samples);
+			
+			// Partial Fisher-Yates: only the sampled prefix has to be random
+			for (size_t k = 0; k < sampled; k++)
+				std::swap(pairs[k], pairs[std::uniform_int_distribution<size_t>(k, pairs.size() - 1)(generator)]);
+			
+			candidates.clear();
+			candidates.reserve(sampled);
+			for (size_t k = 0; k < sampled; k++)
+				candidates.emplace_back(pairs[k].i, pairs[k].j, performedOperations);
+			
+			solveCandidates(candidates);
+			
+			proposals.clear();
+			for (size_t first = 0; first < candidates.size(); first += samples)
+			{
+				auto last = candidates.begin() + static_cast<long>(std::min(candidates.size(), first + samples));
+				proposals.push_back(std::move(*std::min_element(candidates.begin() + static_cast<long>(first), last)));
+			}
+			
+			// Same checks as the greedy loop before a collapse is executed
+			#pragma omp parallel for schedule(dynamic)
+			for (int p = 0; p < static_cast<int>(proposals.size()); p++)
+			{
+				if (!IMPLEMENT_THIERY_2013)
+					while (engulfsAnything(proposals[p])) {}
+				
+				if (FLOAT_CANDIDATE_COSTS)
+					solveCollapse(proposals[p], false);
+			}
+			
+			// Only the cheapest proposals are kept, a round doesn't reach far up the cost distribution
+			std::stable_sort(proposals.begin(), proposals.end());
+			proposals.resize(std::min(proposals.size(), collapses));
+			
+			accepted.clear();
+			int remaining = numberOfActiveSpheres;
+			for (EdgeCollapse& e : proposals)
+			{
+				int collapsed = static_cast<int>(e.toCollapse.size()) - 1;
+				if (remaining - collapsed < n)
+					continue;
+				
+				if (std::any_of(e.toCollapse.begin(), e.toCollapse.end(), [&](int c) { return member[c] == round; }))
+					continue;
+				
+				for (int c : e.toCollapse)
+					member[c] = round;
+				
+				remaining -= collapsed;
+				accepted.push_back(std::move(e));
+			}
+			
+			// Like the greedy loop, a collapse that engulfed spheres may overshoot n when nothing else is left
+			if (accepted.empty())
+				accepted.push_back(std::move(proposals.front()));
+			
+			executeConcurrently(accepted);
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+		lastCollapseDuration = std::to_string(duration.count() / 1e6);
+		
+		// The queue still holds the costs from before these collapses
+		edgeQueue.setQueueDirty();
+		
+		updateConnectivityAfterCollapses();
+		
+		return numberOfActiveSpheres <= n;
+	}
+	
+	// Greedy collapses in batches. Valid entries are popped as usual while they cost at most BATCH_COST_SLACK more than
+	// the first one of the batch, and taken if their closed 1-ring shares no sphere with the ones already taken; the
+	// others go back in the queue for the next batch. The batch is merged concurrently, then the collapses around the
+	// merged spheres are queued (lazily, or solved in parallel). Selection is serial, so the result doesn't depend on
+	// the thread count, and with BATCH_SIZE 1 it is the greedy order
+	bool SphereMesh::collapseSphereMeshBatched(int n)
+	{
+		if (edgeQueue.isQueueDirty())
+			rebuildEdgeQueue();
+		
+		// A batch stops looking after this many conflicting entries for every collapse it may take
+		constexpr size_t BATCH_ENTRIES_PER_COLLAPSE = 4;
+		
+		const size_t batchSize = std::max(1, BATCH_SIZE);
+		const Math::Scalar slack = BATCH_COST_SLACK * BDDSize;
+		
+		std::vector<int> reserved(timedSpheres.size(), -1);
+		
+		// Per batch buffers, cleared at the start of every batch but never freed, so a batch only allocates while
+		// they grow
+		std::vector<EdgeCollapse> selected, deferred, accepted, candidates;
+		std::vector<char> engulfs;
+		
+		auto start = std::chrono::high_resolution_clock::now();
+		auto lastCheckpoint = std::chrono::steady_clock::now();
+		for (int batch = 0; numberOfActiveSpheres > n && (!edgeQueue.empty() || prunedCost < DBL_MAX); batch++)
+		{
+			flattenAliases();
+			
+			auto isReserved = [&](int c)
+			{
+				if (reserved[c] == batch)
+					return true;
+				
+				const set_of_int& ring = timedSpheres[c].sphere.neighbourSpheres;
+				return std::any_of(ring.begin(), ring.end(), [&](int j) { return reserved[alias(j)] == batch; });
+			};
+			
+			selected.clear();
+			deferred.clear();
+			Math::Scalar maxCost = DBL_MAX;
+			int remaining = numberOfActiveSpheres;
+			
+			while (selected.size() < batchSize && deferred.size() < batchSize * BATCH_ENTRIES_PER_COLLAPSE)
+			{
+				// Nothing past the pruning bound is taken before the pruned pairs are back in the queue
+				if (prunedCost < maxCost && (edgeQueue.empty() || edgeQueue.topCost() > prunedCost))
+					restorePrunedCandidates();
+				
+				if (edgeQueue.empty() || edgeQueue.topCost() > maxCost)
+					break;
+				
+				EdgeCollapse e = edgeQueue.extractTop();
+				
+				if (isOutOfDate(e)) continue;
+				
+				if (e.lazy)
+				{
+					e.lazy = false;
+					updateCost(e);
+					edgeQueue.push(std::move(e));
+					continue;
+				}
+				
+				if (selected.empty())
+					maxCost = e.cost + slack * slack;
+				
+				int collapsed = static_cast<int>(e.toCollapse.size()) - 1;
+				if (!selected.empty() && (remaining - collapsed < n ||
+				                          std::any_of(e.toCollapse.begin(), e.toCollapse.end(), isReserved)))
+				{
+					deferred.push_back(std::move(e));
+					continue;
+				}
+				
+				for (int c : e.toCollapse)
+				{
+					reserved[c] = batch;
+					for (int j : timedSpheres[c].sphere.neighbourSpheres)
+						reserved[alias(j)] = batch;
+				}
+				
+				remaining -= collapsed;
+				selected.push_back(std::move(e));
+			}
+			
+			// Same checks as the greedy loop, a collapse that engulfs a sphere goes back in the queue with its new cost
+			engulfs.assign(selected.size(), false);
+			
+			#pragma omp parallel for schedule(dynamic)
+			for (int k = 0; k < static_cast<int>(selected.size()); k++)
+			{
+				if (!IMPLEMENT_THIERY_2013)
+					engulfs[k] = engulfsAnything(selected[k]);
+				
+				if (!engulfs[k] && FLOAT_CANDIDATE_COSTS)
+					solveCollapse(selected[k], false);
+			}
+			
+			accepted.clear();
+			for (int k = 0; k < static_cast<int>(selected.size()); k++)
+				if (engulfs[k])
+					deferred.push_back(std::move(selected[k]));
+				else
+					accepted.push_back(std::move(selected[k]));
+			
+			for (EdgeCollapse& e : deferred)
+				edgeQueue.push(std::move(e));
+			
+			std::vector<int> merged = executeConcurrently(accepted);
+			
+			candidates.clear();
+			for (int m : merged)
+				for (int i : timedSpheres[m].sphere.neighbourSpheres)
+					if (!isLocked(i))
+						candidates.emplace_back(m, i, performedOperations);
+			
+			if (LAZY_COLLAPSE_COSTS)
+				for (EdgeCollapse& e : candidates)
+				{
+					e.cost = collapseCostBound(e.toCollapse.front(), e.toCollapse.back());
+					e.lazy = true;
+				}
+			else
+				solveCandidates(candidates);
+			
+			for (EdgeCollapse& e : candidates)
+				edgeQueue.push(std::move(e));
+			
+			saveCheckpointIfDue(lastCheckpoint);
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+		lastCollapseDuration = std::to_string(duration.count() / 1e6);
+		
+		updateConnectivityAfterCollapses();
+		
+		return numberOfActiveSpheres <= n;
+	}
+	
+	int SphereMesh::getQueueSize()
+	{
+		return edgeQueue.size();
+	}
+	
+	long long SphereMesh::getSolvedCollapses() const
+	{
+		return solvedCollapses;
+	}
+	
+	Math::Scalar SphereMesh::getQuadricError() const
+	{
+		Math::Scalar error = 0;
+		for (int i = 0; i < timedSpheres.size(); i++)
+			if (aliases[i] == i)
+			{
+				const Sphere& s = timedSpheres[i].sphere;
+				error += s.quadric.evaluateSQEM(Math::Vector4(s.center, s.radius));
+			}
+		
+		return error;
+	}
+
+	// The initial quadrics of initialVertexQuadric on the pose positions, with the curvature of the reference pose;
+	// the vertex normals are the area weighted face normals of the pose. Every sphere is refitted to the sum of the
+	// quadrics of its vertices, which is what the collapses of the reference built up
+	std::vector<Math::Vector4> SphereMesh::fitPose(const std::vector<Math::Vector3>& positions,
+	                                               const std::vector<int>& spheres) const
+	{
+		std::vector<Vertex> posed = referenceMesh->vertices;
+		std::vector<Math::Vector3> normals(positions.size(), Math::Vector3(0, 0, 0));
+		
+		for (const Face& f : referenceMesh->faces)
+		{
+			Math::Vector3 areaNormal = (positions[f.j] - positions[f.i]).cross(positions[f.k] - positions[f.i]);
+			for (int v : {f.i, f.j, f.k})
+				normals[v] += areaNormal;
+		}
+		
+		for (size_t v = 0; v < positions.size(); v++)
+		{
+			posed[v].position = positions[v];
+			if (normals[v].magnitude() > 0)
+				posed[v].normal = normals[v].normalized();
+		}
+		
+		std::vector<Math::Vector4> fitted;
+		fitted.reserve(spheres.size());
+		
+		for (int s : spheres)
+		{
+			const std::vector<int>& sphereVertices = editState.sphereVertices[s];
+			
+			Quadric q;
+			for (int v : sphereVertices)
+				q += initialVertexQuadric(posed, v);
+			
+			if (sphereVertices.size() == 1)
+				fitted.push_back(q.minimizer(0.001));
+			else
+			{
+				Math::Scalar cost;
+				Math::Vector4 centerRadius;
+				q.getMinimumAndMinimizer(cost, centerRadius, IMPLEMENT_THIERY_2013 ?
+				                         timedSpheres[s].sphere.region.getWidth() * (3.0 / 4.0) : DBL_MAX);
+				fitted.push_back(centerRadius);
+			}
+		}
+		
+		return fitted;
+	}
+	
+	std::vector<std::vector<Math::Vector4>> SphereMesh::refitToPoses(const std::vector<std::vector<Math::Vector3>>& poses)
+	{
+		if (CURVATURE_SIGMA != 0)
+			referenceMesh->ensureCurvature();
+		
+		std::vector<int> spheres;
+		for (int i = 0; i < timedSpheres.size(); i++)
+			if (isTimedSphereAlive(i))
+				spheres.push_back(i);
+		
+		prepareEditState();
+		
+		std::vector<std::vector<Math::Vector4>> fitted(poses.size());
+		
+		#pragma omp parallel for schedule(dynamic)
+		for (int p = 0; p < static_cast<int>(poses.size()); p++)
+			if (poses[p].size() == referenceMesh->vertices.size())
+			{
+				if (!referenceMesh->isSpatiallyOrdered())
+				{
+					fitted[p] = fitPose(poses[p], spheres);
+					continue;
+				}
+				
+				std::vector<Math::Vector3> positions(poses[p].size());
+				for (size_t v = 0; v < positions.size(); v++)
+					positions[v] = poses[p][referenceMesh->toFileIndex(static_cast<int>(v))];
+				
+				fitted[p] = fitPose(positions, spheres);
+			}
+		
+		return fitted;
+	}
+	
+	namespace
+	{
+		// Vertex on the envelope: the spheres of its closest primitive, their weights at the closest point and the
+		// direction from the sphere interpolated there to the vertex. The distance is linear in the sphere parameters
+		// for a fixed direction: d = n.p - sum w (n.c + r)
+		struct RefinementSample
+		{
+			int count{0};
+			int spheres[3]{-1, -1, -1};
+			Math::Scalar weights[3]{0, 0, 0};
+			Math::Vector3 direction;
+		};
+		
+		// Assigns every vertex to its closest primitive, returns the mean squared distance weighted by the areas
+		Math::Scalar assignToEnvelope(const std::vector<Vertex>& vertices, const std::vector<Math::Scalar>& areas,
+		                              const SphereMeshBVH& bvh, std::vector<RefinementSample>& samples)
+		{
+			const int n = static_cast<int>(vertices.size());
+			samples.resize(n);
+			
+			Math::Scalar sumSquared = 0;
+			
+			#pragma omp parallel for schedule(dynamic, 1024) reduction(+:sumSquared)
+			for (int v = 0; v < n; v++)
+			{
+				const Math::Vector3& p = vertices[v].position;
+				EnvelopeHit hit = bvh.closest(p);
+				sumSquared += areas[v] * hit.distance * hit.distance;
+				
+				const EnvelopePrimitive& primitive = bvh.primitives[hit.primitive];
+				RefinementSample& sample = samples[v];
+				sample.count = primitive.count;
+				
+				Math::Vector3 center(0, 0, 0);
+				for (int k = 0; k < primitive.count; k++)
+				{
+					sample.spheres[k] = primitive.spheres[k];
+					sample.weights[k] = hit.weights[k];
+					center += primitive.centers[k] * hit.weights[k];
+				}
+				
+				sample.direction = p - center;
+				Math::Scalar length = sample.direction.magnitude();
+				if (length > 0)
+					sample.direction /= length;
+			}
+			
+			return sumSquared;
+		}
+	}
+	
+	// Every sphere is solved with the others held where the previous iteration left them, so the spheres sharing a
+	// vertex all try to close its whole distance: the step toward the solved spheres is halved until the energy goes
+	// down, and the pass stops when no step does
+	std::vector<SphereMesh::RefinementIteration> SphereMesh::refineSpheres(int maxIterations, Math::Scalar threshold)
+	{
+		constexpr int STEP_HALVINGS = 4;
+		
+		std::vector<RefinementIteration> iterations;
+		const std::vector<Vertex>& vertices = referenceMesh->vertices;
+		if (vertices.empty() || numberOfActiveSpheres == 0)
+			return iterations;
+		
+		auto start = std::chrono::steady_clock::now();
+		auto elapsed = [&start]()
+		{
+			auto now = std::chrono::steady_clock::now();
+			double seconds = std::chrono::duration<double>(now - start).count();
+			start = now;
+			return seconds;
+		};
+		
+		// A third of the area of the faces around every vertex, so that the fit follows the surface rather than the
+		// density of the vertices; the weights add up to 1
+		std::vector<Math::Scalar> areas(vertices.size(), 0);
+		Math::Scalar totalArea = 0;
+		for (const Face& f : referenceMesh->faces)
+		{
+			const Math::Vector3& v0 = vertices[f.i].position;
+			Math::Scalar area = 0.5 * (vertices[f.j].position - v0).cross(vertices[f.k].position - v0).magnitude();
+			for (int v : {f.i, f.j, f.k})
+				areas[v] += area / 3;
+			totalArea += area;
+		}
+		
+		for (Math::Scalar& area : areas)
+			area = totalArea > 0 ? area / totalArea : 1.0 / static_cast<Math::Scalar>(vertices.size());
+		
+		SphereMeshBVH bvh;
+		std::vector<RefinementSample> samples;
+		
+		bvh.build(*this);
+		if (bvh.empty())
+			return iterations;
+		
+		Math::Scalar energy = assignToEnvelope(vertices, areas, bvh, samples);
+		iterations.push_back({std::sqrt(energy) / BDDSize, 0, elapsed()});
+		
+		const int n = static_cast<int>(timedSpheres.size());
+		std::vector<int> offsets, entries;
+		std::vector<Math::Vector4> current(n), solved(n);
+		
+		for (int iteration = 0; iteration < maxIterations && energy > 0; iteration++)
+		{
+			// Samples of every sphere as (sample, slot) pairs
+			offsets.assign(n + 1, 0);
+			for (const RefinementSample& s : samples)
+				for (int k = 0; k < s.count; k++)
+					offsets[s.spheres[k] + 1]++;
+			
+			for (int i = 0; i < n; i++)
+				offsets[i + 1] += offsets[i];
+			
+			entries.resize(2 * offsets[n]);
+			std::vector<int> next(offsets.begin(), offsets.end() - 1);
+			for (int v = 0; v < static_cast<int>(samples.size()); v++)
+				for (int k = 0; k < samples[v].count; k++)
+				{
+					int e = next[samples[v].spheres[k]]++;
+					entries[2 * e] = v;
+					entries[2 * e + 1] = k;
+				}
+			
+			for (int i = 0; i < n; i++)
+				current[i] = Math::Vector4(timedSpheres[i].sphere.center, timedSpheres[i].sphere.radius);
+			
+			// Least squares over the sample distances of a sphere, written as a quadric so that it is minimized within
+			// the radius bounds of a collapse
+			#pragma omp parallel for schedule(dynamic, 64)
+			for (int i = 0; i < n; i++)
+			{
+				solved[i] = current[i];
+				if (offsets[i] == offsets[i + 1])
+					continue;
+				
+				Quadric fit;
+				Math::Scalar area = 0;
+				for (int e = offsets[i]; e < offsets[i + 1]; e++)
+				{
+					const int v = entries[2 * e];
+					const RefinementSample& s = samples[v];
+					const int slot = entries[2 * e + 1];
+					const Math::Vector3& direction = s.direction;
+					
+					Math::Scalar target = direction.dot(vertices[v].position);
+					for (int k = 0; k < s.count; k++)
+						if (k != slot)
+							target -= s.weights[k] * current[s.spheres[k]].dot(Math::Vector4(direction, 1));
+					
+					Math::Vector4 row = Math::Vector4(direction, 1) * s.weights[slot];
+					for (int r = 0; r < 4; r++)
+						for (int c = 0; c < 4; c++)
+							fit.A.data[4 * r + c] += areas[v] * row[r] * row[c];
+					fit.b += row * (-2 * areas[v] * target);
+					fit.c += areas[v] * target * target;
+					area += areas[v];
+				}
+				
+				Math::Scalar damping = REFINEMENT_DAMPING * area;
+				if (damping <= 0)
+					continue;
+				
+				for (int r = 0; r < 4; r++)
+					fit.A.data[5 * r] += damping;
+				fit.b += current[i] * (-2 * damping);
+				fit.c += damping * current[i].dot(current[i]);
+				
+				const Sphere& sphere = timedSpheres[i].sphere;
+				Math::Scalar cost;
+				fit.getMinimumAndMinimizer(cost, solved[i], IMPLEMENT_THIERY_2013 ? sphere.region.getWidth() * (3.0 / 4.0) : DBL_MAX);
+			}
+			
+			Math::Scalar step = 1;
+			Math::Scalar stepEnergy = energy;
+			for (int halving = 0; halving <= STEP_HALVINGS; halving++, step /= 2)
+			{
+				for (int i = 0; i < n; i++)
+				{
+					Math::Vector4 sphere = current[i] + (solved[i] - current[i]) * step;
+					timedSpheres[i].sphere.center = sphere.toQuaternion().immaginary;
+					timedSpheres[i].sphere.radius = sphere.coordinates.w;
+				}
+				
+				bvh.build(*this);
+				stepEnergy = assignToEnvelope(vertices, areas, bvh, samples);
+				if (stepEnergy < energy)
+					break;
+			}
+			
+			if (stepEnergy >= energy)
+			{
+				for (int i = 0; i < n; i++)
+				{
+					timedSpheres[i].sphere.center = current[i].toQuaternion().immaginary;
+					timedSpheres[i].sphere.radius = current[i].coordinates.w;
+				}
+				break;
+			}
+			
+			Math::Scalar decrease = (energy - stepEnergy) / energy;
+			energy = stepEnergy;
+			iterations.push_back({std::sqrt(energy) / BDDSize, step, elapsed()});
+			
+			if (decrease < threshold)
+				break;
+		}
+		
+		return iterations;
+	}
+	
+    int SphereMesh::collapse(int i, int j)
+    {
+		int aliasI = alias(sphereMapper[i]);
+		int aliasJ = alias(sphereMapper[j]);
+		
+		if (aliasI == aliasJ)
+			return aliasI;
+		
+		EdgeCollapse e = EdgeCollapse(aliasI, aliasJ, performedOperations);
+	    updateCost(e);
+		
+		if (FLOAT_CANDIDATE_COSTS)
+			solveCollapse(e, false);
+		
+	    execute(e);
+	    updateConnectivityAfterCollapses();
+		
+		return aliasI;
+    }
+	
+	void SphereMesh::prepareEditState()
+	{
+		const std::vector<Face>& faces = referenceMesh->faces;
+		const int vertexCount = static_cast<int>(referenceMesh->vertices.size());
+		
+		if (static_cast<int>(editState.faceOffsets.size()) != vertexCount + 1)
+		{
+			std::vector<int>& offsets = editState.faceOffsets;
+			offsets.assign(vertexCount + 1, 0);
+			for (const Face& f : faces)
+				for (int v : {f.i, f.j, f.k})
+					offsets[v + 1]++;
+			
+			for (int v = 0; v < vertexCount; v++)
+				offsets[v + 1] += offsets[v];
+			
+			editState.faces.resize(offsets.back());
+			std::vector<int> next(offsets.begin(), offsets.end() - 1);
+			for (int f = 0; f < static_cast<int>(faces.size()); f++)
+				for (int v : {faces[f].i, faces[f].j, faces[f].k})
+					editState.faces[next[v]++] = f;
+		}
+		
+		if (editState.operation == performedOperations && editState.sphereVertices.size() == timedSpheres.size())
+			return;
+		
+		std::vector<int> vertexOffsets, sphereVertices;
+		gatherSphereVertices(vertexOffsets, sphereVertices);
+		
+		editState.sphereVertices.resize(timedSpheres.size());
+		for (size_t i = 0; i < timedSpheres.size(); i++)
+			editState.sphereVertices[i].assign(sphereVertices.begin() + vertexOffsets[i],
+			                                   sphereVertices.begin() + vertexOffsets[i + 1]);
+		
+		editState.operation = performedOperations;
+	}
+	
+	// Same sums in the same order as computeSpheresProperties and updateSpheres
+	Quadric SphereMesh::initialVertexQuadric(int v) const
+	{
+		return initialVertexQuadric(referenceMesh->vertices, v);
+	}
+	
+	Quadric SphereMesh::initialVertexQuadric(const std::vector<Vertex>& vertices, int v) const
+	{
+		const Math::Scalar sigma = CURVATURE_SIGMA;
+		
+		Quadric quadric;
+		Math::Scalar weights = 0;
+		if (!IMPLEMENT_THIERY_2013)
+		{
+			quadric = Quadric::initializeQuadricFromVertex(vertices[v], 0.01 * BDDSize) * 1e-6;
+			weights = 1e-6;
+		}
+		
+		for (int k = editState.faceOffsets[v]; k < editState.faceOffsets[v + 1]; k++)
+		{
+			Math::Scalar weight;
+			quadric += faceQuadric(vertices, referenceMesh->faces[editState.faces[k]], sigma, weight);
+			weights += weight;
+		}
+		
+		quadric *= (1 / weights);
+		return quadric;
+	}
+	
+	// Nearest is by distance from the sphere surface, a tie keeps the vertex where it is. A sphere that would lose
+	// all of its vertices keeps them, so every sphere still has a quadric. The edit counts as an operation: the
+	// spheres it changed get its timestamp, which puts their queued collapses out of date
+	void SphereMesh::updateAfterEdit(int sphereID)
+	{
+		auto found = sphereMapper.find(sphereID);
+		if (found == sphereMapper.end())
+			return;
+		
+		const int edited = alias(found->second);
+		if (edited < 0)
+			return;
+		
+		prepareEditState();
+		updateNeighborsOf(edited);
+		
+		std::vector<int> ring{edited};
+		ring.insert(ring.end(), timedSpheres[edited].sphere.neighbourSpheres.begin(),
+		            timedSpheres[edited].sphere.neighbourSpheres.end());
+		std::sort(ring.begin() + 1, ring.end());
+		
+		const std::vector<Vertex>& vertices = referenceMesh->vertices;
+		auto distance = [&](int s, int v)
+		{
+			const Sphere& sphere = timedSpheres[s].sphere;
+			return (vertices[v].position - sphere.center).magnitude() - sphere.radius;
+		};
+		
+		// Vertex and the sphere it goes to
+		std::vector<std::pair<int, int>> moves;
+		for (int s : ring)
+		{
+			const size_t first = moves.size();
+			for (int v : editState.sphereVertices[s])
+			{
+				int nearest = s;
+				Math::Scalar nearestDistance = distance(s, v);
+				for (int t : ring)
+				{
+					Math::Scalar d = distance(t, v);
+					if (d < nearestDistance)
+					{
+						nearest = t;
+						nearestDistance = d;
+					}
+				}
+				
+				if (nearest != s)
+					moves.emplace_back(v, nearest);
+			}
+			
+			if (moves.size() - first == editState.sphereVertices[s].size())
+				moves.resize(first);
+		}
+		
+		if (moves.empty())
+			return;
+		
+		std::unordered_map<int, int> destination(moves.begin(), moves.end());
+		std::vector<int> changed;
+		for (int s : ring)
+			if (std::any_of(moves.begin(), moves.end(), [&](const auto& m) { return m.second == s || alias(vertexOwners[m.first]) == s; }))
+				changed.push_back(s);
+		
+		// The part of the connectivity that comes from the faces around the vertices of the changed spheres
+		auto forEachFaceOf = [&](const auto& visit)
+		{
+			for (int s : changed)
+				for (int v : editState.sphereVertices[s])
+					for (int k = editState.faceOffsets[v]; k < editState.faceOffsets[v + 1]; k++)
+					{
+						const Face& f = referenceMesh->faces[editState.faces[k]];
+						Triangle owners(alias(vertexOwners[f.i]), alias(vertexOwners[f.j]), alias(vertexOwners[f.k]));
+						if (owners.i >= 0)
+							visit(owners);
+					}
+		};
+		
+		// Dropped before the vertices move: a face may no longer join the spheres it joined, and the changed spheres
+		// only keep the neighbours they share a face with once the vertices are where they go
+		forEachFaceOf([&](const Triangle& owners)
+		{
+			if (owners.i == owners.k)
+				return;
+			else if (owners.i == owners.j || owners.j == owners.k)
+				edge.erase(Edge(owners.i, owners.k));
+			else
+				triangle.erase(owners);
+		});
+		
+		for (int s : changed)
+		{
+			set_of_int& neighbours = timedSpheres[s].sphere.neighbourSpheres;
+			for (int t : neighbours)
+			{
+				int a = alias(t);
+				if (a < 0)
+					continue;
+				
+				updateNeighborsOf(a);
+				timedSpheres[a].sphere.neighbourSpheres.erase(s);
+			}
+			neighbours.clear();
+		}
+		
+		for (int s : changed)
+		{
+			std::vector<int>& sphereVertices = editState.sphereVertices[s];
+			sphereVertices.erase(std::remove_if(sphereVertices.begin(), sphereVertices.end(), [&](int v)
+			{
+				return destination.count(v) != 0;
+			}), sphereVertices.end());
+			
+			for (const auto& [v, t] : moves)
+				if (t == s)
+					sphereVertices.push_back(v);
+		}
+		
+		for (const auto& [v, t] : moves)
+			vertexOwners[v] = t;
+		
+		const int timestamp = ++performedOperations;
+		
+		for (int s : changed)
+		{
+			Sphere& sphere = timedSpheres[s].sphere;
+			
+			sphere.quadric = Quadric();
+			for (int v : editState.sphereVertices[s])
+				sphere.quadric += initialVertexQuadric(v);
+			
+			if (IMPLEMENT_THIERY_2013)
+			{
+				sphere.region.clear();
+				for (int v : editState.sphereVertices[s])
+				{
+					Region point;
+					point.setAsPoint(vertices[v].position);
+					sphere.region.unionWith(point);
+				}
+			}
+			
+			if (s != edited)
+			{
+				Math::Scalar cost;
+				Math::Vector4 centerRadius;
+				if (editState.sphereVertices[s].size() == 1)
+					centerRadius = sphere.quadric.minimizer(0.001);
+				else
+					sphere.quadric.getMinimumAndMinimizer(cost, centerRadius, IMPLEMENT_THIERY_2013 ? sphere.region.getWidth() * (3.0 / 4.0) : DBL_MAX);
+				
+				sphere.center = centerRadius.toQuaternion().immaginary;
+				sphere.radius = centerRadius.coordinates.w;
+			}
+			
+			timestamps[s] = timestamp;
+			updateQuadricBound(s);
+		}
+		
+		// Spheres that now share a face become neighbours, and the face part of the connectivity
+		forEachFaceOf([&](const Triangle& owners)
+		{
+			for (auto [a, b] : {std::pair(owners.i, owners.j), std::pair(owners.j, owners.k), std::pair(owners.i, owners.k)})
+				if (a != b)
+				{
+					timedSpheres[a].sphere.addNeighbourSphere(b);
+					timedSpheres[b].sphere.addNeighbourSphere(a);
+				}
+			
+			if (owners.i == owners.k)
+				return;
+			else if (owners.i == owners.j || owners.j == owners.k)
+				edge.insert(Edge(owners.i, owners.k));
+			else
+				triangle.insert(owners);
+		});
+		
+		for (int s : changed)
+		{
+			updateNeighborsOf(s);
+			for (int t : timedSpheres[s].sphere.neighbourSpheres)
+				if (!(t < s && includes(changed, t)))
+					addPotentialCollapse(s, t);
+		}
+		
+		editState.operation = performedOperations;
+	}
+	
+	void SphereMesh::saveYAML(const std::string& path, const std::string& fn)
+    {
+        YAML::Emitter out;
+
+        out << YAML::Comment("Sphere Mesh YAML @ author Davide Paolillo");
+        out << YAML::BeginMap;
+            out << YAML::Key << "Reference Mesh" << YAML::Value << referenceMesh->path;
+            out << YAML::Key << "Sphere Mesh Resolution" << YAML::Value << numberOfActiveSpheres;
+            out << YAML::Key << "Performed Operations" << YAML::Value << performedOperations;
+            out << YAML::Key << "Number of Active Spheres" << YAML::Value << numberOfActiveSpheres;
+            out << YAML::Key << "Spheres" << YAML::Value;
+            out << YAML::BeginSeq;
+				std::vector<int> vertexOffsets, sphereVertices;
+				gatherSphereVertices(vertexOffsets, sphereVertices);
+				
+                for (int k = 0; k < timedSpheres.size(); k++)
+                {
+					TimedSphere& i = timedSpheres[k];
+					
+                    out << YAML::BeginMap;
+                        out << YAML::Key << "Center" << YAML::Value;
+                        YAMLSerializeVector3(out, i.sphere.center);
+                        out << YAML::Key << "Radius" << YAML::Value << i.sphere.radius;
+                        out << YAML::Key << "Quadric" << YAML::Value;
+                        YAMLSerializeQuadric(out, i.sphere.quadric);
+                        out << YAML::Key << "Color" << YAML::Value;
+                        YAMLSerializeVector3(out, i.sphere.color);
+						out << YAML::Key << "Alias" << YAML::Value << aliases[k];
+						out << YAML::Key << "Neighbours" << YAML::Value;
+						out << YAML::BeginSeq;
+						for (int j : i.sphere.neighbourSpheres)
+							out << j;
+						out << YAML::EndSeq;
+						out << YAML::Key << "Vertices" << YAML::Value;
+						out << YAML::BeginSeq;
+						for (int v = vertexOffsets[k]; v < vertexOffsets[k + 1]; v++)
+							out << referenceMesh->toFileIndex(sphereVertices[v]);
+						out << YAML::EndSeq;
+						out << YAML::Key << "Quadric Weights" << YAML::Value << i.sphere.quadricWeights;
+                    out << YAML::EndMap;
+                }
+            out << YAML::EndSeq;
+            out << YAML::Key << "Connectivity" << YAML::Value;
+            out << YAML::BeginMap;
+                out << YAML::Key << "Edges" << YAML::Value;
+                out << YAML::BeginSeq;
+                    for (auto & i : edge)
+                    {
+                        out << YAML::BeginMap;
+                            out << YAML::Key << "E0" << YAML::Value << i.i;
+                            out << YAML::Key << "E1" << YAML::Value << i.j;
+                        out << YAML::EndMap;
+                    }
+                out << YAML::EndSeq;
+                out << YAML::Key << "Triangles" << YAML::Value;
+                out << YAML::BeginSeq;
+                    for (auto & i : triangle)
+                    {
+                        out << YAML::BeginMap;
+                            out << YAML::Key << "T0" << YAML::Value << i.i;
+                            out << YAML::Key << "T1" << YAML::Value << i.j;
+                            out << YAML::Key << "T2" << YAML::Value << i.k;
+                        out << YAML::EndMap;
+                    }
+                out << YAML::EndSeq;
+            out << YAML::EndMap;
+        out << YAML::EndMap;
+
+        namespace fs = std::__fs::filesystem;
+
+        fs::path cwd = fs::current_path();
+
+        std::string separator = std::string(1, fs::path::preferred_separator);
+
+        const std::string& filePath = fn;
+        std::string folderPath = "." + separator;
+        if (path != ".")
+            folderPath = path;
+
+        std::ofstream fout(folderPath + filePath);
+        std::cout << "File location: " << folderPath + filePath << std::endl;
+        fout << out.c_str();
+        fout.close();
+    }
+
+    void SphereMesh::loadFromYaml(const std::string& path)
+    {
+        triangle.clear();
+        edge.clear();
+        clearTimedSpheres();
+		sphereMapper.clear();
+        
+        std::ifstream stream(path);
+        std::stringstream strStream;
+        strStream << stream.rdbuf();
+
+        YAML::Node data = YAML::Load(strStream.str());
+		
+		performedOperations = data["Performed Operations"].as<int>();
+		editState.operation = -1;
+		numberOfActiveSpheres = data["Number of Active Spheres"].as<int>();
+		
+		vertexOwners.assign(referenceMesh->vertices.size(), -1);
+		std::vector<int> vertexIndices = referenceMesh->fileToVertexIndices();
+		
+		int i = 0;
+        for (const auto& node : data["Spheres"]) {
+            Sphere s;
+            
+            s.center = node["Center"].as<Math::Vector3>();
+            s.radius = node["Radius"].as<Math::Scalar>();
+            s.quadric = node["Quadric"].as<Renderer::Quadric>();
+            s.color = node["Color"].as<Math::Vector3>();
+			s.quadricWeights = node["Quadric Weights"].as<Math::Scalar>();
+			for (const auto& vertex : node["Vertices"])
+				vertexOwners[vertexIndices[vertex.as<int>()]] = i;
+			s.neighbourSpheres.clear();
+			for (const auto& neighbour : node["Neighbours"])
+				s.neighbourSpheres.insert(neighbour.as<int>());
+
+            addTimedSphere(s, node["Alias"].as<int>(), performedOperations);
+			sphereMapper[s.getID()] = i++;
+        }
+        
+        for (const auto& node : data["Connectivity"]["Triangles"]) {
+            Triangle t;
             
             t.i = node["T0"].as<int>();
             t.j = node["T1"].as<int>();
@@ -1008,6 +2524,880 @@ namespace Renderer {
         }
     }
 	
+	namespace
+	{
+		constexpr char PREPROCESSED_SPHERE_MESH_MAGIC[8] = {'S', 'M', 'S', 'P', 'H', 'R', '1', '\0'};
+		
+		// Quadric (A, b, c), weight, center and radius of every sphere
+		constexpr size_t PREPROCESSED_SPHERE_VALUES = 16 + 4 + 1 + 1 + 3 + 1;
+	}
+	
+	std::uint64_t SphereMesh::preprocessedKey() const
+	{
+		const std::uint8_t flags[2] = {IMPLEMENT_THIERY_2013, FLOAT_CANDIDATE_COSTS};
+		const double settings[3] = {CURVATURE_SIGMA, NEIGHBOURHOOD_RADIUS, CANDIDATE_PRUNE_ERROR};
+		const std::int32_t rings = NEIGHBOURHOOD_RINGS;
+		
+		std::uint64_t key = referenceMesh->getContentHash();
+		key = hashBytes(PREPROCESSED_SPHERE_MESH_MAGIC, sizeof(PREPROCESSED_SPHERE_MESH_MAGIC), key);
+		key = hashBytes(flags, sizeof(flags), key);
+		key = hashBytes(settings, sizeof(settings), key);
+		key = hashBytes(&rings, sizeof(rings), key);
+		
+		// Chunked sphere meshes start from other spheres, keys of unchunked ones stay as they were
+		if (CHUNK_VERTICES > 0)
+		{
+			const std::int32_t chunkVertices = CHUNK_VERTICES;
+			const double chunkFraction = CHUNK_SPHERE_FRACTION;
+			key = hashBytes(&chunkVertices, sizeof(chunkVertices), key);
+			key = hashBytes(&chunkFraction, sizeof(chunkFraction), key);
+		}
+		
+		return key;
+	}
+	
+	// Layout: magic, key, then the sphere values, the regions (Thiery et al. only), the neighbourhoods as CSR
+	// offsets and indices, the bucket count of every neighbour set and the initial collapse solutions. The neighbour
+	// sets are rebuilt with the same bucket count, inserting backwards, so they iterate in the original order and
+	// the collapses come out exactly as from a fresh initialisation
+	bool SphereMesh::loadPreprocessed(const std::string& entry)
+	{
+		MappedFile file(entry);
+		if (!file.isOpen())
+			return false;
+		
+		BinaryReader in(file);
+		const char* magic = in.take(sizeof(PREPROCESSED_SPHERE_MESH_MAGIC));
+		auto key = in.read<std::uint64_t>();
+		
+		auto sphereValues = in.readArray<double>();
+		auto regionWidth = in.read<std::uint32_t>();
+		auto regionValues = in.readArray<double>();
+		auto neighbourOffsets = in.readArray<std::int32_t>();
+		auto neighbours = in.readArray<std::int32_t>();
+		auto bucketCounts = in.readArray<std::uint64_t>();
+		auto solutions = in.readArray<double>();
+		
+		const size_t n = referenceMesh->vertices.size();
+		if (!in.ok() || std::memcmp(magic, PREPROCESSED_SPHERE_MESH_MAGIC, sizeof(PREPROCESSED_SPHERE_MESH_MAGIC)) != 0 ||
+		    key != preprocessedKey() || sphereValues.size() != n * PREPROCESSED_SPHERE_VALUES ||
+		    regionValues.size() != 2 * n * regionWidth || neighbourOffsets.size() != n + 1 ||
+		    bucketCounts.size() != n || neighbourOffsets.front() != 0 ||
+		    static_cast<size_t>(neighbourOffsets.back()) != neighbours.size())
+			return false;
+		
+		size_t pairs = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			if (neighbourOffsets[i] > neighbourOffsets[i + 1])
+				return false;
+			
+			for (int k = neighbourOffsets[i]; k < neighbourOffsets[i + 1]; k++)
+			{
+				if (neighbours[k] < 0 || static_cast<size_t>(neighbours[k]) >= n)
+					return false;
+				
+				if (static_cast<size_t>(neighbours[k]) < i)
+					pairs++;
+			}
+		}
+		
+		// Pruned pairs have no solution
+		if (solutions.size() % 5 != 0 || solutions.size() > 5 * pairs)
+			return false;
+		
+		initializeSphereMeshTriangles(referenceMesh->faces);
+		
+		clearTimedSpheres(n);
+		sphereMapper.clear();
+		
+		vertexOwners.resize(n);
+		std::iota(vertexOwners.begin(), vertexOwners.end(), 0);
+		
+		for (int i = 0; i < n; i++)
+		{
+			const double* values = sphereValues.data() + i * PREPROCESSED_SPHERE_VALUES;
+			Sphere sphere;
+			
+			std::copy(values, values + 16, sphere.quadric.A.data);
+			sphere.quadric.b = Math::Vector4(values[16], values[17], values[18], values[19]);
+			sphere.quadric.c = values[20];
+			sphere.quadricWeights = values[21];
+			sphere.center = Math::Vector3(values[22], values[23], values[24]);
+			sphere.radius = values[25];
+			sphere.color = Math::Vector3(1, 0, 0);
+			
+			if (regionWidth > 0)
+			{
+				const double* region = regionValues.data() + 2 * i * regionWidth;
+				sphere.region.min.assign(region, region + regionWidth);
+				sphere.region.max.assign(region + regionWidth, region + 2 * regionWidth);
+			}
+			
+			sphere.neighbourSpheres.rehash(bucketCounts[i]);
+			for (int k = neighbourOffsets[i + 1] - 1; k >= neighbourOffsets[i]; k--)
+				sphere.neighbourSpheres.insert(neighbours[k]);
+			
+			addTimedSphere(sphere, i, performedOperations);
+			sphereMapper[sphere.getID()] = i;
+		}
+		
+		initializeEdgeQueue(nullptr, &solutions);
+		return true;
+	}
+	
+	void SphereMesh::savePreprocessed(const std::string& entry, const std::vector<Math::Scalar>& solutions) const
+	{
+		BufferedWriter out(entry);
+		if (!out.isOpen())
+			return;
+		
+		const size_t n = timedSpheres.size();
+		const auto regionWidth = static_cast<std::uint32_t>(IMPLEMENT_THIERY_2013 && n > 0 ?
+		                                                    timedSpheres[0].sphere.region.min.size() : 0);
+		
+		std::vector<double> sphereValues, regionValues;
+		std::vector<std::int32_t> neighbourOffsets, neighbours;
+		std::vector<std::uint64_t> bucketCounts;
+		
+		sphereValues.reserve(n * PREPROCESSED_SPHERE_VALUES);
+		regionValues.reserve(2 * n * regionWidth);
+		neighbourOffsets.reserve(n + 1);
+		bucketCounts.reserve(n);
+		
+		neighbourOffsets.push_back(0);
+		for (const TimedSphere& timedSphere : timedSpheres)
+		{
+			const Sphere& sphere = timedSphere.sphere;
+			
+			sphereValues.insert(sphereValues.end(), sphere.quadric.A.data, sphere.quadric.A.data + 16);
+			sphereValues.insert(sphereValues.end(), {sphere.quadric.b[0], sphere.quadric.b[1], sphere.quadric.b[2],
+			                                         sphere.quadric.b[3], sphere.quadric.c, sphere.quadricWeights,
+			                                         sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius});
+			
+			if (regionWidth > 0)
+			{
+				if (sphere.region.min.size() != regionWidth || sphere.region.max.size() != regionWidth)
+					return;
+				
+				regionValues.insert(regionValues.end(), sphere.region.min.begin(), sphere.region.min.end());
+				regionValues.insert(regionValues.end(), sphere.region.max.begin(), sphere.region.max.end());
+			}
+			
+			neighbours.insert(neighbours.end(), sphere.neighbourSpheres.begin(), sphere.neighbourSpheres.end());
+			neighbourOffsets.push_back(static_cast<std::int32_t>(neighbours.size()));
+			bucketCounts.push_back(sphere.neighbourSpheres.bucket_count());
+		}
+		
+		out.write(PREPROCESSED_SPHERE_MESH_MAGIC, sizeof(PREPROCESSED_SPHERE_MESH_MAGIC));
+		out.write(preprocessedKey());
+		out.writeArray(sphereValues);
+		out.write(regionWidth);
+		out.writeArray(regionValues);
+		out.writeArray(neighbourOffsets);
+		out.writeArray(neighbours);
+		out.writeArray(bucketCounts);
+		out.writeArray(solutions);
+		out.commit();
+	}
+	
+	namespace
+	{
+		constexpr char CHECKPOINT_MAGIC[8] = {'S', 'M', 'C', 'K', 'P', 'T', '3', '\0'};
+		
+		// Quadric, weight, center, radius and color of the sphere, then the bound of its quadric (minimizer, minimum
+		// error and curvature)
+		constexpr size_t CHECKPOINT_SPHERE_VALUES = 16 + 4 + 1 + 1 + 3 + 1 + 3 + 4 + 1 + 1;
+		
+		// Quadric, center and radius, cost of a queued collapse
+		constexpr size_t CHECKPOINT_COLLAPSE_VALUES = 16 + 4 + 1 + 4 + 1;
+		
+		// Elements in iteration order plus the bucket count. Inserted back to front in a set with that many buckets
+		// they iterate in the same order again
+		template <typename T, typename Set, typename Flatten>
+		void appendSet(const Set& set, std::vector<T>& values, std::vector<std::uint64_t>& bucketCounts, Flatten flatten)
+		{
+			for (const auto& element : set)
+				flatten(element, values);
+			bucketCounts.push_back(set.bucket_count());
+		}
+		
+		void appendIntSet(const set_of_int& set, std::vector<std::int32_t>& offsets, std::vector<std::int32_t>& values,
+		                  std::vector<std::uint64_t>& bucketCounts)
+		{
+			appendSet(set, values, bucketCounts, [](int i, std::vector<std::int32_t>& out) { out.push_back(i); });
+			offsets.push_back(static_cast<std::int32_t>(values.size()));
+		}
+		
+		bool validOffsets(const std::vector<std::int32_t>& offsets, size_t count, size_t values)
+		{
+			if (offsets.size() != count + 1 || offsets.front() != 0 || static_cast<size_t>(offsets.back()) != values)
+				return false;
+			
+			for (size_t i = 0; i < count; i++)
+				if (offsets[i] > offsets[i + 1])
+					return false;
+			
+			return true;
+		}
+		
+		void restoreIntSet(set_of_int& set, const std::int32_t* begin, const std::int32_t* end, std::uint64_t buckets)
+		{
+			set.clear();
+			set.rehash(buckets);
+			for (const std::int32_t* it = end; it != begin; )
+				set.insert(*--it);
+		}
+	}
+	
+	// Layout: magic, preprocessing key, counters, then per sphere its values, region, timestamp, alias, id and
+	// neighbours (CSR plus bucket counts), the mapper, the vertex owners, the connectivity sets and the queue in heap
+	// order. Every unordered container comes back with the same iteration order, so a resumed collapse
+	// makes the same choices as an uninterrupted one
+	bool SphereMesh::saveCheckpoint(const std::string& path) const
+	{
+		BufferedWriter out(path);
+		if (!out.isOpen())
+			return false;
+		
+		const size_t n = timedSpheres.size();
+		const auto regionWidth = static_cast<std::uint32_t>(IMPLEMENT_THIERY_2013 && n > 0 ?
+		                                                    timedSpheres[0].sphere.region.min.size() : 0);
+		
+		std::vector<double> sphereValues, regionValues;
+		std::vector<std::int32_t> sphereInts, neighbourOffsets{0}, neighbours;
+		std::vector<std::uint64_t> neighbourBuckets;
+		
+		sphereValues.reserve(n * CHECKPOINT_SPHERE_VALUES);
+		sphereInts.reserve(3 * n);
+		
+		for (size_t i = 0; i < n; i++)
+		{
+			const Sphere& sphere = timedSpheres[i].sphere;
+			const QuadricBound& bound = quadricBounds[i];
+			
+			sphereValues.insert(sphereValues.end(), sphere.quadric.A.data, sphere.quadric.A.data + 16);
+			sphereValues.insert(sphereValues.end(), {sphere.quadric.b[0], sphere.quadric.b[1], sphere.quadric.b[2],
+			                                         sphere.quadric.b[3], sphere.quadric.c, sphere.quadricWeights,
+			                                         sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius,
+			                                         sphere.color[0], sphere.color[1], sphere.color[2],
+			                                         bound.minimizer[0], bound.minimizer[1], bound.minimizer[2],
+			                                         bound.minimizer[3], bound.minimumError, bound.minimumCurvature});
+			
+			if (regionWidth > 0)
+			{
+				if (sphere.region.min.size() != regionWidth || sphere.region.max.size() != regionWidth)
+					return false;
+				
+				regionValues.insert(regionValues.end(), sphere.region.min.begin(), sphere.region.min.end());
+				regionValues.insert(regionValues.end(), sphere.region.max.begin(), sphere.region.max.end());
+			}
+			
+			sphereInts.insert(sphereInts.end(), {timestamps[i], aliases[i], sphere.getID()});
+			appendIntSet(sphere.neighbourSpheres, neighbourOffsets, neighbours, neighbourBuckets);
+		}
+		
+		std::vector<std::int32_t> mapper;
+		mapper.reserve(2 * sphereMapper.size());
+		for (const auto& [id, index] : sphereMapper)
+			mapper.insert(mapper.end(), {id, index});
+		
+		const std::vector<std::int32_t> owners(vertexOwners.begin(), vertexOwners.end());
+		
+		std::vector<std::int32_t> triangles, edges;
+		std::vector<std::uint64_t> connectivityBuckets;
+		appendSet(triangle, triangles, connectivityBuckets,
+		          [](const Triangle& t, std::vector<std::int32_t>& values) { values.insert(values.end(), {t.i, t.j, t.k}); });
+		appendSet(edge, edges, connectivityBuckets,
+		          [](const Edge& e, std::vector<std::int32_t>& values) { values.insert(values.end(), {e.i, e.j}); });
+		
+		const std::vector<EdgeCollapse>& queued = edgeQueue.entries();
+		std::vector<double> collapseValues;
+		std::vector<std::int32_t> collapseInts, collapseOffsets{0}, collapsed;
+		
+		collapseValues.reserve(queued.size() * CHECKPOINT_COLLAPSE_VALUES);
+		collapseInts.reserve(2 * queued.size());
+		collapseOffsets.reserve(queued.size() + 1);
+		
+		for (const EdgeCollapse& e : queued)
+		{
+			collapseValues.insert(collapseValues.end(), e.error.A.data, e.error.A.data + 16);
+			collapseValues.insert(collapseValues.end(), {e.error.b[0], e.error.b[1], e.error.b[2], e.error.b[3], e.error.c,
+			                                             e.centerRadius[0], e.centerRadius[1], e.centerRadius[2],
+			                                             e.centerRadius[3], e.cost});
+#ifdef REGISTER_EPSILON
+			collapseValues.push_back(e.epsilonOfCollapse);
+#endif
+			
+			collapseInts.insert(collapseInts.end(), {e.timestamp, e.lazy ? 1 : 0});
+			
+			collapsed.insert(collapsed.end(), e.toCollapse.begin(), e.toCollapse.end());
+			collapseOffsets.push_back(static_cast<std::int32_t>(collapsed.size()));
+		}
+		
+		out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+		out.write(preprocessedKey());
+		out.write(static_cast<std::int32_t>(performedOperations));
+		out.write(static_cast<std::int32_t>(numberOfActiveSpheres));
+		out.write(static_cast<double>(lastCollapseCost));
+		out.write(static_cast<double>(prunedCost));
+		out.write(static_cast<std::int64_t>(solvedCollapses));
+		out.write(static_cast<std::uint8_t>(edgeQueue.isQueueDirty()));
+		out.write(regionWidth);
+		out.writeArray(sphereValues);
+		out.writeArray(regionValues);
+		out.writeArray(sphereInts);
+		out.writeArray(neighbourOffsets);
+		out.writeArray(neighbours);
+		out.writeArray(neighbourBuckets);
+		out.writeArray(mapper);
+		out.writeArray(owners);
+		out.writeArray(triangles);
+		out.writeArray(edges);
+		out.writeArray(connectivityBuckets);
+		out.writeArray(collapseValues);
+		out.writeArray(collapseInts);
+		out.writeArray(collapseOffsets);
+		out.writeArray(collapsed);
+		return out.commit();
+	}
+	
+	// The checkpoint must come from the same model with the same settings, otherwise nothing is changed
+	bool SphereMesh::loadCheckpoint(const std::string& path)
+	{
+		MappedFile file(path);
+		if (!file.isOpen())
+			return false;
+		
+		BinaryReader in(file);
+		const char* magic = in.take(sizeof(CHECKPOINT_MAGIC));
+		auto key = in.read<std::uint64_t>();
+		auto operations = in.read<std::int32_t>();
+		auto activeSpheres = in.read<std::int32_t>();
+		auto collapseCost = in.read<double>();
+		auto pruned = in.read<double>();
+		auto solves = in.read<std::int64_t>();
+		auto dirty = in.read<std::uint8_t>();
+		auto regionWidth = in.read<std::uint32_t>();
+		auto sphereValues = in.readArray<double>();
+		auto regionValues = in.readArray<double>();
+		auto sphereInts = in.readArray<std::int32_t>();
+		auto neighbourOffsets = in.readArray<std::int32_t>();
+		auto neighbours = in.readArray<std::int32_t>();
+		auto neighbourBuckets = in.readArray<std::uint64_t>();
+		auto mapper = in.readArray<std::int32_t>();
+		auto owners = in.readArray<std::int32_t>();
+		auto triangles = in.readArray<std::int32_t>();
+		auto edges = in.readArray<std::int32_t>();
+		auto connectivityBuckets = in.readArray<std::uint64_t>();
+		auto collapseValues = in.readArray<double>();
+		auto collapseInts = in.readArray<std::int32_t>();
+		auto collapseOffsets = in.readArray<std::int32_t>();
+		auto collapsed = in.readArray<std::int32_t>();
+		
+#ifdef REGISTER_EPSILON
+		constexpr size_t collapseValueCount = CHECKPOINT_COLLAPSE_VALUES + 1;
+#else
+		constexpr size_t collapseValueCount = CHECKPOINT_COLLAPSE_VALUES;
+#endif
+		
+		// One sphere per vertex to begin with, unless the spheres were stitched from chunks
+		const size_t n = sphereInts.size() / 3;
+		const size_t entries = collapseOffsets.empty() ? 0 : collapseOffsets.size() - 1;
+		
+		if (!in.ok() || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 || key != preprocessedKey() ||
+		    sphereValues.size() != n * CHECKPOINT_SPHERE_VALUES || regionValues.size() != 2 * n * regionWidth ||
+		    sphereInts.size() % 3 != 0 || neighbourBuckets.size() != n ||
+		    !validOffsets(neighbourOffsets, n, neighbours.size()) ||
+		    mapper.size() % 2 != 0 || owners.size() != referenceMesh->vertices.size() || triangles.size() % 3 != 0 ||
+		    edges.size() % 2 != 0 || connectivityBuckets.size() != 2 ||
+		    !validOffsets(collapseOffsets, entries, collapsed.size()) ||
+		    collapseValues.size() != entries * collapseValueCount || collapseInts.size() != 2 * entries)
+			return false;
+		
+		auto inRange = [n](std::int32_t i) { return i >= 0 && static_cast<size_t>(i) < n; };
+		for (size_t i = 0; i < n; i++)
+			if (!inRange(sphereInts[3 * i + 1]))
+				return false;
+		
+		if (!std::all_of(owners.begin(), owners.end(), inRange) ||
+		    !std::all_of(neighbours.begin(), neighbours.end(), inRange) ||
+		    !std::all_of(triangles.begin(), triangles.end(), inRange) ||
+		    !std::all_of(edges.begin(), edges.end(), inRange) ||
+		    !std::all_of(collapsed.begin(), collapsed.end(), inRange))
+			return false;
+		
+		for (size_t k = 1; k < mapper.size(); k += 2)
+			if (!inRange(mapper[k]))
+				return false;
+		
+		clearTimedSpheres(n);
+		
+		for (size_t i = 0; i < n; i++)
+		{
+			const double* values = sphereValues.data() + i * CHECKPOINT_SPHERE_VALUES;
+			Sphere sphere;
+			
+			std::copy(values, values + 16, sphere.quadric.A.data);
+			sphere.quadric.b = Math::Vector4(values[16], values[17], values[18], values[19]);
+			sphere.quadric.c = values[20];
+			sphere.quadricWeights = values[21];
+			sphere.center = Math::Vector3(values[22], values[23], values[24]);
+			sphere.radius = values[25];
+			sphere.color = Math::Vector3(values[26], values[27], values[28]);
+			sphere.setID(sphereInts[3 * i + 2]);
+			
+			if (regionWidth > 0)
+			{
+				const double* region = regionValues.data() + 2 * i * regionWidth;
+				sphere.region.min.assign(region, region + regionWidth);
+				sphere.region.max.assign(region + regionWidth, region + 2 * regionWidth);
+			}
+			
+			restoreIntSet(sphere.neighbourSpheres, neighbours.data() + neighbourOffsets[i],
+			              neighbours.data() + neighbourOffsets[i + 1], neighbourBuckets[i]);
+			
+			addTimedSphere(sphere, sphereInts[3 * i + 1], sphereInts[3 * i]);
+			quadricBounds[i] = {Math::Vector4(values[29], values[30], values[31], values[32]), values[33], values[34]};
+		}
+		
+		sphereMapper.clear();
+		sphereMapper.reserve(mapper.size() / 2);
+		for (size_t k = 0; k < mapper.size(); k += 2)
+			sphereMapper[mapper[k]] = mapper[k + 1];
+		
+		vertexOwners.assign(owners.begin(), owners.end());
+		
+		triangle.clear();
+		triangle.rehash(connectivityBuckets[0]);
+		for (size_t k = triangles.size(); k > 0; k -= 3)
+			triangle.insert(Triangle(triangles[k - 3], triangles[k - 2], triangles[k - 1]));
+		
+		edge.clear();
+		edge.rehash(connectivityBuckets[1]);
+		for (size_t k = edges.size(); k > 0; k -= 2)
+			edge.insert(Edge(edges[k - 2], edges[k - 1]));
+		
+		std::vector<EdgeCollapse> queued(entries);
+		for (size_t k = 0; k < entries; k++)
+		{
+			const double* values = collapseValues.data() + k * collapseValueCount;
+			EdgeCollapse& e = queued[k];
+			
+			std::copy(values, values + 16, e.error.A.data);
+			e.error.b = Math::Vector4(values[16], values[17], values[18], values[19]);
+			e.error.c = values[20];
+			e.centerRadius = Math::Vector4(values[21], values[22], values[23], values[24]);
+			e.cost = values[25];
+#ifdef REGISTER_EPSILON
+			e.epsilonOfCollapse = values[26];
+#endif
+			
+			e.timestamp = collapseInts[2 * k];
+			e.lazy = collapseInts[2 * k + 1] != 0;
+			
+			e.toCollapse.assign(collapsed.begin() + collapseOffsets[k], collapsed.begin() + collapseOffsets[k + 1]);
+		}
+		
+		edgeQueue = TemporalValidityQueue(timedSpheres, sphereMapper);
+		edgeQueue.assign(std::move(queued));
+		if (dirty)
+			edgeQueue.setQueueDirty();
+		
+		performedOperations = operations;
+		editState.operation = -1;
+		numberOfActiveSpheres = activeSpheres;
+		lastCollapseCost = collapseCost;
+		prunedCost = pruned;
+		solvedCollapses = solves;
+		return true;
+	}
+	
+	namespace
+	{
+		constexpr char CHUNK_MAGIC[8] = {'S', 'M', 'C', 'H', 'N', 'K', '1', '\0'};
+		
+		// Quadric (A, b, c), weight, center and radius of a sphere kept by a chunk
+		constexpr size_t CHUNK_SPHERE_VALUES = 16 + 4 + 1 + 1 + 3 + 1;
+		
+		// Median splits of order[begin, end) along the longest side of its bounding box, until a cell has at most
+		// maxVertices vertices. The cells are numbered depth first, so cells close in space mostly get close numbers
+		void splitIntoCells(const std::vector<Vertex>& vertices, std::vector<int>& order, size_t begin, size_t end,
+		                    size_t maxVertices, std::vector<size_t>& cellEnds)
+		{
+			if (end - begin <= maxVertices)
+			{
+				cellEnds.push_back(end);
+				return;
+			}
+			
+			AABB box;
+			for (size_t k = begin; k < end; k++)
+				box.addPoint(vertices[order[k]].position);
+			
+			const Math::Vector3 extent = box.BDD();
+			int axis = 0;
+			for (int a = 1; a < 3; a++)
+				if (extent[a] > extent[axis])
+					axis = a;
+			
+			const size_t middle = begin + (end - begin) / 2;
+			std::nth_element(order.begin() + static_cast<long>(begin), order.begin() + static_cast<long>(middle),
+			                 order.begin() + static_cast<long>(end), [&](int a, int b)
+			{
+				return vertices[a].position[axis] < vertices[b].position[axis];
+			});
+			
+			splitIntoCells(vertices, order, begin, middle, maxVertices, cellEnds);
+			splitIntoCells(vertices, order, middle, end, maxVertices, cellEnds);
+		}
+		
+		std::string chunkPrefix(std::uint64_t key)
+		{
+			// Two runs on the same mesh with the same settings don't share their chunk files
+			std::random_device device;
+			
+			char text[26];
+			std::snprintf(text, sizeof(text), "%016llx-%08x", static_cast<unsigned long long>(key), device());
+			return text;
+		}
+	}
+	
+	// The vertices are split into spatial cells and every face goes to the chunk of the cell of its smallest vertex.
+	// A vertex whose faces are all in one chunk is interior to it, the others are on the boundary and their sphere is
+	// kept by the first chunk among those of their faces. A chunk is simplified on its own faces plus all the other
+	// faces around its boundary vertices, so those get their whole quadric and neighbourhood, and only its interior
+	// spheres may be collapsed. It writes those, the boundary spheres it keeps and the neighbour links of both (as
+	// pairs of vertices, any vertex of a sphere stands for it) to its own file. Chunks run in parallel, each on one
+	// of CHUNK_THREADS threads, so only as many of them are in memory at once; the files are read back in chunk
+	// order, one at a time, and their spheres indexed in that order. The reference mesh and the partition below are
+	// not streamed, they stay in memory for the whole pass
+	bool SphereMesh::initializeFromChunks()
+	{
+		const std::vector<Vertex>& vertices = referenceMesh->vertices;
+		const std::vector<Face>& faces = referenceMesh->faces;
+		const int vertexCount = static_cast<int>(vertices.size());
+		const int faceCount = static_cast<int>(faces.size());
+		
+		std::vector<int> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0);
+		
+		std::vector<size_t> cellEnds;
+		splitIntoCells(vertices, order, 0, order.size(), static_cast<size_t>(std::max(1, CHUNK_VERTICES)), cellEnds);
+		const int chunks = static_cast<int>(cellEnds.size());
+		
+		std::vector<int> cell(vertexCount);
+		for (size_t c = 0, k = 0; c < cellEnds.size(); c++)
+			for (; k < cellEnds[c]; k++)
+				cell[order[k]] = static_cast<int>(c);
+		std::vector<int>().swap(order);
+		
+		std::vector<int> faceChunk(faceCount);
+		for (int f = 0; f < faceCount; f++)
+			faceChunk[f] = cell[std::min({faces[f].i, faces[f].j, faces[f].k})];
+		
+		// Chunk keeping the sphere of every vertex, a vertex without faces stays in its cell
+		std::vector<int> home(cell);
+		std::vector<std::uint8_t> boundary(vertexCount, 0), hasFaces(vertexCount, 0);
+		for (int f = 0; f < faceCount; f++)
+			for (int v : {faces[f].i, faces[f].j, faces[f].k})
+				if (!hasFaces[v])
+				{
+					hasFaces[v] = 1;
+					home[v] = faceChunk[f];
+				}
+				else if (home[v] != faceChunk[f])
+				{
+					boundary[v] = 1;
+					home[v] = std::min(home[v], faceChunk[f]);
+				}
+		
+		std::vector<std::vector<int>> isolated(chunks);
+		for (int v = 0; v < vertexCount; v++)
+			if (!hasFaces[v])
+				isolated[home[v]].push_back(v);
+		std::vector<std::uint8_t>().swap(hasFaces);
+		std::vector<int>().swap(cell);
+		
+		// Faces of every chunk and faces around every vertex, both as CSR
+		std::vector<int> chunkFaceOffsets(chunks + 1, 0), vertexFaceOffsets(vertexCount + 1, 0);
+		for (int f = 0; f < faceCount; f++)
+		{
+			chunkFaceOffsets[faceChunk[f] + 1]++;
+			for (int v : {faces[f].i, faces[f].j, faces[f].k})
+				vertexFaceOffsets[v + 1]++;
+		}
+		
+		for (int c = 0; c < chunks; c++)
+			chunkFaceOffsets[c + 1] += chunkFaceOffsets[c];
+		for (int v = 0; v < vertexCount; v++)
+			vertexFaceOffsets[v + 1] += vertexFaceOffsets[v];
+		
+		std::vector<int> chunkFaces(faceCount), vertexFaces(vertexFaceOffsets.back());
+		{
+			std::vector<int> nextChunkFace(chunkFaceOffsets.begin(), chunkFaceOffsets.end() - 1);
+			std::vector<int> nextVertexFace(vertexFaceOffsets.begin(), vertexFaceOffsets.end() - 1);
+			for (int f = 0; f < faceCount; f++)
+			{
+				chunkFaces[nextChunkFace[faceChunk[f]]++] = f;
+				for (int v : {faces[f].i, faces[f].j, faces[f].k})
+					vertexFaces[nextVertexFace[v]++] = f;
+			}
+		}
+		
+		// Chunk meshes take the curvatures as they are, computed on the whole mesh
+		if (CURVATURE_SIGMA != 0)
+			referenceMesh->ensureCurvature();
+		
+		std::error_code error;
+		const std::filesystem::path directory = CHUNK_DIRECTORY.empty() ? std::filesystem::temp_directory_path(error) :
+		                                        std::filesystem::path(CHUNK_DIRECTORY);
+		std::filesystem::create_directories(directory, error);
+		
+		const std::uint64_t key = preprocessedKey();
+		const std::string prefix = chunkPrefix(key);
+		auto chunkPath = [&](int c)
+		{
+			return (directory / (prefix + "." + std::to_string(c) + ".chunk")).string();
+		};
+		
+		auto simplifyChunk = [&](int c)
+		{
+			std::vector<int> ownFaces(chunkFaces.begin() + chunkFaceOffsets[c], chunkFaces.begin() + chunkFaceOffsets[c + 1]);
+			
+			std::vector<int> chunkVertices = isolated[c];
+			for (int f : ownFaces)
+				chunkVertices.insert(chunkVertices.end(), {faces[f].i, faces[f].j, faces[f].k});
+			
+			std::vector<int> haloFaces;
+			for (int v : chunkVertices)
+				if (boundary[v])
+					for (int k = vertexFaceOffsets[v]; k < vertexFaceOffsets[v + 1]; k++)
+						if (faceChunk[vertexFaces[k]] != c)
+							haloFaces.push_back(vertexFaces[k]);
+			
+			std::sort(haloFaces.begin(), haloFaces.end());
+			haloFaces.erase(std::unique(haloFaces.begin(), haloFaces.end()), haloFaces.end());
+			
+			for (int f : haloFaces)
+				chunkVertices.insert(chunkVertices.end(), {faces[f].i, faces[f].j, faces[f].k});
+			
+			std::sort(chunkVertices.begin(), chunkVertices.end());
+			chunkVertices.erase(std::unique(chunkVertices.begin(), chunkVertices.end()), chunkVertices.end());
+			
+			auto local = [&](int v)
+			{
+				return static_cast<int>(std::lower_bound(chunkVertices.begin(), chunkVertices.end(), v) - chunkVertices.begin());
+			};
+			
+			std::vector<Face> localFaces;
+			localFaces.reserve(ownFaces.size() + haloFaces.size());
+			for (const std::vector<int>* list : {&ownFaces, &haloFaces})
+				for (int f : *list)
+					localFaces.emplace_back(local(faces[f].i), local(faces[f].j), local(faces[f].k));
+			
+			const int n = static_cast<int>(chunkVertices.size());
+			std::vector<std::uint8_t> locked(n);
+			int interior = 0;
+			for (int s = 0; s < n; s++)
+			{
+				locked[s] = boundary[chunkVertices[s]] || home[chunkVertices[s]] != c;
+				interior += !locked[s];
+			}
+			
+			TriMesh mesh(*referenceMesh, chunkVertices, localFaces);
+			SphereMesh chunk(&mesh, *this, std::move(locked));
+			
+			const int kept = std::max(1, static_cast<int>(std::ceil(interior * CHUNK_SPHERE_FRACTION)));
+			if (kept < interior)
+				chunk.collapseSphereMesh(n - interior + kept);
+			
+			chunk.flattenAliases();
+			
+			const auto regionWidth = static_cast<std::uint32_t>(IMPLEMENT_THIERY_2013 && n > 0 ?
+			                                                    chunk.timedSpheres[0].sphere.region.min.size() : 0);
+			
+			std::vector<int> sphereOffsets, sphereMembers;
+			chunk.gatherSphereVertices(sphereOffsets, sphereMembers);
+			
+			std::vector<double> sphereValues, regionValues;
+			std::vector<std::int32_t> vertexOffsets{0}, sphereVertices, links;
+			for (int s = 0; s < n; s++)
+			{
+				if (chunk.aliases[s] != s || home[chunkVertices[s]] != c)
+					continue;
+				
+				const Sphere& sphere = chunk.timedSpheres[s].sphere;
+				sphereValues.insert(sphereValues.end(), sphere.quadric.A.data, sphere.quadric.A.data + 16);
+				sphereValues.insert(sphereValues.end(), {sphere.quadric.b[0], sphere.quadric.b[1], sphere.quadric.b[2],
+				                                         sphere.quadric.b[3], sphere.quadric.c, sphere.quadricWeights,
+				                                         sphere.center[0], sphere.center[1], sphere.center[2],
+				                                         sphere.radius});
+				
+				if (regionWidth > 0)
+				{
+					if (sphere.region.min.size() != regionWidth || sphere.region.max.size() != regionWidth)
+						return false;
+					
+					regionValues.insert(regionValues.end(), sphere.region.min.begin(), sphere.region.min.end());
+					regionValues.insert(regionValues.end(), sphere.region.max.begin(), sphere.region.max.end());
+				}
+				
+				for (int k = sphereOffsets[s]; k < sphereOffsets[s + 1]; k++)
+					sphereVertices.push_back(chunkVertices[sphereMembers[k]]);
+				vertexOffsets.push_back(static_cast<std::int32_t>(sphereVertices.size()));
+				
+				for (int t : sphere.neighbourSpheres)
+				{
+					int r = chunk.alias(t);
+					if (r >= 0 && r != s)
+						links.insert(links.end(), {chunkVertices[s], chunkVertices[r]});
+				}
+			}
+			
+			BufferedWriter out(chunkPath(c));
+			if (!out.isOpen())
+				return false;
+			
+			out.write(CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+			out.write(key);
+			out.write(static_cast<std::int32_t>(c));
+			out.write(regionWidth);
+			out.writeArray(sphereValues);
+			out.writeArray(regionValues);
+			out.writeArray(vertexOffsets);
+			out.writeArray(sphereVertices);
+			out.writeArray(links);
+			return out.commit();
+		};
+		
+		std::vector<std::uint8_t> written(chunks, 0);
+		
+		const int threads = CHUNK_THREADS > 0 ? CHUNK_THREADS : omp_get_max_threads();
+		
+		#pragma omp parallel for schedule(dynamic) num_threads(threads)
+		for (int c = 0; c < chunks; c++)
+			written[c] = simplifyChunk(c);
+		
+		std::vector<int>().swap(chunkFaces);
+		std::vector<int>().swap(vertexFaces);
+		
+		clearTimedSpheres();
+		sphereMapper.clear();
+		vertexOwners.assign(vertexCount, -1);
+		
+		std::vector<std::int32_t> links;
+		std::uint32_t regionWidth = 0;
+		bool stitched = std::all_of(written.begin(), written.end(), [](std::uint8_t w) { return w != 0; });
+		
+		for (int c = 0; c < chunks && stitched; c++)
+		{
+			MappedFile file(chunkPath(c));
+			if (!file.isOpen())
+			{
+				stitched = false;
+				break;
+			}
+			
+			BinaryReader in(file);
+			const char* magic = in.take(sizeof(CHUNK_MAGIC));
+			auto chunkKey = in.read<std::uint64_t>();
+			auto chunk = in.read<std::int32_t>();
+			auto chunkRegionWidth = in.read<std::uint32_t>();
+			if (c == 0)
+				regionWidth = chunkRegionWidth;
+			auto sphereValues = in.readArray<double>();
+			auto regionValues = in.readArray<double>();
+			auto vertexOffsets = in.readArray<std::int32_t>();
+			auto sphereVertices = in.readArray<std::int32_t>();
+			auto chunkLinks = in.readArray<std::int32_t>();
+			
+			const size_t n = sphereValues.size() / CHUNK_SPHERE_VALUES;
+			auto inRange = [vertexCount](std::int32_t v) { return v >= 0 && v < vertexCount; };
+			
+			stitched = in.ok() && std::memcmp(magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) == 0 && chunkKey == key &&
+			           chunk == c && chunkRegionWidth == regionWidth && sphereValues.size() % CHUNK_SPHERE_VALUES == 0 &&
+			           regionValues.size() == 2 * n * regionWidth && validOffsets(vertexOffsets, n, sphereVertices.size()) &&
+			           chunkLinks.size() % 2 == 0 && std::all_of(sphereVertices.begin(), sphereVertices.end(), inRange) &&
+			           std::all_of(chunkLinks.begin(), chunkLinks.end(), inRange);
+			
+			for (size_t s = 0; s < n && stitched; s++)
+			{
+				const double* values = sphereValues.data() + s * CHUNK_SPHERE_VALUES;
+				Sphere sphere;
+				
+				std::copy(values, values + 16, sphere.quadric.A.data);
+				sphere.quadric.b = Math::Vector4(values[16], values[17], values[18], values[19]);
+				sphere.quadric.c = values[20];
+				sphere.quadricWeights = values[21];
+				sphere.center = Math::Vector3(values[22], values[23], values[24]);
+				sphere.radius = values[25];
+				sphere.color = Math::Vector3(1, 0, 0);
+				
+				if (regionWidth > 0)
+				{
+					const double* region = regionValues.data() + 2 * s * regionWidth;
+					sphere.region.min.assign(region, region + regionWidth);
+					sphere.region.max.assign(region + regionWidth, region + 2 * regionWidth);
+				}
+				
+				int index = addTimedSphere(sphere, static_cast<int>(timedSpheres.size()), 0);
+				sphereMapper[sphere.getID()] = index;
+				
+				for (int k = vertexOffsets[s]; k < vertexOffsets[s + 1]; k++)
+				{
+					// Every vertex is kept by exactly one chunk
+					stitched &= vertexOwners[sphereVertices[k]] < 0;
+					vertexOwners[sphereVertices[k]] = index;
+				}
+			}
+			
+			links.insert(links.end(), chunkLinks.begin(), chunkLinks.end());
+		}
+		
+		for (int c = 0; c < chunks; c++)
+			std::filesystem::remove(chunkPath(c), error);
+		
+		stitched = stitched && std::all_of(vertexOwners.begin(), vertexOwners.end(), [](int o) { return o >= 0; });
+		if (!stitched)
+		{
+			std::cerr << "Chunked simplification failed (chunk files in " << directory.string()
+			          << "), the sphere mesh is built in memory" << std::endl;
+			
+			clearTimedSpheres();
+			sphereMapper.clear();
+			vertexOwners.clear();
+			return false;
+		}
+		
+		for (size_t k = 0; k < links.size(); k += 2)
+		{
+			int i = vertexOwners[links[k]];
+			int j = vertexOwners[links[k + 1]];
+			if (i != j)
+			{
+				timedSpheres[i].sphere.addNeighbourSphere(j);
+				timedSpheres[j].sphere.addNeighbourSphere(i);
+			}
+		}
+		
+		// Connectivity of the stitched spheres, degenerate triangles as after a collapse
+		for (const Face& f : faces)
+		{
+			Triangle t(vertexOwners[f.i], vertexOwners[f.j], vertexOwners[f.k]);
+			
+			if (t.i == t.k)
+				continue;
+			else if (t.i == t.j || t.j == t.k)
+				edge.insert(Edge(t.i, t.k));
+			else
+				triangle.insert(t);
+		}
+		
+		numberOfActiveSpheres = static_cast<int>(timedSpheres.size());
+		return true;
+	}
+	
 	void SphereMesh::saveTXTToAutoPath()
 	{
 		std::string token;
@@ -1023,59 +3413,222 @@ namespace Renderer {
 		saveTXT("/Users/davidepaollilo/Desktop/ComparisonSM/", name);
 	}
 
+	namespace
+	{
+		std::string exportPath(const std::string& path, const std::string& fileName)
+		{
+			const std::string separator = std::string(1, std::filesystem::path::preferred_separator);
+			return (path != "." ? path : "." + separator) + fileName;
+		}
+	}
+	
+	// Position in the exported sphere list of every sphere, through its alias: the connectivity may still refer to
+	// spheres that were merged since it was last updated. Removed spheres, and those merged into them, get -1
+	std::vector<int> SphereMesh::exportIndices()
+	{
+		std::vector<int> indices(timedSpheres.size(), -1);
+		
+		int next = 0;
+		for (int i = 0; i < timedSpheres.size(); i++)
+			if (isTimedSphereAlive(i))
+				indices[i] = next++;
+		
+		for (int i = 0; i < timedSpheres.size(); i++)
+		{
+			int a = alias(i);
+			indices[i] = a < 0 ? -1 : indices[a];
+		}
+		
+		return indices;
+	}
+	
+	void SphereMesh::exportConnectivity(std::vector<std::int32_t>& triangles, std::vector<std::int32_t>& edges)
+	{
+		const std::vector<int> indices = exportIndices();
+		
+		triangles.clear();
+		for (const Triangle& t : triangle)
+			if (indices[t.i] >= 0 && indices[t.j] >= 0 && indices[t.k] >= 0)
+				triangles.insert(triangles.end(), {indices[t.i], indices[t.j], indices[t.k]});
+		
+		edges.clear();
+		for (const Edge& e : edge)
+			if (indices[e.i] >= 0 && indices[e.j] >= 0)
+				edges.insert(edges.end(), {indices[e.i], indices[e.j]});
+	}
+	
+	// Streamed through a buffered writer, the numbers are the shortest text that reads back to the same double
     void SphereMesh::saveTXT(const std::string& path, const std::string& fn)
     {
-        std::ostringstream fileContent;
-        
-        // Stating the count for each type: spheres, triangles, and edges
-        fileContent << "Sphere Mesh 2.0" << std::endl;
-		fileContent << "Duration: " << lastCollapseDuration << " seconds" << std::endl;
-        fileContent << numberOfActiveSpheres;
-        fileContent << " " << triangle.size();
-        fileContent << " " << edge.size() << std::endl;
-        fileContent << "====================" << std::endl;
-		
-		std::unordered_map<int, int> activeSpheres;
-		std::vector<TimedSphere> activeEdges;
-		std::vector<TimedSphere> activeTris;
-		int idx = 0;
+		const std::string filePath = exportPath(path, fn);
+		BufferedWriter out(filePath);
+		if (!out.isOpen())
+			return;
+		
+		std::vector<std::int32_t> triangles, edges;
+		exportConnectivity(triangles, edges);
+		
+		// Stating the count for each type: spheres, triangles, and edges
+		out.writeText("Sphere Mesh 2.0\nDuration: ");
+		out.writeText(lastCollapseDuration);
+		out.writeText(" seconds\n");
+		out.writeInteger(numberOfActiveSpheres);
+		out.writeText(" ");
+		out.writeInteger(static_cast<std::int64_t>(triangles.size() / 3));
+		out.writeText(" ");
+		out.writeInteger(static_cast<std::int64_t>(edges.size() / 2));
+		out.writeText("\n====================\n");
+		
 		for (int i = 0; i < timedSpheres.size(); i++)
 			if (isTimedSphereAlive(i))
-				activeSpheres[currentSphere(i).getID()] = idx++;
-        
-        // Saving timedSpheres details
-        for (int i = 0; i < timedSpheres.size(); i++)
-			if (isTimedSphereAlive(i))
-                fileContent << currentSphere(i).center[0] << " " << currentSphere(i).center[1] << " "
-					<< currentSphere(i).center[2] << " " << currentSphere(i).radius << std::endl;
-
-        // Saving triangle details
-        for (const auto& t : triangle)
-            fileContent << activeSpheres[timedSpheres[t.i].sphere.getID()] << " " << activeSpheres[timedSpheres[t.j]
-			.sphere.getID()] << " " << activeSpheres[timedSpheres[t.k].sphere.getID()] << std::endl;
-
-        // Saving edge details
-        for (const auto& e : edge)
-            fileContent << activeSpheres[timedSpheres[e.i].sphere.getID()] << " " << activeSpheres[timedSpheres[e.j]
-			.sphere.getID()] << std::endl;
-
-        namespace fs = std::__fs::filesystem;
-
-        fs::path cwd = fs::current_path();
-
-        std::string separator = std::string(1, fs::path::preferred_separator);
-
-        const std::string& filePath = fn;
-        std::string folderPath = "." + separator;
-        if (path != ".")
-            folderPath = path;
-
-        std::ofstream fout(folderPath + filePath);
-        std::cout << "File location: " << folderPath + filePath << std::endl;
-        fout << fileContent.str();
-        fout.close();
+			{
+				const Sphere& s = timedSpheres[i].sphere;
+				out.writeDecimal(s.center[0]);
+				out.writeText(" ");
+				out.writeDecimal(s.center[1]);
+				out.writeText(" ");
+				out.writeDecimal(s.center[2]);
+				out.writeText(" ");
+				out.writeDecimal(s.radius);
+				out.writeText("\n");
+			}
+		
+		for (size_t k = 0; k < triangles.size(); k += 3)
+		{
+			out.writeInteger(triangles[k]);
+			out.writeText(" ");
+			out.writeInteger(triangles[k + 1]);
+			out.writeText(" ");
+			out.writeInteger(triangles[k + 2]);
+			out.writeText("\n");
+		}
+		
+		for (size_t k = 0; k < edges.size(); k += 2)
+		{
+			out.writeInteger(edges[k]);
+			out.writeText(" ");
+			out.writeInteger(edges[k + 1]);
+			out.writeText("\n");
+		}
+		
+		if (out.commit())
+			std::cout << "File location: " << filePath << std::endl;
     }
+	
+	// Binary PLY in the byte order of the machine: spheres as vertices with a radius, triangles as faces and edges as
+	// edge elements
+	void SphereMesh::savePLY(const std::string& path, const std::string& fileName)
+	{
+		const std::string filePath = exportPath(path, fileName);
+		BufferedWriter out(filePath);
+		if (!out.isOpen())
+			return;
+		
+		std::vector<std::int32_t> triangles, edges;
+		exportConnectivity(triangles, edges);
+		
+		const std::uint16_t byteOrder = 1;
+		const bool littleEndian = *reinterpret_cast<const unsigned char*>(&byteOrder) == 1;
+		
+		out.writeText("ply\nformat ");
+		out.writeText(littleEndian ? "binary_little_endian" : "binary_big_endian");
+		out.writeText(" 1.0\ncomment Sphere Mesh 2.0\nelement vertex ");
+		out.writeInteger(numberOfActiveSpheres);
+		out.writeText("\nproperty double x\nproperty double y\nproperty double z\nproperty double radius\n"
+		              "element face ");
+		out.writeInteger(static_cast<std::int64_t>(triangles.size() / 3));
+		out.writeText("\nproperty list uchar int vertex_indices\nelement edge ");
+		out.writeInteger(static_cast<std::int64_t>(edges.size() / 2));
+		out.writeText("\nproperty int vertex1\nproperty int vertex2\nend_header\n");
+		
+		for (int i = 0; i < timedSpheres.size(); i++)
+			if (isTimedSphereAlive(i))
+			{
+				const Sphere& s = timedSpheres[i].sphere;
+				const double values[4] = {s.center[0], s.center[1], s.center[2], s.radius};
+				out.write(values);
+			}
+		
+		for (size_t k = 0; k < triangles.size(); k += 3)
+		{
+			out.write(static_cast<std::uint8_t>(3));
+			const std::int32_t face[3] = {triangles[k], triangles[k + 1], triangles[k + 2]};
+			out.write(face);
+		}
+		
+		for (size_t k = 0; k < edges.size(); k += 2)
+		{
+			const std::int32_t ends[2] = {edges[k], edges[k + 1]};
+			out.write(ends);
+		}
+		
+		if (out.commit())
+			std::cout << "File location: " << filePath << std::endl;
+	}
 
+	// The connectivity once, then the spheres of every pose in the order of the connectivity indices
+	void SphereMesh::saveSequenceTXT(const std::string& path, const std::string& fileName,
+	                                 const std::vector<std::vector<Math::Vector4>>& poses)
+	{
+		const std::string filePath = exportPath(path, fileName);
+		BufferedWriter out(filePath);
+		if (!out.isOpen())
+			return;
+		
+		std::vector<std::int32_t> triangles, edges;
+		exportConnectivity(triangles, edges);
+		
+		out.writeText("Sphere Mesh Sequence 1.0\n");
+		out.writeInteger(numberOfActiveSpheres);
+		out.writeText(" ");
+		out.writeInteger(static_cast<std::int64_t>(triangles.size() / 3));
+		out.writeText(" ");
+		out.writeInteger(static_cast<std::int64_t>(edges.size() / 2));
+		out.writeText(" ");
+		out.writeInteger(static_cast<std::int64_t>(poses.size()));
+		out.writeText("\n====================\n");
+		
+		for (size_t k = 0; k < triangles.size(); k += 3)
+		{
+			out.writeInteger(triangles[k]);
+			out.writeText(" ");
+			out.writeInteger(triangles[k + 1]);
+			out.writeText(" ");
+			out.writeInteger(triangles[k + 2]);
+			out.writeText("\n");
+		}
+		
+		for (size_t k = 0; k < edges.size(); k += 2)
+		{
+			out.writeInteger(edges[k]);
+			out.writeText(" ");
+			out.writeInteger(edges[k + 1]);
+			out.writeText("\n");
+		}
+		
+		for (size_t p = 0; p < poses.size(); p++)
+		{
+			out.writeText("Frame ");
+			out.writeInteger(static_cast<std::int64_t>(p));
+			out.writeText("\n");
+			
+			for (const Math::Vector4& s : poses[p])
+			{
+				out.writeDecimal(s[0]);
+				out.writeText(" ");
+				out.writeDecimal(s[1]);
+				out.writeText(" ");
+				out.writeDecimal(s[2]);
+				out.writeText(" ");
+				out.writeDecimal(s[3]);
+				out.writeText("\n");
+			}
+		}
+		
+		if (out.commit())
+			std::cout << "File location: " << filePath << std::endl;
+	}
+	
     void SphereMesh::addEdge(int selectedSphereID) {
         int selectedSphereIndex = sphereMapper[selectedSphereID];
         auto selectedSphere = timedSpheres[selectedSphereIndex];
@@ -1083,7 +3636,7 @@ namespace Renderer {
         sphereCopy.quadric = selectedSphere.sphere.quadric;
         sphereCopy.center += Math::Vector3(0.05, 0.05, 0) * BDDSize;
         
-        timedSpheres.emplace_back(Sphere(sphereCopy), timedSpheres.size(), performedOperations);
+        addTimedSphere(sphereCopy, static_cast<int>(timedSpheres.size()), performedOperations);
         edge.insert(Edge(selectedSphereIndex, (int)timedSpheres.size() - 1));
     }
 
@@ -1098,14 +3651,16 @@ namespace Renderer {
         sphereCopy.quadric = selectedA.sphere.quadric;
         sphereCopy.center += Math::Vector3(0.05, 0.05, 0) * BDDSize;
         
-        timedSpheres.emplace_back(Sphere(sphereCopy), timedSpheres.size(), performedOperations);
+        addTimedSphere(sphereCopy, static_cast<int>(timedSpheres.size()), performedOperations);
         triangle.insert(Triangle(idxA, idxB, (int)timedSpheres.size() - 1));
     }
 
     void SphereMesh::removeSphere(int selectedSphereID) {
         int selectedSphereIndex = sphereMapper[selectedSphereID];
 	    
-	    timedSpheres[selectedSphereIndex].alias = -1;
+	    aliases[selectedSphereIndex] = -1;
+		numberOfActiveSpheres--;
+		editState.operation = -1;
 		
 		for (auto it = triangle.begin(); it != triangle.end();)
 			if (it->i == selectedSphereIndex || it->j == selectedSphereIndex || it->k == selectedSphereIndex)
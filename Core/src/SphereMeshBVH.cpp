@@ -0,0 +1,659 @@
+#include <SphereMeshBVH.hpp>
+#include <SphereMesh.hpp>
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+namespace Renderer
+{
+	namespace
+	{
+		void computeBounds(EnvelopePrimitive& p)
+		{
+			p.boxMin = Math::Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+			p.boxMax = Math::Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+			for (int s = 0; s < p.count; s++)
+				for (short a = 0; a < 3; a++)
+				{
+					p.boxMin[a] = std::min(p.boxMin[a], p.centers[s][a] - p.radii[s]);
+					p.boxMax[a] = std::max(p.boxMax[a], p.centers[s][a] + p.radii[s]);
+				}
+		}
+
+		Math::Scalar boxDistance(const Math::Vector3& boxMin, const Math::Vector3& boxMax, const Math::Vector3& p)
+		{
+			Math::Scalar squared = 0;
+
+			for (short a = 0; a < 3; a++)
+			{
+				Math::Scalar d = std::max(boxMin[a] - p[a], std::max(static_cast<Math::Scalar>(0), p[a] - boxMax[a]));
+				squared += d * d;
+			}
+
+			return std::sqrt(squared);
+		}
+		
+		// Part of the ray inside a box (slab test), clipped to [0, maxDistance]. False when it misses
+		bool boxInterval(const Math::Vector3& boxMin, const Math::Vector3& boxMax, const Ray& ray,
+		                 const Math::Vector3& inverseDirection, Math::Scalar& entry, Math::Scalar& exit)
+		{
+			entry = 0;
+			exit = ray.maxDistance;
+			
+			for (short a = 0; a < 3; a++)
+			{
+				Math::Scalar near = (boxMin[a] - ray.origin[a]) * inverseDirection[a];
+				Math::Scalar far = (boxMax[a] - ray.origin[a]) * inverseDirection[a];
+				if (near > far)
+					std::swap(near, far);
+				
+				// A direction parallel to the slab gives NaN when the origin lies on one of its planes, and is ignored
+				if (near > entry)
+					entry = near;
+				if (far < exit)
+					exit = far;
+			}
+			
+			return entry <= exit;
+		}
+		
+		Math::Vector3 inverse(const Math::Vector3& direction)
+		{
+			return Math::Vector3(1 / direction[0], 1 / direction[1], 1 / direction[2]);
+		}
+	}
+
+	Math::Scalar SphereMeshBVH::sphereDistance(const Math::Vector3& c, Math::Scalar r, const Math::Vector3& p)
+	{
+		return (p - c).magnitude() - r;
+	}
+
+	// Minimizes |p - c(t)| - r(t) over the segment, the function is convex in t so the stationary point clamped to
+	// [0, 1] is the minimum: at that point the direction from c(t) to p makes a fixed angle with the axis
+	Math::Scalar SphereMeshBVH::coneDistance(const Math::Vector3& c0, Math::Scalar r0, const Math::Vector3& c1,
+											 Math::Scalar r1, const Math::Vector3& p, Math::Scalar& t)
+	{
+		Math::Vector3 axis = c1 - c0;
+		Math::Scalar length = axis.magnitude();
+		Math::Scalar dr = r1 - r0;
+
+		// One sphere contains the other, the cone degenerates to the bigger one
+		if (length <= std::abs(dr))
+		{
+			t = r1 > r0 ? 1 : 0;
+			return t == 1 ? sphereDistance(c1, r1, p) : sphereDistance(c0, r0, p);
+		}
+
+		axis /= length;
+
+		Math::Vector3 toP = p - c0;
+		Math::Scalar along = toP * axis;
+		Math::Scalar across = (toP - axis * along).magnitude();
+
+		Math::Scalar k = -dr / length;
+		Math::Scalar x = along - k * across / std::sqrt(1 - k * k);
+
+		t = std::clamp(x / length, static_cast<Math::Scalar>(0), static_cast<Math::Scalar>(1));
+
+		return sphereDistance(c0 + (c1 - c0) * t, r0 + dr * t, p);
+	}
+
+	// The stationary point inside the triangle of centers is found from the unit direction u with u.e1 = -dr1 and
+	// u.e2 = -dr2 (the tangent plane normal of the slab), when it falls outside the minimum lies on one of the edges
+	Math::Scalar SphereMeshBVH::slabDistance(const EnvelopePrimitive& primitive, const Math::Vector3& p,
+											 Math::Scalar weights[3])
+	{
+		const Math::Vector3& c0 = primitive.centers[0];
+		const Math::Scalar& r0 = primitive.radii[0];
+
+		Math::Vector3 e1 = primitive.centers[1] - c0;
+		Math::Vector3 e2 = primitive.centers[2] - c0;
+		Math::Scalar dr1 = primitive.radii[1] - r0;
+		Math::Scalar dr2 = primitive.radii[2] - r0;
+
+		Math::Scalar g11 = e1 * e1;
+		Math::Scalar g12 = e1 * e2;
+		Math::Scalar g22 = e2 * e2;
+		Math::Scalar det = g11 * g22 - g12 * g12;
+
+		Math::Vector3 normal = Math::Vector3::cross(e1, e2);
+		Math::Scalar normalLength = normal.magnitude();
+
+		if (det > 1e-20 && normalLength > 1e-20)
+		{
+			normal /= normalLength;
+
+			Math::Scalar alpha = (-dr1 * g22 + dr2 * g12) / det;
+			Math::Scalar beta = (-dr2 * g11 + dr1 * g12) / det;
+			Math::Vector3 inPlane = e1 * alpha + e2 * beta;
+			Math::Scalar inPlaneSquared = inPlane * inPlane;
+
+			if (inPlaneSquared < 1)
+			{
+				Math::Vector3 toP = p - c0;
+				Math::Scalar height = toP * normal;
+				Math::Scalar gamma = std::sqrt(1 - inPlaneSquared) * (height < 0 ? -1 : 1);
+
+				// Foot of the tangent point on the plane of the centers, in barycentric coordinates
+				Math::Vector3 foot = toP - inPlane * (height / gamma);
+				Math::Scalar b1 = foot * e1;
+				Math::Scalar b2 = foot * e2;
+				Math::Scalar l1 = (b1 * g22 - b2 * g12) / det;
+				Math::Scalar l2 = (b2 * g11 - b1 * g12) / det;
+
+				if (l1 >= 0 && l2 >= 0 && l1 + l2 <= 1)
+				{
+					weights[0] = 1 - l1 - l2;
+					weights[1] = l1;
+					weights[2] = l2;
+
+					Math::Vector3 u = inPlane + normal * gamma;
+					return u * toP - r0;
+				}
+			}
+		}
+
+		Math::Scalar best = DBL_MAX;
+
+		for (int e = 0; e < 3; e++)
+		{
+			int a = e, b = (e + 1) % 3;
+			Math::Scalar t;
+			Math::Scalar d = coneDistance(primitive.centers[a], primitive.radii[a], primitive.centers[b],
+										  primitive.radii[b], p, t);
+
+			if (d < best)
+			{
+				best = d;
+				weights[a] = 1 - t;
+				weights[b] = t;
+				weights[3 - a - b] = 0;
+			}
+		}
+
+		return best;
+	}
+
+	Math::Scalar SphereMeshBVH::signedDistance(const EnvelopePrimitive& primitive, const Math::Vector3& p,
+											   Math::Scalar weights[3])
+	{
+		if (primitive.count == 1)
+		{
+			weights[0] = 1;
+			return sphereDistance(primitive.centers[0], primitive.radii[0], p);
+		}
+
+		if (primitive.count == 2)
+		{
+			Math::Scalar t;
+			Math::Scalar d = coneDistance(primitive.centers[0], primitive.radii[0], primitive.centers[1],
+										  primitive.radii[1], p, t);
+			weights[0] = 1 - t;
+			weights[1] = t;
+			return d;
+		}
+
+		return slabDistance(primitive, p, weights);
+	}
+
+	// A sphere is intersected in closed form. Capsules and slabs are convex and their distance is exact outside, so
+	// sphere tracing from the entry of their box never steps through the surface. A grazing ray closes in on it too
+	// slowly for the steps: the distance along the ray is convex as well, so once they run out the rest of the box
+	// interval is searched for its minimum, and the first point within epsilon bisected between the last step and
+	// a point below it
+	Math::Scalar SphereMeshBVH::rayDistance(const EnvelopePrimitive& primitive, const Ray& ray)
+	{
+		if (primitive.count == 1)
+		{
+			Math::Vector3 toOrigin = ray.origin - primitive.centers[0];
+			Math::Scalar b = toOrigin * ray.direction;
+			Math::Scalar c = toOrigin * toOrigin - primitive.radii[0] * primitive.radii[0];
+			
+			if (c <= 0)
+				return 0;
+			
+			Math::Scalar discriminant = b * b - c;
+			if (discriminant < 0 || b > 0)
+				return DBL_MAX;
+			
+			Math::Scalar t = -b - std::sqrt(discriminant);
+			return t <= ray.maxDistance ? t : DBL_MAX;
+		}
+		
+		Math::Scalar entry, exit;
+		if (!boxInterval(primitive.boxMin, primitive.boxMax, ray, inverse(ray.direction), entry, exit))
+			return DBL_MAX;
+		
+		Math::Scalar largestRadius = *std::max_element(primitive.radii, primitive.radii + primitive.count);
+		Math::Scalar epsilon = RAY_EPSILON * std::max(largestRadius, static_cast<Math::Scalar>(FLT_EPSILON));
+		
+		Math::Scalar weights[3];
+		auto distanceAt = [&](Math::Scalar t)
+		{
+			return signedDistance(primitive, ray.origin + ray.direction * t, weights);
+		};
+		
+		Math::Scalar t = entry;
+		for (int step = 0; step < RAY_STEPS && t <= exit; step++)
+		{
+			Math::Scalar d = distanceAt(t);
+			if (d <= epsilon)
+				return t;
+			
+			t += d;
+		}
+		
+		if (t > exit)
+			return DBL_MAX;
+		
+		// Ternary search: what is cut before the minimum is all further than epsilon, so the first hit is after low
+		Math::Scalar low = t, high = exit, inside = -1;
+		for (int step = 0; step < RAY_SEARCH_STEPS && inside < 0; step++)
+		{
+			Math::Scalar a = low + (high - low) / 3;
+			Math::Scalar b = high - (high - low) / 3;
+			Math::Scalar da = distanceAt(a);
+			Math::Scalar db = da <= epsilon ? da : distanceAt(b);
+			
+			if (da <= epsilon)
+				inside = a;
+			else if (db <= epsilon)
+				inside = b;
+			else if (da < db)
+				high = b;
+			else
+				low = a;
+		}
+		
+		if (inside < 0)
+			return DBL_MAX;
+		
+		high = inside;
+		for (int step = 0; step < RAY_SEARCH_STEPS; step++)
+		{
+			Math::Scalar middle = (low + high) / 2;
+			if (distanceAt(middle) <= epsilon)
+				high = middle;
+			else
+				low = middle;
+		}
+		
+		return high;
+	}
+	
+	void SphereMeshBVH::build(SphereMesh& sm)
+	{
+		std::vector<EnvelopePrimitive> envelope;
+		std::vector<bool> covered(sm.timedSpheres.size(), false);
+
+		auto resolve = [&](int i) { return sm.isTimedSphereRemoved(i) ? -1 : sm.alias(i); };
+
+		auto add = [&](std::initializer_list<int> spheres)
+		{
+			EnvelopePrimitive p;
+
+			for (int s : spheres)
+			{
+				p.spheres[p.count] = s;
+				p.centers[p.count] = sm.timedSpheres[s].sphere.center;
+				p.radii[p.count] = std::max(static_cast<Math::Scalar>(0), sm.timedSpheres[s].sphere.radius);
+				p.count++;
+
+				covered[s] = true;
+			}
+
+			computeBounds(p);
+			envelope.push_back(p);
+		};
+
+		// Connectivity is only refreshed at the end of a collapse run, so indices are resolved through the aliases
+		for (const Triangle& t : sm.getTriangles())
+		{
+			int i = resolve(t.i), j = resolve(t.j), k = resolve(t.k);
+
+			if (i < 0 || j < 0 || k < 0)
+				continue;
+
+			if (i != j && j != k && i != k)
+				add({i, j, k});
+			else if (i != j || j != k)
+				add({i, i != j ? j : k});
+		}
+
+		for (const Edge& e : sm.getEdges())
+		{
+			int i = resolve(e.i), j = resolve(e.j);
+
+			if (i >= 0 && j >= 0 && i != j)
+				add({i, j});
+		}
+
+		for (int i = 0; i < static_cast<int>(sm.timedSpheres.size()); i++)
+			if (!covered[i] && sm.isTimedSphereAlive(i))
+				add({i});
+
+		build(envelope);
+	}
+
+	void SphereMeshBVH::build(const std::vector<EnvelopePrimitive>& envelope)
+	{
+		primitives = envelope;
+		nodes.clear();
+
+		order.resize(primitives.size());
+		for (int i = 0; i < static_cast<int>(order.size()); i++)
+			order[i] = i;
+
+		if (!primitives.empty())
+		{
+			nodes.reserve(2 * primitives.size() / LEAF_SIZE + 1);
+			buildNode(0, static_cast<int>(primitives.size()));
+		}
+	}
+
+	// Median split of the primitive centroids along the longest axis of their bounds
+	int SphereMeshBVH::buildNode(int first, int count)
+	{
+		int index = static_cast<int>(nodes.size());
+		nodes.emplace_back();
+
+		Node node;
+		node.boxMin = Math::Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+		node.boxMax = Math::Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		Math::Vector3 centroidMin = node.boxMin;
+		Math::Vector3 centroidMax = node.boxMax;
+
+		for (int i = first; i < first + count; i++)
+		{
+			const EnvelopePrimitive& p = primitives[order[i]];
+
+			for (short a = 0; a < 3; a++)
+			{
+				node.boxMin[a] = std::min(node.boxMin[a], p.boxMin[a]);
+				node.boxMax[a] = std::max(node.boxMax[a], p.boxMax[a]);
+
+				Math::Scalar centroid = (p.boxMin[a] + p.boxMax[a]) / 2;
+				centroidMin[a] = std::min(centroidMin[a], centroid);
+				centroidMax[a] = std::max(centroidMax[a], centroid);
+			}
+
+			for (int s = 0; s < p.count; s++)
+				node.maxRadius = std::max(node.maxRadius, p.radii[s]);
+		}
+
+		if (count <= LEAF_SIZE)
+		{
+			node.first = first;
+			node.count = count;
+			nodes[index] = node;
+			return index;
+		}
+
+		Math::Vector3 extent = centroidMax - centroidMin;
+		short axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+
+		int half = count / 2;
+		std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+						 [&](int a, int b)
+						 {
+							 return primitives[a].boxMin[axis] + primitives[a].boxMax[axis] <
+									primitives[b].boxMin[axis] + primitives[b].boxMax[axis];
+						 });
+
+		node.left = buildNode(first, half);
+		node.right = buildNode(first + half, count - half);
+		nodes[index] = node;
+
+		return index;
+	}
+
+	bool SphereMeshBVH::empty() const
+	{
+		return primitives.empty();
+	}
+
+	// Depth-first traversal, nearest child first. A node cannot get closer than its box from outside, nor deeper
+	// than its largest radius from inside
+	EnvelopeHit SphereMeshBVH::closest(const Math::Vector3& p) const
+	{
+		EnvelopeHit hit;
+		hit.distance = DBL_MAX;
+
+		if (nodes.empty())
+			return hit;
+
+		auto lowerBound = [&](const Node& n)
+		{
+			Math::Scalar outside = boxDistance(n.boxMin, n.boxMax, p);
+			return outside > 0 ? outside : -n.maxRadius;
+		};
+
+		int stack[64];
+		Math::Scalar bounds[64];
+		int top = 0;
+
+		stack[top] = 0;
+		bounds[top++] = lowerBound(nodes[0]);
+
+		while (top > 0)
+		{
+			--top;
+			if (bounds[top] >= hit.distance)
+				continue;
+
+			const Node& n = nodes[stack[top]];
+
+			if (n.left < 0)
+			{
+				for (int i = n.first; i < n.first + n.count; i++)
+				{
+					Math::Scalar weights[3]{0, 0, 0};
+					Math::Scalar d = signedDistance(primitives[order[i]], p, weights);
+
+					if (d < hit.distance)
+					{
+						hit.distance = d;
+						hit.primitive = order[i];
+						std::copy(weights, weights + 3, hit.weights);
+					}
+				}
+
+				continue;
+			}
+
+			Math::Scalar leftBound = lowerBound(nodes[n.left]);
+			Math::Scalar rightBound = lowerBound(nodes[n.right]);
+
+			// Push the farther child first so the nearer one is visited next
+			if (leftBound < rightBound)
+			{
+				stack[top] = n.right; bounds[top++] = rightBound;
+				stack[top] = n.left; bounds[top++] = leftBound;
+			}
+			else
+			{
+				stack[top] = n.left; bounds[top++] = leftBound;
+				stack[top] = n.right; bounds[top++] = rightBound;
+			}
+		}
+
+		return hit;
+	}
+	
+	// Nearest box first, a node whose box starts beyond the closest hit so far is skipped
+	RayHit SphereMeshBVH::raycast(const Ray& ray) const
+	{
+		RayHit hit;
+		
+		if (nodes.empty())
+			return hit;
+		
+		const Math::Vector3 inverseDirection = inverse(ray.direction);
+		Math::Scalar entry, exit;
+		if (!boxInterval(nodes[0].boxMin, nodes[0].boxMax, ray, inverseDirection, entry, exit))
+			return hit;
+		
+		int stack[64];
+		Math::Scalar entries[64];
+		int top = 0;
+		
+		stack[top] = 0;
+		entries[top++] = entry;
+		
+		while (top > 0)
+		{
+			--top;
+			if (entries[top] >= hit.distance)
+				continue;
+			
+			const Node& n = nodes[stack[top]];
+			
+			if (n.left < 0)
+			{
+				for (int i = n.first; i < n.first + n.count; i++)
+				{
+					Math::Scalar t = rayDistance(primitives[order[i]], ray);
+					if (t < hit.distance)
+					{
+						hit.distance = t;
+						hit.primitive = order[i];
+					}
+				}
+				
+				continue;
+			}
+			
+			Math::Scalar leftEntry, rightEntry;
+			bool left = boxInterval(nodes[n.left].boxMin, nodes[n.left].boxMax, ray, inverseDirection, leftEntry, exit);
+			bool right = boxInterval(nodes[n.right].boxMin, nodes[n.right].boxMax, ray, inverseDirection, rightEntry, exit);
+			
+			if (left && right && leftEntry < rightEntry)
+			{
+				stack[top] = n.right; entries[top++] = rightEntry;
+				stack[top] = n.left; entries[top++] = leftEntry;
+			}
+			else
+			{
+				if (left)
+				{
+					stack[top] = n.left; entries[top++] = leftEntry;
+				}
+				if (right)
+				{
+					stack[top] = n.right; entries[top++] = rightEntry;
+				}
+			}
+		}
+		
+		return hit;
+	}
+	
+	// The distance is exact outside the primitives, so a sphere touches one exactly when its center is closer than
+	// its radius
+	bool SphereMeshBVH::overlaps(const Math::Vector4& sphere) const
+	{
+		if (nodes.empty())
+			return false;
+		
+		const Math::Vector3 center = sphere.truncateToVector3();
+		const Math::Scalar radius = sphere.coordinates.w;
+		
+		int stack[64];
+		int top = 0;
+		stack[top++] = 0;
+		
+		while (top > 0)
+		{
+			const Node& n = nodes[stack[--top]];
+			if (boxDistance(n.boxMin, n.boxMax, center) > radius)
+				continue;
+			
+			if (n.left < 0)
+			{
+				Math::Scalar weights[3];
+				for (int i = n.first; i < n.first + n.count; i++)
+					if (signedDistance(primitives[order[i]], center, weights) < radius)
+						return true;
+				
+				continue;
+			}
+			
+			stack[top++] = n.left;
+			stack[top++] = n.right;
+		}
+		
+		return false;
+	}
+	
+	// In increasing order of primitive
+	void SphereMeshBVH::overlapping(const Math::Vector4& sphere, std::vector<int>& touched) const
+	{
+		touched.clear();
+		if (nodes.empty())
+			return;
+		
+		const Math::Vector3 center = sphere.truncateToVector3();
+		const Math::Scalar radius = sphere.coordinates.w;
+		
+		int stack[64];
+		int top = 0;
+		stack[top++] = 0;
+		
+		while (top > 0)
+		{
+			const Node& n = nodes[stack[--top]];
+			if (boxDistance(n.boxMin, n.boxMax, center) > radius)
+				continue;
+			
+			if (n.left < 0)
+			{
+				Math::Scalar weights[3];
+				for (int i = n.first; i < n.first + n.count; i++)
+					if (signedDistance(primitives[order[i]], center, weights) < radius)
+						touched.push_back(order[i]);
+				
+				continue;
+			}
+			
+			stack[top++] = n.left;
+			stack[top++] = n.right;
+		}
+		
+		std::sort(touched.begin(), touched.end());
+	}
+	
+	void SphereMeshBVH::closest(const std::vector<Math::Vector3>& points, std::vector<EnvelopeHit>& hits) const
+	{
+		const int n = static_cast<int>(points.size());
+		hits.resize(n);
+		
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int i = 0; i < n; i++)
+			hits[i] = closest(points[i]);
+	}
+	
+	void SphereMeshBVH::raycast(const std::vector<Ray>& rays, std::vector<RayHit>& hits) const
+	{
+		const int n = static_cast<int>(rays.size());
+		hits.resize(n);
+		
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int i = 0; i < n; i++)
+			hits[i] = raycast(rays[i]);
+	}
+	
+	void SphereMeshBVH::overlaps(const std::vector<Math::Vector4>& spheres, std::vector<std::uint8_t>& results) const
+	{
+		const int n = static_cast<int>(spheres.size());
+		results.resize(n);
+		
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int i = 0; i < n; i++)
+			results[i] = overlaps(spheres[i]) ? 1 : 0;
+	}
+}
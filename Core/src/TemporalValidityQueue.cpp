@@ -23,8 +23,19 @@ namespace Renderer
 	
 	void TemporalValidityQueue::clear ()
 	{
-		std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<>> empty;
+		Heap empty;
 		std::swap(q, empty);
+		isDirty = false;
+	}
+	
+	const std::vector<EdgeCollapse>& TemporalValidityQueue::entries () const
+	{
+		return q.entries();
+	}
+	
+	void TemporalValidityQueue::assign (std::vector<EdgeCollapse> heapEntries)
+	{
+		q.entries() = std::move(heapEntries);
 	}
 	
 	bool TemporalValidityQueue::empty ()
@@ -47,7 +58,7 @@ namespace Renderer
 		isDirty = false;
 	}
 	
-	EdgeCollapse TemporalValidityQueue::top ()
+	const EdgeCollapse& TemporalValidityQueue::top () const
 	{
 //		if (q.empty())
 //			return {};
@@ -65,11 +76,26 @@ namespace Renderer
 		return q.top();
 	}
 	
+	Math::Scalar TemporalValidityQueue::topCost () const
+	{
+		return q.top().cost;
+	}
+	
 	void TemporalValidityQueue::push (const EdgeCollapse &collapsableEdge)
 	{
 		q.push(collapsableEdge);
 	}
 	
+	void TemporalValidityQueue::push (EdgeCollapse&& collapsableEdge)
+	{
+		q.push(std::move(collapsableEdge));
+	}
+	
+	EdgeCollapse TemporalValidityQueue::extractTop ()
+	{
+		return q.extract();
+	}
+	
 	void TemporalValidityQueue::pop ()
 	{
 		if (q.empty()) return;
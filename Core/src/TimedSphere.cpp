@@ -6,23 +6,12 @@
 
 namespace Renderer
 {
-	TimedSphere::TimedSphere(const Sphere& _sphere, int aliasID, int _timestamp)
-			: sphere(_sphere), alias(aliasID), timestamp(_timestamp)
+	TimedSphere::TimedSphere(const Sphere& _sphere) : sphere(_sphere)
 	{
-		auto now = std::chrono::system_clock::now();
-		auto duration = now.time_since_epoch();
-		
 	}
 	
 	TimedSphere::TimedSphere (const TimedSphere &other)
 	{
 		this->sphere = other.sphere;
-		this->alias = other.alias;
-		this->timestamp = other.timestamp;
 	}
-	
-	bool TimedSphere::operator==(const TimedSphere &rhs) const
-	{
-		return this->alias == rhs.alias && this->timestamp == rhs.timestamp;
-	}
-}
\ No newline at end of file
+}
@@ -8,8 +8,10 @@
 #include <glad/glad.h>
 
 #include <TriMesh.hpp>
+#include <GLState.hpp>
 
 #include <ObjLoader.hpp>
+#include <FileIO.hpp>
 
 #include <Vector4.hpp>
 #include <Matrix4.hpp>
@@ -20,17 +22,53 @@
 
 #include <igl/principal_curvature.h>
 
+#include <omp.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <random>
 #include <unordered_map>
 
 namespace Renderer {
-    TriMesh::TriMesh(const std::string& pathToLoadFrom, Shader* s) : shader(s) {
-        ObjLoader loader = ObjLoader();
+    TriMesh::TriMesh(const std::string& pathToLoadFrom, Shader* s, bool spatialOrder) : shader(s) {
+        path = pathToLoadFrom;
+        
+        if (!loadOBJ(pathToLoadFrom))
+            return;
+        
+        if (spatialOrder)
+            sortSpatially();
+        
+        finishLoading();
+    }
+
+    TriMesh::TriMesh(const std::string& pathToLoadFrom, Shader* s, const PreprocessCache& cache, bool spatialOrder)
+        : shader(s) {
         path = pathToLoadFrom;
+        preprocessedEntry = cache.meshEntry(pathToLoadFrom, spatialOrder);
+        
+        if (!loadPreprocessed())
+        {
+            if (!loadOBJ(pathToLoadFrom))
+                return;
+            
+            if (spatialOrder)
+                sortSpatially();
+            
+            savePreprocessed();
+        }
+        
+        finishLoading();
+    }
+    
+    bool TriMesh::loadOBJ(const std::string& pathToLoadFrom) {
+        ObjLoader loader = ObjLoader();
         
         if (!loader.loadOBJ(pathToLoadFrom)) {
             std::cerr << "ERROR LOADING THE OBJ MODEL" << std::endl;
-            return;
+            return false;
         }
         
         for (int i = 0; i < loader.vertices.size(); i++) {
@@ -47,10 +85,92 @@ namespace Renderer {
             this->faces.push_back(Face(loader.indices[i], loader.indices[i + 1], loader.indices[i + 2]));
 	    
 	    updateVertexNormals();
+        return true;
+    }
+    
+    namespace
+    {
+        // Bits of every coordinate in a Morton code, three of them fill 63 bits
+        constexpr int MORTON_BITS = 21;
         
-        setup();
+        // Spreads the low 21 bits of x two bits apart
+        std::uint64_t spreadMortonBits(std::uint64_t x)
+        {
+            x &= 0x1fffff;
+            x = (x | x << 32) & 0x1f00000000ffff;
+            x = (x | x << 16) & 0x1f0000ff0000ff;
+            x = (x | x << 8) & 0x100f00f00f00f00f;
+            x = (x | x << 4) & 0x10c30c30c30c30c3;
+            x = (x | x << 2) & 0x1249249249249249;
+            return x;
+        }
+    }
+    
+    // The codes come from the positions quantised on the longest side of the bounding box, ties keep the file
+    // order so the result only depends on the file. Faces are sorted by their smallest vertex, a face and its
+    // vertices end up in the same part of the arrays
+    void TriMesh::sortSpatially()
+    {
+        const int n = static_cast<int>(vertices.size());
+        
+        AABB box;
+        for (const Vertex& v : vertices)
+            box.addPoint(v.position);
+        
+        Math::Vector3 extent = box.BDD();
+        Math::Scalar side = std::max({extent[0], extent[1], extent[2]});
+        Math::Scalar scale = side > 0 ? ((1 << MORTON_BITS) - 1) / side : 0;
+        
+        std::vector<std::pair<std::uint64_t, int>> codes(n);
+        for (int i = 0; i < n; i++)
+        {
+            std::uint64_t code = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                auto cell = static_cast<std::uint64_t>((vertices[i].position[k] - box.minCorner[k]) * scale);
+                code |= spreadMortonBits(cell) << k;
+            }
+            
+            codes[i] = {code, i};
+        }
         
-        computeVerticesCurvatureIGL();
+        std::sort(codes.begin(), codes.end());
+        
+        std::vector<Vertex> sorted(n);
+        std::vector<int> newIndices(n);
+        fileIndices.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            const int original = codes[i].second;
+            
+            sorted[i] = vertices[original];
+            newIndices[original] = i;
+            fileIndices[i] = original;
+        }
+        
+        vertices = std::move(sorted);
+        
+        for (Face& f : faces)
+            f = Face(newIndices[f.i], newIndices[f.j], newIndices[f.k]);
+        
+        std::stable_sort(faces.begin(), faces.end(), [](const Face& a, const Face& b)
+        {
+            return std::min({a.i, a.j, a.k}) < std::min({b.i, b.j, b.k});
+        });
+    }
+    
+    std::vector<int> TriMesh::fileToVertexIndices() const
+    {
+        std::vector<int> indices(vertices.size());
+        
+        for (int i = 0; i < static_cast<int>(indices.size()); i++)
+            indices[toFileIndex(i)] = i;
+        
+        return indices;
+    }
+    
+    void TriMesh::finishLoading() {
+        setup();
         
         generateUUID();
         updateBBOX();
@@ -66,7 +186,20 @@ namespace Renderer {
         
         setup();
         
-        computeVerticesCurvatureIGL();
+        generateUUID();
+        updateBBOX();
+        
+        this->setBlended(true);
+    }
+	
+    TriMesh::TriMesh(const TriMesh& mesh, const std::vector<int>& vertexIndices, const std::vector<Face>& faces)
+        : shader(nullptr), curvatureComputed(mesh.curvatureComputed) {
+        vertices.reserve(vertexIndices.size());
+        for (int v : vertexIndices)
+            vertices.push_back(mesh.vertices[v]);
+        
+        this->faces = faces;
+        cacheCurvature = false;
         
         generateUUID();
         updateBBOX();
@@ -96,12 +229,70 @@ namespace Renderer {
 			v.normal.normalize();
 	}
 
+    namespace
+    {
+        // Neighbourhood used by igl::principal_curvature by default: the 5-ring of every vertex
+        constexpr int CURVATURE_RINGS = 5;
+        constexpr char CURVATURE_CACHE_MAGIC[8] = {'S', 'M', 'C', 'U', 'R', 'V', '1', '\0'};
+        constexpr char PREPROCESSED_MESH_MAGIC[8] = {'S', 'M', 'M', 'E', 'S', 'H', '2', '\0'};
+
+        // CurvatureCalculator::getKRing, with the visited flags kept across calls as a per-thread stamp instead of
+        // a mesh-sized vector allocated for every vertex. The neighbours come out in the same (breadth first) order
+        void ringNeighbourhood(const CurvatureCalculator& cc, int start, int rings, std::vector<int>& stamp,
+                               std::vector<std::pair<int, int>>& queue, std::vector<int>& vv)
+        {
+            queue.clear();
+            queue.emplace_back(start, 0);
+            stamp[start] = start;
+
+            for (size_t front = 0; front < queue.size(); front++)
+            {
+                auto [toVisit, distance] = queue[front];
+                vv.push_back(toVisit);
+
+                // Vertices past the last one referenced by a face have no adjacency list
+                if (distance >= rings || toVisit >= static_cast<int>(cc.vertex_to_vertices.size()))
+                    continue;
+
+                for (int neighbor : cc.vertex_to_vertices[toVisit])
+                {
+                    if (stamp[neighbor] == start)
+                        continue;
+
+                    queue.emplace_back(neighbor, distance + 1);
+                    stamp[neighbor] = start;
+                }
+            }
+        }
+    }
+
+    void TriMesh::ensureCurvature()
+    {
+        if (curvatureComputed)
+            return;
+
+        if (!cacheCurvature || !loadCurvatureCache())
+        {
+            computeVerticesCurvatureIGL();
+
+            if (cacheCurvature)
+                saveCurvatureCache();
+        }
+
+        // The preprocessed entry was written without curvatures, the next open finds them there
+        savePreprocessed();
+    }
+
+    // Same result as igl::principal_curvature with its default k-ring search, the per-vertex fits are independent
+    // and run in parallel
     void TriMesh::computeVerticesCurvatureIGL()
     {
-        Eigen::MatrixXd v(vertices.size(), 3);
+        const int n = static_cast<int>(vertices.size());
+
+        Eigen::MatrixXd v(n, 3);
         Eigen::MatrixXi f(faces.size(), 3);
 
-        for (int i = 0; i < vertices.size(); ++i) {
+        for (int i = 0; i < n; ++i) {
             v(i, 0) = vertices[i].position.coordinates.x;
             v(i, 1) = vertices[i].position.coordinates.y;
             v(i, 2) = vertices[i].position.coordinates.z;
@@ -113,15 +304,257 @@ namespace Renderer {
             f(i, 2) = faces[i].k;
         }
         
-        Eigen::MatrixXd PD1, PD2;
-        Eigen::VectorXd PV1, PV2;
+        for (Vertex& vertex : vertices)
+            vertex.curvature = Math::Vector2();
+        
+        curvatureComputed = true;
+        
+        if (n == 0 || faces.empty())
+            return;
+        
+        CurvatureCalculator cc;
+        cc.init(v, f);
+        cc.curv.assign(n, {});
+        cc.curvDir.assign(n, {});
+        
+        #pragma omp parallel
+        {
+            std::vector<int> stamp(n, -1);
+            std::vector<std::pair<int, int>> queue;
+            std::vector<int> vv, vvtmp;
+            std::vector<Eigen::Vector3d> ref(3);
+            Eigen::Vector3d normal;
+            
+            #pragma omp for schedule(dynamic, 256)
+            for (int i = 0; i < n; i++)
+            {
+                vv.clear();
+                vvtmp.clear();
+                
+                ringNeighbourhood(cc, i, CURVATURE_RINGS, stamp, queue, vv);
+                if (vv.size() < 6)
+                    continue;
+                
+                // projectionPlaneCheck and the average normal, as in CurvatureCalculator::computeCurvature
+                cc.applyProjOnPlane(cc.vertex_normals.row(i), vv, vvtmp);
+                if (vvtmp.size() >= 6 && vvtmp.size() < vv.size())
+                    vv.swap(vvtmp);
+                
+                cc.getAverageNormal(i, vv, normal);
+                
+                CurvatureCalculator::Quadric q;
+                cc.computeReferenceFrame(i, normal, ref);
+                cc.fitQuadric(cc.vertices.row(i), ref, vv, &q);
+                cc.finalEigenStuff(i, ref, q);
+            }
+        }
+        
+        for (int i = 0; i < n; i++)
+            if (!cc.curv[i].empty())
+                vertices[i].curvature = Math::Vector2(cc.curv[i][0], cc.curv[i][1]);
+    }
+    
+    std::uint64_t TriMesh::getContentHash() const
+    {
+        std::uint64_t hash = hashBytes(nullptr, 0);
+        
+        for (const Vertex& vertex : vertices)
+        {
+            double p[3] = {vertex.position.coordinates.x, vertex.position.coordinates.y, vertex.position.coordinates.z};
+            hash = hashBytes(p, sizeof(p), hash);
+        }
+        
+        for (const Face& face : faces)
+        {
+            int indices[3] = {face.i, face.j, face.k};
+            hash = hashBytes(indices, sizeof(indices), hash);
+        }
+        
+        return hash;
+    }
+    
+    std::string TriMesh::curvatureCachePath() const
+    {
+        if (path.empty())
+            return {};
+        
+        return path + (isSpatiallyOrdered() ? ".sorted.curvature" : ".curvature");
+    }
+    
+    // Layout: magic, content hash, vertex count, then k1 k2 per vertex as doubles
+    bool TriMesh::loadCurvatureCache()
+    {
+        const std::string cachePath = curvatureCachePath();
+        if (cachePath.empty() || !std::filesystem::exists(cachePath))
+            return false;
+        
+        std::ifstream in(cachePath, std::ios::binary);
+        
+        char magic[sizeof(CURVATURE_CACHE_MAGIC)];
+        std::uint64_t hash = 0, count = 0;
+        
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        
+        if (!in || std::memcmp(magic, CURVATURE_CACHE_MAGIC, sizeof(magic)) != 0 || count != vertices.size() ||
+            hash != getContentHash())
+            return false;
+        
+        std::vector<double> values(2 * count);
+        in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+        if (!in)
+            return false;
+        
+        for (size_t i = 0; i < vertices.size(); i++)
+            vertices[i].curvature = Math::Vector2(values[2 * i], values[2 * i + 1]);
+        
+        curvatureComputed = true;
+        return true;
+    }
+    
+    // Written next to the final file and renamed over it, an interrupted write never leaves a truncated cache.
+    // A model folder that can't be written to just goes without cache
+    void TriMesh::saveCurvatureCache() const
+    {
+        const std::string cachePath = curvatureCachePath();
+        if (cachePath.empty())
+            return;
+        
+        const std::string temporaryPath = cachePath + ".tmp";
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+                return;
+            
+            std::uint64_t hash = getContentHash();
+            std::uint64_t count = vertices.size();
+            
+            std::vector<double> values;
+            values.reserve(2 * count);
+            for (const Vertex& vertex : vertices)
+            {
+                values.push_back(vertex.curvature.coordinates.x);
+                values.push_back(vertex.curvature.coordinates.y);
+            }
+            
+            out.write(CURVATURE_CACHE_MAGIC, sizeof(CURVATURE_CACHE_MAGIC));
+            out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+            
+            if (!out)
+            {
+                out.close();
+                std::filesystem::remove(temporaryPath);
+                return;
+            }
+        }
+        
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, cachePath, error);
+        if (error)
+            std::filesystem::remove(temporaryPath, error);
+    }
+    
+    // Layout: magic, then positions, normals, colors and curvatures (empty until computed) as double arrays, the
+    // face indices and the file index of every vertex (empty in file order) as int arrays, every array prefixed by
+    // its length
+    bool TriMesh::loadPreprocessed()
+    {
+        if (preprocessedEntry.empty())
+            return false;
+        
+        MappedFile file(preprocessedEntry);
+        if (!file.isOpen())
+            return false;
+        
+        BinaryReader in(file);
+        const char* magic = in.take(sizeof(PREPROCESSED_MESH_MAGIC));
+        
+        auto positions = in.readArray<double>();
+        auto normals = in.readArray<double>();
+        auto colors = in.readArray<double>();
+        auto curvatures = in.readArray<double>();
+        auto indices = in.readArray<std::int32_t>();
+        auto order = in.readArray<std::int32_t>();
+        
+        const size_t n = positions.size() / 3;
+        if (!in.ok() || std::memcmp(magic, PREPROCESSED_MESH_MAGIC, sizeof(PREPROCESSED_MESH_MAGIC)) != 0 ||
+            positions.size() != 3 * n || normals.size() != 3 * n || colors.size() != 3 * n ||
+            (!curvatures.empty() && curvatures.size() != 2 * n) || indices.size() % 3 != 0 ||
+            (!order.empty() && order.size() != n))
+            return false;
+        
+        for (std::int32_t index : indices)
+            if (index < 0 || static_cast<size_t>(index) >= n)
+                return false;
+        
+        for (std::int32_t index : order)
+            if (index < 0 || static_cast<size_t>(index) >= n)
+                return false;
+        
+        vertices.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            Vertex& v = vertices[i];
+            v.position = Math::Vector3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+            v.normal = Math::Vector3(normals[3 * i], normals[3 * i + 1], normals[3 * i + 2]);
+            v.color = Math::Vector3(colors[3 * i], colors[3 * i + 1], colors[3 * i + 2]);
+            v.curvature = curvatures.empty() ? Math::Vector2() : Math::Vector2(curvatures[2 * i], curvatures[2 * i + 1]);
+        }
+        
+        faces.resize(indices.size() / 3);
+        for (size_t i = 0; i < faces.size(); i++)
+            faces[i] = Face(indices[3 * i], indices[3 * i + 1], indices[3 * i + 2]);
         
-        std::vector<int> bad_vertices;
+        fileIndices.assign(order.begin(), order.end());
+        curvatureComputed = !curvatures.empty();
+        return true;
+    }
+    
+    void TriMesh::savePreprocessed() const
+    {
+        if (preprocessedEntry.empty())
+            return;
+        
+        BufferedWriter out(preprocessedEntry);
+        if (!out.isOpen())
+            return;
+        
+        std::vector<double> positions, normals, colors, curvatures;
+        positions.reserve(3 * vertices.size());
+        normals.reserve(3 * vertices.size());
+        colors.reserve(3 * vertices.size());
+        
+        for (const Vertex& v : vertices)
+            for (int k = 0; k < 3; k++)
+            {
+                positions.push_back(v.position[k]);
+                normals.push_back(v.normal[k]);
+                colors.push_back(v.color[k]);
+            }
+        
+        if (curvatureComputed)
+            for (const Vertex& v : vertices)
+            {
+                curvatures.push_back(v.curvature.coordinates.x);
+                curvatures.push_back(v.curvature.coordinates.y);
+            }
         
-        igl::principal_curvature(v, f, PD1, PD2, PV1, PV2, bad_vertices);
+        std::vector<std::int32_t> indices;
+        indices.reserve(3 * faces.size());
+        for (const Face& f : faces)
+            indices.insert(indices.end(), {f.i, f.j, f.k});
         
-        for (int i = 0; i < this->vertices.size(); i++)
-            vertices[i].curvature = Math::Vector2(PV1(i, 0), PV2(i, 0));
+        out.write(PREPROCESSED_MESH_MAGIC, sizeof(PREPROCESSED_MESH_MAGIC));
+        out.writeArray(positions);
+        out.writeArray(normals);
+        out.writeArray(colors);
+        out.writeArray(curvatures);
+        out.writeArray(indices);
+        out.writeArray(std::vector<std::int32_t>(fileIndices.begin(), fileIndices.end()));
+        out.commit();
     }
 
     void TriMesh::computeVerticesCurvature()
@@ -453,6 +886,13 @@ namespace Renderer {
         isPickable = false;
         model = Math::Matrix4();
         
+        if (!vertices.empty())
+            fillColor = vertices[0].color;
+        
+        // Headless meshes (benchmarks, batch tools) have no shader and no GL context to upload to
+        if (shader == nullptr)
+            return;
+        
         std::vector<float> vertexFloats;
         vertexFloats.reserve(vertices.size() * 6); // 3 for position, 3 for normals
 
@@ -476,7 +916,7 @@ namespace Renderer {
         }
 
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
 
         glGenBuffers(1, &VBO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -494,44 +934,23 @@ namespace Renderer {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, faceIndices.size() * sizeof(unsigned int), faceIndices.data(), GL_STATIC_DRAW);
 
-        glBindVertexArray(0);
+        GLState::bindVertexArray(0);
     }
 
     void TriMesh::setColors(const std::vector<Math::Vector3>& colors) {
-        // Update colors in CPU-side vertex data
         for (size_t i = 0; i < colors.size() && i < vertices.size(); i++)
             vertices[i].color = colors[i];
 
-        updateGPUVertexData();
+        // The shader colors the whole mesh through material.ambient, the first vertex color stands for it
+        if (!vertices.empty())
+            fillColor = vertices[0].color;
     }
 
     void TriMesh::setUniformColor(Math::Vector3 color) {
         for (auto& vertex : vertices)
             vertex.color = color;
 
-        updateGPUVertexData();
-    }
-
-    void TriMesh::updateGPUVertexData() {
-        // Pack vertex data
-        std::vector<float> vertexFloats;
-        vertexFloats.reserve(vertices.size() * 11);
-
-        for (const auto& vertex : vertices) {
-            vertexFloats.push_back(vertex.position.coordinates.x);
-            vertexFloats.push_back(vertex.position.coordinates.y);
-            vertexFloats.push_back(vertex.position.coordinates.z);
-            
-            vertexFloats.push_back(vertex.normal.coordinates.x);
-            vertexFloats.push_back(vertex.normal.coordinates.y);
-            vertexFloats.push_back(vertex.normal.coordinates.z);
-        }
-
-        // Update the GPU-side vertex data
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertexFloats.size() * sizeof(float), vertexFloats.data(), GL_STATIC_DRAW);
-        glBindVertexArray(0);
+        fillColor = color;
     }
 
     void TriMesh::setWireframe(bool isActive) {
@@ -566,78 +985,82 @@ namespace Renderer {
         wireframeColorSetted = true;
     }
 
+    void TriMesh::setMaterial(const Math::Vector3& ambient) {
+        shader->setVec3("material.ambient", ambient);
+        shader->setVec3("material.diffuse", Math::Vector3(0.9, 0.9, 0.9));
+        shader->setVec3("material.specular", Math::Vector3(0, 0, 0));
+        shader->setFloat("material.shininess", 0);
+    }
+
+    void TriMesh::drawElements() {
+        GLState::bindVertexArray(VAO);
+        GLState::drawElements(GL_TRIANGLES, faces.size() * 3, GL_UNSIGNED_INT, 0);
+    }
+
     void TriMesh::render() {
         shader->use();
         shader->setMat4("model", getModel());
         
         if (isFilled){
-            shader->setVec3("material.ambient", vertices[0].color);
-            shader->setVec3("material.diffuse", Math::Vector3(0.9, 0.9, 0.9));
-            shader->setVec3("material.specular", Math::Vector3(0, 0, 0));
-            shader->setFloat("material.shininess", 0);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glEnable(GL_CULL_FACE);
+            setMaterial(fillColor);
+            GLState::polygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            GLState::enable(GL_CULL_FACE);
             if (!isPickable) {
-                glDepthMask(GL_FALSE);
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, faces.size() * 3, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
-                glDepthMask(GL_TRUE);
-            }
-            else {
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, faces.size() * 3, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
+                GLState::depthMask(GL_FALSE);
+                drawElements();
+                GLState::depthMask(GL_TRUE);
             }
+            else
+                drawElements();
         }
         else if (isWireframe) {
-            Math::Vector3 fillColor = vertices[0].color;
-            
-            if (wireframeColorSetted)
-                this->setUniformColor(wireframeColor);
-            
-            shader->setVec3("material.ambient", vertices[0].color);
-            shader->setVec3("material.diffuse", Math::Vector3(0.9, 0.9, 0.9));
-            shader->setVec3("material.specular", Math::Vector3(0, 0, 0));
-            shader->setFloat("material.shininess", 0);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glEnable(GL_CULL_FACE);
-            glEnable(GL_POLYGON_OFFSET_LINE);
-            glPolygonOffset(-1,-1);
+            setMaterial(wireframeColorSetted ? wireframeColor : fillColor);
+            GLState::polygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            GLState::enable(GL_CULL_FACE);
+            GLState::enable(GL_POLYGON_OFFSET_LINE);
+            GLState::polygonOffset(-1,-1);
             if (!isPickable) {
-                glDepthMask(GL_FALSE);
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, faces.size() * 3, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
-                glDepthMask(GL_TRUE);
-            }
-            else {
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, faces.size() * 3, GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
-                glUseProgram(0);
+                GLState::depthMask(GL_FALSE);
+                drawElements();
+                GLState::depthMask(GL_TRUE);
             }
-            glDisable(GL_POLYGON_OFFSET_LINE);
-            this->setUniformColor(fillColor);
+            else
+                drawElements();
+            GLState::disable(GL_POLYGON_OFFSET_LINE);
         } else if (isBlended) {
-            shader->setVec3("material.ambient", vertices[0].color);
-            shader->setVec3("material.diffuse", Math::Vector3(0.9, 0.9, 0.9));
-            shader->setVec3("material.specular", Math::Vector3(0, 0, 0));
-            shader->setFloat("material.shininess", 0);
-            glPolygonMode(GL_FRONT, GL_FILL);
-            glEnable(GL_CULL_FACE);
-			glDepthMask(GL_FALSE);
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, faces.size() * 3, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-            glUseProgram(0);
-            glDisable(GL_BLEND);
-			glDepthMask(GL_TRUE);
+            setMaterial(fillColor);
+            GLState::polygonMode(GL_FRONT, GL_FILL);
+            GLState::enable(GL_CULL_FACE);
+			GLState::depthMask(GL_FALSE);
+            GLState::enable(GL_BLEND);
+            GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            drawElements();
+            GLState::disable(GL_BLEND);
+			GLState::depthMask(GL_TRUE);
         }
     }
+
+    // Fill pass followed by a line pass over the same VAO, only the material uniform changes in between. The render
+    // mode flags and the wireframe color set on the mesh are left untouched
+    void TriMesh::renderWithWireframeOverlay(const Math::Vector3& overlayColor) {
+        shader->use();
+        shader->setMat4("model", getModel());
+        
+        GLState::enable(GL_CULL_FACE);
+        if (!isPickable)
+            GLState::depthMask(GL_FALSE);
+        
+        setMaterial(fillColor);
+        GLState::polygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        drawElements();
+        
+        setMaterial(overlayColor);
+        GLState::polygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        GLState::enable(GL_POLYGON_OFFSET_LINE);
+        GLState::polygonOffset(-1,-1);
+        drawElements();
+        GLState::disable(GL_POLYGON_OFFSET_LINE);
+        
+        GLState::depthMask(GL_TRUE);
+    }
 }
@@ -9,8 +9,11 @@
 #include <tinyfiledialogs.h>
 
 #include <YAMLUtils.hpp>
+#include <ApproximationError.hpp>
+#include <GLState.hpp>
 
 #include <chrono>
+#include <sstream>
 
 #define DEBUG_CHRONO 1
 
@@ -73,7 +76,11 @@ namespace Renderer {
             throw std::runtime_error("Failed to initialize GLAD");
         }
         
-        glEnable(GL_DEPTH_TEST);
+        GLState::enable(GL_DEPTH_TEST);
+        
+        // View, projection and light are shared by the mesh and sphere shaders through uniform blocks
+        cameraUniforms.create(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
+        lightUniforms.create(LIGHT_BLOCK_BINDING, sizeof(LightBlock));
         
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
@@ -163,6 +170,11 @@ namespace Renderer {
                 ImGui::Text("Rendered vertices per sphere: %d", sm->getPerSphereVertexCount());
                 ImGui::Text("Total vertices rendered: %lu", (sm->getRenderCalls() * sm->getPerSphereVertexCount()) +
                             (mesh->isFilled || mesh->isBlended || mesh->isWireframe ? mesh->vertices.size() : 0));
+                
+                const GLState::Counters& gl = GLState::getLastFrameCounters();
+                ImGui::Text("GL draw calls: %lu", gl.draws);
+                ImGui::Text("GL state calls: %lu issued, %lu elided", gl.issued, gl.elided);
+                ImGui::Text("GL uniform uploads: %lu", gl.uniforms);
             ImGui::End();
             sm->resetRenderCalls();
             
@@ -191,49 +203,33 @@ namespace Renderer {
             glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             
-            mainShader->use();
-            mainShader->setMat4("view", mainCamera->getViewMatrix());
-            mainShader->setMat4("projection", perspective);
-            
-            mainShader->setVec3("light.position", Math::Vector3(-1, 1, 0));
-            mainShader->setVec3("light.ambient", Math::Vector3(.5, .5, .5));
-            mainShader->setVec3("light.diffuse", Math::Vector3(0.3, 0.3, 0.3));
-            mainShader->setVec3("light.specular", Math::Vector3(0.3, 0.3, 0.3));
+            cameraUniforms.update(CameraBlock(mainCamera->getViewMatrix(), perspective));
+            lightUniforms.update(LightBlock(Math::Vector3(-1, 1, 0), Math::Vector3(.5, .5, .5),
+                                            Math::Vector3(0.3, 0.3, 0.3), Math::Vector3(0.3, 0.3, 0.3)));
             
             if (renderSM)
-                renderSphereMesh(perspective);
+                renderSphereMesh();
             
             if (renderWFmesh)
-            {
-                mesh->setFilled(true);
-                mesh->render();
-                mesh->setWireframe(true);
-                mesh->setWireframeColor(Math::Vector3(0, 0, 0));
-                mesh->render();
-            }
+                mesh->renderWithWireframeOverlay(Math::Vector3(0, 0, 0));
             else
                 mesh->render();
             
             
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            
+            // The ImGui backend sets its own program, VAO and capabilities
+            GLState::invalidate();
+            GLState::endFrame();
 
             glfwSwapBuffers(window);
             glfwPollEvents();
         }
     }
 
-    void Window::renderSphereMesh(const Math::Matrix4& perspective)
+    void Window::renderSphereMesh()
     {
-        sphereShader->use();
-        sphereShader->setMat4("view", mainCamera->getViewMatrix());
-        sphereShader->setMat4("projection", perspective);
-        
-        sphereShader->setVec3("light.position", Math::Vector3(-1, 1, 0));
-        sphereShader->setVec3("light.ambient", Math::Vector3(.5, .5, .5));
-        sphereShader->setVec3("light.diffuse", Math::Vector3(0.3, 0.3, 0.3));
-        sphereShader->setVec3("light.specular", Math::Vector3(0.3, 0.3, 0.3));
-        
         sm->renderSpheresOnly();
         if (renderVertices)
             for (auto & pm : pickedMeshes)
@@ -345,8 +341,8 @@ namespace Renderer {
                 
                 std::string referenceMeshPath = getYAMLRenderableMeshPath(filePath);
                 
-                mesh = new TriMesh(referenceMeshPath, mainShader);
-                sm = new Renderer::SphereMesh(mesh, sphereShader);
+                mesh = new TriMesh(referenceMeshPath, mainShader, preprocessCache, spatialVertexOrder);
+                sm = new Renderer::SphereMesh(mesh, sphereShader, preprocessCache);
                 
                 sm->loadFromYaml(filePath);
             } else {
@@ -373,8 +369,8 @@ namespace Renderer {
                 delete mesh;
                 delete sm;
                 
-                mesh = new TriMesh(filePath, mainShader);
-                sm = new Renderer::SphereMesh(mesh, sphereShader);
+                mesh = new TriMesh(filePath, mainShader, preprocessCache, spatialVertexOrder);
+                sm = new Renderer::SphereMesh(mesh, sphereShader, preprocessCache);
                 
                 mainCamera->resetRotation();
                 mainCamera->resetTranslation();
@@ -402,7 +398,7 @@ namespace Renderer {
         return {clipPos.coordinates.x, clipPos.coordinates.y, clipPos.coordinates.z};
     }
 
-    void Window::addSphereVectorToBuffer(const std::vector<TimedSphere>& spheres) {
+    void Window::addSphereVectorToBuffer(const SphereMesh::Snapshot& spheres) {
         if (sphereBuffer.size() > 30)
             sphereBuffer.erase(sphereBuffer.begin());
         
@@ -438,7 +434,7 @@ namespace Renderer {
         }
         
         if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && windowClassInstance->pickedMeshes.size() > 1) {
-            windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->timedSpheres);
+            windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->snapshot());
             for (auto& m : windowClassInstance->pickedMeshes)
                 m->color = Math::Vector3(1, 0, 0);
             
@@ -455,7 +451,7 @@ namespace Renderer {
         
         if (key == GLFW_KEY_A && action == GLFW_RELEASE && windowClassInstance->pickedMeshes.size() > 1)
         {
-            windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->timedSpheres);
+            windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->snapshot());
             for (auto& m : windowClassInstance->pickedMeshes)
                 m->color = Math::Vector3(1, 0, 0);
             
@@ -505,7 +501,7 @@ namespace Renderer {
         if (key == GLFW_KEY_Z && action == GLFW_PRESS)
         {
             if (windowClassInstance->sphereBuffer.size() > 0) {
-                windowClassInstance->sm->timedSpheres = windowClassInstance->sphereBuffer[windowClassInstance->sphereBuffer.size() - 1];
+                windowClassInstance->sm->restore(windowClassInstance->sphereBuffer.back());
                 windowClassInstance->removeLastSphereVectorFromBuffer();
                 
                 if (windowClassInstance->pickedMesh != nullptr)
@@ -603,6 +599,24 @@ namespace Renderer {
                 }
             }
             
+            if (ImGui::MenuItem((std::string(STORE_TEXT_ICON) + " Save PLY Sphere Mesh To...").c_str())) {
+                const char *defaultDescription = "PLY files";
+                const char *filterPatterns[1] = { "*.ply" };
+
+                const char *selectedSavePath = tinyfd_saveFileDialog("Save timedSpheres mesh as binary *.ply file", "", 1, filterPatterns, defaultDescription);
+
+                if (selectedSavePath) {
+                    std::filesystem::path pathObj(selectedSavePath);
+                    std::string fileNameStr = pathObj.filename().string();
+                    if (pathObj.extension() != ".ply")
+                        fileNameStr += ".ply";
+
+                    sm->savePLY(pathObj.parent_path().string() + "/", fileNameStr);
+                } else {
+                    displayErrorMessage("No path selected for saving!");
+                }
+            }
+            
             ImGui::Separator();
             
             if (ImGui::MenuItem((std::string(UPLOAD_ICON) + " Load YAML Sphere Mesh...").c_str(), "Ctrl+Shift+L")) {
@@ -618,8 +632,8 @@ namespace Renderer {
                     
                     std::string referenceMeshPath = getYAMLRenderableMeshPath(filePath);
                     
-                    mesh = new TriMesh(referenceMeshPath, mainShader);
-                    sm = new Renderer::SphereMesh(mesh, sphereShader);
+                    mesh = new TriMesh(referenceMeshPath, mainShader, preprocessCache, spatialVertexOrder);
+                    sm = new Renderer::SphereMesh(mesh, sphereShader, preprocessCache);
                     
                     sm->loadFromYaml(filePath);
                 } else {
@@ -646,9 +660,8 @@ namespace Renderer {
                     delete sm;
 					delete mainCamera;
                     
-                    mesh = new TriMesh(filePath, mainShader);
-                    sm = new Renderer::SphereMesh(mesh, sphereShader);
-					sm->resetSphereMesh();
+                    mesh = new TriMesh(filePath, mainShader, preprocessCache, spatialVertexOrder);
+                    sm = new Renderer::SphereMesh(mesh, sphereShader, preprocessCache);
 					mainCamera = new Camera();
                     
 //                    mainCamera->resetRotation();
@@ -673,7 +686,7 @@ namespace Renderer {
         if (ImGui::BeginMenu("Actions")) {
             if (ImGui::MenuItem("Collapse Two Sphere", "C")) {
                 if (pickedMesh != nullptr && pickedMeshes.size() > 1) {
-                    addSphereVectorToBuffer(sm->timedSpheres);
+                    addSphereVectorToBuffer(sm->snapshot());
                     for (auto& m : pickedMeshes)
                         m->color = Math::Vector3(1, 0, 0);
                     
@@ -690,7 +703,7 @@ namespace Renderer {
             
             if (ImGui::MenuItem("Collapse All Spheres", "A")) {
                 if (pickedMeshes.size() > 1) {
-                    addSphereVectorToBuffer(sm->timedSpheres);
+                    addSphereVectorToBuffer(sm->snapshot());
                     for (auto& m : pickedMeshes)
                         m->color = Math::Vector3(1, 0, 0);
                     
@@ -750,7 +763,7 @@ namespace Renderer {
             
             if (ImGui::MenuItem("UNDO", "Z")) {
                 if (!sphereBuffer.empty()) {
-                    sm->timedSpheres = sphereBuffer[sphereBuffer.size() - 1];
+                    sm->restore(sphereBuffer.back());
                     removeLastSphereVectorFromBuffer();
                     
                     if (pickedMesh != nullptr)
@@ -991,7 +1004,7 @@ namespace Renderer {
         static double pickY = 0.0;
         if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS && windowClassInstance->pickedMesh != nullptr) {
             if (!isRightPressed) {
-                windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->timedSpheres);
+                windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->snapshot());
                 isRightPressed = true;
                 pickX = xpos;
                 pickY = ypos;
@@ -1011,8 +1024,11 @@ namespace Renderer {
             }
         }
         
-        if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE)
+        if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE) {
+            if (isRightPressed && windowClassInstance->pickedMesh != nullptr)
+                windowClassInstance->sm->updateAfterEdit(windowClassInstance->pickedMesh->getID());
             isRightPressed = false;
+        }
         
         static bool isLeftShiftPressed = false;
         static double translateX = 0.0;
@@ -1021,7 +1037,7 @@ namespace Renderer {
         if((glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS)
            && windowClassInstance->pickedMesh != nullptr) {
             if (!isLeftShiftPressed) {
-                windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->timedSpheres);
+                windowClassInstance->addSphereVectorToBuffer(windowClassInstance->sm->snapshot());
                 isLeftShiftPressed = true;
                 translateX = xpos;
                 translateY = ypos;
@@ -1035,8 +1051,11 @@ namespace Renderer {
             windowClassInstance->pickedMesh->center += delta;
             initialWorldPoint = endWorldPoint;
         }
-        else
+        else {
+            if (isLeftShiftPressed && windowClassInstance->pickedMesh != nullptr)
+                windowClassInstance->sm->updateAfterEdit(windowClassInstance->pickedMesh->getID());
             isLeftShiftPressed = false;
+        }
 
         if(glfwGetKey(window, GLFW_KEY_LEFT_SUPER) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT_SUPER) == GLFW_PRESS) {
             if (!windowClassInstance->commandPressed) {
@@ -1096,6 +1115,17 @@ namespace Renderer {
             }
         }
         
+        ImGui::Separator();
+        
+        ImGui::Checkbox("Spatial vertex order", &spatialVertexOrder);
+        
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            ImGui::Text("Sorts the vertices of the next loaded mesh along a Morton curve.\n Exports keep the OBJ indices.");
+            ImGui::EndTooltip();
+        }
+        
         ImGui::Separator();
 	    
 		static bool implementThiery = false;
@@ -1114,6 +1144,29 @@ namespace Renderer {
 		
 		ImGui::Separator();
         
+        static int scheduler = 0;
+        static int seed = 42;
+        ImGui::PushItemWidth(160);
+        ImGui::Combo("Scheduler", &scheduler, "Greedy\0Randomized (multiple choice)\0Batched\0");
+        ImGui::PopItemWidth();
+        
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            ImGui::Text("Multiple choice collapses sampled candidates in parallel rounds instead of following the\n"
+                        "greedy queue, the same seed gives the same sphere mesh. Batched follows the queue but\n"
+                        "executes the cheapest collapses with disjoint neighbourhoods together.");
+            ImGui::EndTooltip();
+        }
+        
+        if (scheduler == 1)
+        {
+            ImGui::SameLine();
+            ImGui::PushItemWidth(80);
+            ImGui::InputInt("Seed", &seed);
+            ImGui::PopItemWidth();
+        }
+        
         static int j = 0;
         ImGui::PushItemWidth(120);
         ImGui::InputInt("n Spheres to Reach", &j);
@@ -1128,7 +1181,13 @@ namespace Renderer {
             auto start = std::chrono::high_resolution_clock::now();
 #endif
             
-            auto result = sm->collapseSphereMesh(j);
+            bool result;
+            if (scheduler == 1)
+                result = sm->collapseSphereMeshMultipleChoice(j, static_cast<unsigned int>(seed));
+            else if (scheduler == 2)
+                result = sm->collapseSphereMeshBatched(j);
+            else
+                result = sm->collapseSphereMesh(j);
             
 #if DEBUG_CHRONO == 1
             auto stop = std::chrono::high_resolution_clock::now();
@@ -1159,6 +1218,48 @@ namespace Renderer {
                 }
             sm->renderSpheresOnly();
         }
+		
+		static float maxErrorPercentage = 1.0f;
+		ImGui::PushItemWidth(120);
+		ImGui::InputFloat("Max Error (% BDD)", &maxErrorPercentage, 0.1f, 1.0f, "%.3f");
+		ImGui::PopItemWidth();
+		
+		ImGui::SameLine();
+		
+		if (ImGui::Button("Collapse Under Error"))
+		{
+			int initialSpheres = sm->getTimedSphereSize();
+			
+			if (!sm->collapseSphereMeshUnderError(std::max(0.0f, maxErrorPercentage) / 100.0f))
+				displayErrorMessage("Ran out of collapses before reaching the error bound,\nspheres collapsed: " + std::to_string(initialSpheres - sm->getTimedSphereSize()));
+			else
+				displayLogMessage("Spheres: " + std::to_string(sm->getTimedSphereSize()) + "\nLast collapse error: " + std::to_string(sm->getLastCollapseError() * 100) + "% of BDD");
+			
+			sm->renderSpheresOnly();
+		}
+		
+		static int refinementIterations = 20;
+		ImGui::PushItemWidth(120);
+		ImGui::InputInt("Iterations", &refinementIterations);
+		ImGui::PopItemWidth();
+		
+		ImGui::SameLine();
+		
+		if (ImGui::Button("Refine Spheres"))
+		{
+			addSphereVectorToBuffer(sm->snapshot());
+			
+			auto iterations = sm->refineSpheres(std::max(0, refinementIterations));
+			
+			std::ostringstream message;
+			message << "Iteration, RMS distance (% of BDD), step, seconds";
+			for (size_t i = 0; i < iterations.size(); i++)
+				message << "\n" << i << ", " << iterations[i].energy * 100 << ", " << iterations[i].step << ", "
+						<< iterations[i].seconds;
+			
+			displayLogMessage(message.str());
+			sm->renderSpheresOnly();
+		}
         
         ImGui::Separator();
         
@@ -1190,6 +1291,22 @@ namespace Renderer {
 		if (ImGui::Button("Reset Sphere-mesh"))
 			sm->resetSphereMesh();
 		
+	    ImGui::Separator();
+		
+		if (ImGui::Button("Measure approximation error"))
+		{
+			ApproximationErrorEvaluator evaluator(*mesh);
+			ApproximationError error = evaluator.evaluate(*sm);
+			
+			std::ostringstream message;
+			message << "Surface samples: " << error.samples << "\n"
+					<< "Max distance (Hausdorff): " << error.max << " (" << error.maxRelative * 100 << "% of BDD)\n"
+					<< "Mean distance: " << error.mean << " (" << error.meanRelative * 100 << "% of BDD)\n"
+					<< "RMS distance: " << error.rms << " (" << error.rmsRelative * 100 << "% of BDD)";
+			
+			displayLogMessage(message.str());
+		}
+		
 	    ImGui::Separator();
         
         if (ImGui::Button("Render Sphere Only Sphere Mesh"))
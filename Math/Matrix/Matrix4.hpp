@@ -7,6 +7,7 @@
 #include "../Vector/Vector4.hpp"
 #include "Matrix3.hpp"
 #include <Quaternion.hpp>
+#include <SIMD.hpp>
 
 #include <limits>
 
@@ -22,29 +23,62 @@ namespace Math
         Matrix4();
         Matrix4(const Scalar& value);
         Matrix4(const Vector4& vec1, const Vector4& vec2, const Vector4& vec3, const Vector4& vec4);
-        Matrix4(const Matrix4& mat);
+        Matrix4(const Matrix4& mat) = default;
         Matrix4(const Scalar& v1, const Scalar& v2, const Scalar& v3, const Scalar& v4,
                 const Scalar& v5, const Scalar& v6, const Scalar& v7, const Scalar& v8,
                 const Scalar& v9, const Scalar& v10, const Scalar& v11, const Scalar& v12,
                 const Scalar& v13, const Scalar& v14, const Scalar& v15, const Scalar& v16);
 
-        void setZero();
+        void setZero()
+        {
+            for (Scalar& d : data)
+                d = 0;
+        }
 
+        // The hot operations are defined here so they can be inlined in the quadric and collapse loops
         void operator*=(const Matrix4& mat);
-        void operator*=(const Scalar& value);
-        void operator+=(const Matrix4& mat);
+
+        void operator*=(const Scalar& value)
+        {
+            SIMD::scale16(data, value, data);
+        }
+
+        void operator+=(const Matrix4& mat)
+        {
+            SIMD::add16(data, mat.data, data);
+        }
+
         void operator-=(const Matrix4& mat);
         void operator/=(const Scalar& dividend);
 
         Matrix4 operator*(const Matrix4& mat) const;
-        Vector4 operator*(const Vector4& vec) const;
-        Matrix4 operator*(const Scalar& value) const;
-        Matrix4 operator+(const Matrix4& mat) const;
+
+        Vector4 operator*(const Vector4& vec) const
+        {
+            Vector4 result;
+            SIMD::mul4x4Vec4(data, &vec.coordinates.x, &result.coordinates.x);
+            return result;
+        }
+
+        Matrix4 operator*(const Scalar& value) const
+        {
+            Matrix4 result(*this);
+            result *= value;
+            return result;
+        }
+
+        Matrix4 operator+(const Matrix4& mat) const
+        {
+            Matrix4 result(*this);
+            result += mat;
+            return result;
+        }
+
         Matrix4 operator-(const Matrix4& mat) const;
         Matrix4 operator-() const;
         Matrix4 operator/(const Scalar& dividend) const;
         
-        void operator=(const Matrix4& mat);
+        Matrix4& operator=(const Matrix4& mat) = default;
         
         bool operator==(const Matrix4& mat) const;
 
@@ -18,14 +18,6 @@ namespace Math
         data[12] = value, data[13] = value, data[14] = value, data[15] = value;
     }
 
-    Matrix4::Matrix4(const Matrix4& mat)
-    {
-        data[0] = mat.data[0], data[1] = mat.data[1], data[2] = mat.data[2], data[3] = mat.data[3],
-        data[4] = mat.data[4], data[5] = mat.data[5], data[6] = mat.data[6], data[7] = mat.data[7],
-        data[8] = mat.data[8], data[9] = mat.data[9], data[10] = mat.data[10], data[11] = mat.data[11],
-        data[12] = mat.data[12], data[13] = mat.data[13], data[14] = mat.data[14], data[15] = mat.data[15];
-    }
-
     Matrix4::Matrix4(const Scalar& v1, const Scalar& v2, const Scalar& v3, const Scalar& v4,
                     const Scalar& v5, const Scalar& v6, const Scalar& v7, const Scalar& v8,
                     const Scalar& v9, const Scalar& v10, const Scalar& v11, const Scalar& v12,
@@ -60,14 +52,6 @@ namespace Math
         data[15] = vec4[3];
     }
 
-    void Matrix4::setZero()
-    {
-        data[0] = 0, data[1] = 0, data[2] = 0, data[3] = 0,
-        data[4] = 0, data[5] = 0, data[6] = 0, data[7] = 0,
-        data[8] = 0, data[9] = 0, data[10] = 0, data[11] = 0,
-        data[12] = 0, data[13] = 0, data[14] = 0, data[15] = 0;
-    }
-
     void Matrix4::operator*=(const Matrix4& mat)
     {
         Scalar temp1, temp2, temp3, temp4;
@@ -112,22 +96,6 @@ namespace Math
         data[15] = temp4;
     }
 
-    void Matrix4::operator*=(const Scalar& value)
-    {
-        for(unsigned int i = 0; i < 16; ++i)
-        {
-            data[i] *= value;
-        }
-    }
-
-    void Matrix4::operator+=(const Matrix4& mat)
-    {
-        for(unsigned int i = 0; i < 16; ++i)
-        {
-            data[i] += mat.data[i];
-        }
-    }
-
     void Matrix4::operator-=(const Matrix4& mat)
     {
         for(unsigned int i = 0; i < 16; ++i)
@@ -148,20 +116,6 @@ namespace Math
         return result;
     }
 
-    Matrix4 Matrix4::operator*(const Scalar& value) const
-    {
-        Matrix4 result = Matrix4(*this);
-        result *= value;
-        return result;
-    }
-
-    Matrix4 Matrix4::operator+(const Matrix4& mat) const
-    {
-        Matrix4 result = Matrix4(*this);
-        result += mat;
-        return result;
-    }
-
     Matrix4 Matrix4::operator-(const Matrix4& mat) const
     {
         Matrix4 result = Matrix4(*this);
@@ -187,14 +141,6 @@ namespace Math
         return res;
     }
 
-    void Matrix4::operator=(const Matrix4& mat)
-    {
-        for(unsigned int i = 0; i < 16; ++i)
-        {
-            data[i] = mat.data[i];
-        }
-    }
-
     bool Matrix4::operator==(const Matrix4& other) const {
         for (int i = 0; i < 16; i++) {
             if (data[i] != other.data[i]) {
@@ -451,29 +397,6 @@ namespace Math
         return result;
     }
 
-    Vector4 Matrix4::operator*(const Vector4& vec) const
-    {  
-        return Vector4(vec.coordinates.x * data[0] +
-                       vec.coordinates.y * data[1] + 
-                       vec.coordinates.z * data[2] +
-                       vec.coordinates.w * data[3],
-                       
-                       vec.coordinates.x * data[4] +
-                       vec.coordinates.y * data[5] + 
-                       vec.coordinates.z * data[6] +
-                       vec.coordinates.w * data[7],
-
-                       vec.coordinates.x * data[8] +
-                       vec.coordinates.y * data[9] + 
-                       vec.coordinates.z * data[10] +
-                       vec.coordinates.w * data[11],
-                       
-                       vec.coordinates.x * data[12] +
-                       vec.coordinates.y * data[13] + 
-                       vec.coordinates.z * data[14] +
-                       vec.coordinates.w * data[15]);
-    }
-
     Vector3 Matrix4::transformDirection(const Vector3& vec) const
     {
         return Vector3(
@@ -0,0 +1,228 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <Scalar.hpp>
+
+// Kernels behind the hot Vector4/Matrix4 operations, on raw arrays of Scalar (Vector4 coordinates, Matrix4 data in
+// row-major order). The implementation is picked at compile time from the target flags (-march=native enables AVX
+// where available), define MATH_DISABLE_SIMD to force the scalar one.
+#if !defined(MATH_DISABLE_SIMD) && !defined(LOW_PRECISON_MATH) && defined(__AVX__)
+    #define MATH_SIMD_AVX
+    #include <immintrin.h>
+#elif !defined(MATH_DISABLE_SIMD) && !defined(LOW_PRECISON_MATH) && (defined(__SSE2__) || defined(_M_X64))
+    #define MATH_SIMD_SSE2
+    #include <emmintrin.h>
+#elif !defined(MATH_DISABLE_SIMD) && defined(LOW_PRECISON_MATH) && (defined(__SSE__) || defined(_M_X64))
+    #define MATH_SIMD_SSE
+    #include <xmmintrin.h>
+#else
+    #define MATH_SIMD_SCALAR
+#endif
+
+namespace Math
+{
+    namespace SIMD
+    {
+        inline const char* backend()
+        {
+#if defined(MATH_SIMD_AVX)
+            return "AVX";
+#elif defined(MATH_SIMD_SSE2)
+            return "SSE2";
+#elif defined(MATH_SIMD_SSE)
+            return "SSE";
+#else
+            return "scalar";
+#endif
+        }
+
+#if defined(MATH_SIMD_AVX)
+        inline void add4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            _mm256_storeu_pd(out, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+        }
+
+        inline void sub4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            _mm256_storeu_pd(out, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+        }
+
+        inline void scale4(const Scalar* a, Scalar k, Scalar* out)
+        {
+            _mm256_storeu_pd(out, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_set1_pd(k)));
+        }
+
+        inline Scalar dot4(const Scalar* a, const Scalar* b)
+        {
+            __m256d p = _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b));
+            __m128d s = _mm_add_pd(_mm256_castpd256_pd128(p), _mm256_extractf128_pd(p, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        }
+
+        inline void add16(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            for (int i = 0; i < 16; i += 4)
+                _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        }
+
+        inline void scale16(const Scalar* a, Scalar k, Scalar* out)
+        {
+            __m256d factor = _mm256_set1_pd(k);
+            for (int i = 0; i < 16; i += 4)
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), factor));
+        }
+
+        // Every row times the vector, then the four horizontal sums are gathered into one register
+        inline void mul4x4Vec4(const Scalar* m, const Scalar* v, Scalar* out)
+        {
+            __m256d x = _mm256_loadu_pd(v);
+            __m256d r0 = _mm256_mul_pd(_mm256_loadu_pd(m), x);
+            __m256d r1 = _mm256_mul_pd(_mm256_loadu_pd(m + 4), x);
+            __m256d r2 = _mm256_mul_pd(_mm256_loadu_pd(m + 8), x);
+            __m256d r3 = _mm256_mul_pd(_mm256_loadu_pd(m + 12), x);
+
+            __m256d h01 = _mm256_hadd_pd(r0, r1);
+            __m256d h23 = _mm256_hadd_pd(r2, r3);
+
+            _mm256_storeu_pd(out, _mm256_add_pd(_mm256_permute2f128_pd(h01, h23, 0x20),
+                                                _mm256_permute2f128_pd(h01, h23, 0x31)));
+        }
+#elif defined(MATH_SIMD_SSE2)
+        inline void add4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            _mm_storeu_pd(out, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+            _mm_storeu_pd(out + 2, _mm_add_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+        }
+
+        inline void sub4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            _mm_storeu_pd(out, _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+            _mm_storeu_pd(out + 2, _mm_sub_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+        }
+
+        inline void scale4(const Scalar* a, Scalar k, Scalar* out)
+        {
+            __m128d factor = _mm_set1_pd(k);
+            _mm_storeu_pd(out, _mm_mul_pd(_mm_loadu_pd(a), factor));
+            _mm_storeu_pd(out + 2, _mm_mul_pd(_mm_loadu_pd(a + 2), factor));
+        }
+
+        inline Scalar dot4(const Scalar* a, const Scalar* b)
+        {
+            __m128d s = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)),
+                                   _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        }
+
+        inline void add16(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            for (int i = 0; i < 16; i += 2)
+                _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        }
+
+        inline void scale16(const Scalar* a, Scalar k, Scalar* out)
+        {
+            __m128d factor = _mm_set1_pd(k);
+            for (int i = 0; i < 16; i += 2)
+                _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), factor));
+        }
+
+        inline void mul4x4Vec4(const Scalar* m, const Scalar* v, Scalar* out)
+        {
+            for (int i = 0; i < 4; i++)
+                out[i] = dot4(m + 4 * i, v);
+        }
+#elif defined(MATH_SIMD_SSE)
+        inline void add4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+        }
+
+        inline void sub4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            _mm_storeu_ps(out, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+        }
+
+        inline void scale4(const Scalar* a, Scalar k, Scalar* out)
+        {
+            _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(k)));
+        }
+
+        inline Scalar dot4(const Scalar* a, const Scalar* b)
+        {
+            __m128 p = _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+            __m128 s = _mm_add_ps(p, _mm_movehl_ps(p, p));
+            return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+        }
+
+        inline void add16(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            for (int i = 0; i < 16; i += 4)
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+
+        inline void scale16(const Scalar* a, Scalar k, Scalar* out)
+        {
+            __m128 factor = _mm_set1_ps(k);
+            for (int i = 0; i < 16; i += 4)
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), factor));
+        }
+
+        inline void mul4x4Vec4(const Scalar* m, const Scalar* v, Scalar* out)
+        {
+            __m128 r0 = _mm_mul_ps(_mm_loadu_ps(m), _mm_loadu_ps(v));
+            __m128 r1 = _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_loadu_ps(v));
+            __m128 r2 = _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_loadu_ps(v));
+            __m128 r3 = _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_loadu_ps(v));
+
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+        }
+#else
+        inline void add4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            for (int i = 0; i < 4; i++)
+                out[i] = a[i] + b[i];
+        }
+
+        inline void sub4(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            for (int i = 0; i < 4; i++)
+                out[i] = a[i] - b[i];
+        }
+
+        inline void scale4(const Scalar* a, Scalar k, Scalar* out)
+        {
+            for (int i = 0; i < 4; i++)
+                out[i] = a[i] * k;
+        }
+
+        inline Scalar dot4(const Scalar* a, const Scalar* b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        }
+
+        inline void add16(const Scalar* a, const Scalar* b, Scalar* out)
+        {
+            for (int i = 0; i < 16; i++)
+                out[i] = a[i] + b[i];
+        }
+
+        inline void scale16(const Scalar* a, Scalar k, Scalar* out)
+        {
+            for (int i = 0; i < 16; i++)
+                out[i] = a[i] * k;
+        }
+
+        inline void mul4x4Vec4(const Scalar* m, const Scalar* v, Scalar* out)
+        {
+            Scalar x = v[0], y = v[1], z = v[2], w = v[3];
+
+            for (int i = 0; i < 4; i++)
+                out[i] = m[4 * i] * x + m[4 * i + 1] * y + m[4 * i + 2] * z + m[4 * i + 3] * w;
+        }
+#endif
+    }
+}
+
+#endif
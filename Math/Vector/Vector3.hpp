@@ -7,6 +7,7 @@
 #include <Point3.hpp>
 #include <Math.hpp>
 
+#include <cmath>
 #include <stdexcept>
 
 namespace Math
@@ -31,15 +32,27 @@ namespace Math
         public:
             Vector3Coordinates<Scalar> coordinates;
 
-            Vector3();
-            Vector3(const Scalar& x, const Scalar& y, const Scalar& z);
+            // The hot operations are defined here so they can be inlined in the quadric and collapse loops
+            Vector3() : coordinates{0, 0, 0} {}
+            Vector3(const Scalar& x, const Scalar& y, const Scalar& z) : coordinates{x, y, z} {}
             Vector3(const Vector2& vector, const Scalar& z);
-            Vector3(const Vector3& vector);
+            Vector3(const Vector3& vector) = default;
             Vector3(const Scalar* vector);
+            Vector3& operator = (const Vector3& vector) = default;
         
-            static Vector3 cross(const Vector3& vector1, const Vector3& vector2);
+            static Vector3 cross(const Vector3& vector1, const Vector3& vector2)
+            {
+                return {
+                    vector1.coordinates.y * vector2.coordinates.z - vector1.coordinates.z * vector2.coordinates.y,
+                    vector1.coordinates.z * vector2.coordinates.x - vector1.coordinates.x * vector2.coordinates.z,
+                    vector1.coordinates.x * vector2.coordinates.y - vector1.coordinates.y * vector2.coordinates.x
+                };
+            }
 
-            static Scalar dot(const Vector3& vector1, const Vector3& vector2);
+            static Scalar dot(const Vector3& vector1, const Vector3& vector2)
+            {
+                return vector1.dot(vector2);
+            }
 
             static Vector3 up();
             static Vector3 down();
@@ -50,16 +63,34 @@ namespace Math
         
             static Vector3 unProject(Vector3 wincoord, Matrix4 view, Matrix4 projection, Vector4 viewport);
 
-            Scalar dot(const Vector3& vector) const;
-            Vector3 cross(const Vector3& vector) const;
+            Scalar dot(const Vector3& vector) const
+            {
+                return coordinates.x * vector.coordinates.x +
+                       coordinates.y * vector.coordinates.y +
+                       coordinates.z * vector.coordinates.z;
+            }
+
+            Vector3 cross(const Vector3& vector) const
+            {
+                return cross(*this, vector);
+            }
+
             Vector3 componentWise(const Vector3& vector) const;
             Matrix3 outer(const Vector3& vector) const;
 
             Vector3 componentWiseMinimum(const Vector3& vector) const;
             Vector3 componentWiseMaximum(const Vector3& vector) const;
 
-            Scalar magnitude() const;
-            Scalar squareMagnitude() const;
+            Scalar magnitude() const
+            {
+                return std::sqrt(squareMagnitude());
+            }
+
+            Scalar squareMagnitude() const
+            {
+                return dot(*this);
+            }
+
             Vector3 normalized() const;
             void normalize();
             static Vector3 normalize(const Vector3& vec);
@@ -67,18 +98,65 @@ namespace Math
             Scalar operator [] (const short& i) const;
             Scalar& operator [] (const short& i);
 
-            Scalar operator * (const Vector3& vector) const;
-            Vector3 operator + (const Vector3& vector) const;
-            Vector3 operator - (const Vector3& vector) const;
+            Scalar operator * (const Vector3& vector) const
+            {
+                return dot(vector);
+            }
+
+            Vector3 operator + (const Vector3& vector) const
+            {
+                return {coordinates.x + vector.coordinates.x, coordinates.y + vector.coordinates.y, coordinates.z + vector.coordinates.z};
+            }
+
+            Vector3 operator - (const Vector3& vector) const
+            {
+                return {coordinates.x - vector.coordinates.x, coordinates.y - vector.coordinates.y, coordinates.z - vector.coordinates.z};
+            }
+
             bool operator == (const Vector3& vector) const;
-            Vector3 operator - () const;
-            Vector3 operator * (const Scalar& k) const;
-            Vector3 operator / (const Scalar& k) const;
-
-            void operator += (const Vector3& vector);
-            void operator -= (const Vector3& vector);
-            void operator *= (const Scalar& k);
-            void operator /= (const Scalar& k);
+
+            Vector3 operator - () const
+            {
+                return {-coordinates.x, -coordinates.y, -coordinates.z};
+            }
+
+            Vector3 operator * (const Scalar& k) const
+            {
+                return {coordinates.x * k, coordinates.y * k, coordinates.z * k};
+            }
+
+            Vector3 operator / (const Scalar& k) const
+            {
+                return {coordinates.x / k, coordinates.y / k, coordinates.z / k};
+            }
+
+            void operator += (const Vector3& vector)
+            {
+                coordinates.x += vector.coordinates.x;
+                coordinates.y += vector.coordinates.y;
+                coordinates.z += vector.coordinates.z;
+            }
+
+            void operator -= (const Vector3& vector)
+            {
+                coordinates.x -= vector.coordinates.x;
+                coordinates.y -= vector.coordinates.y;
+                coordinates.z -= vector.coordinates.z;
+            }
+
+            void operator *= (const Scalar& k)
+            {
+                coordinates.x *= k;
+                coordinates.y *= k;
+                coordinates.z *= k;
+            }
+
+            void operator /= (const Scalar& k)
+            {
+                coordinates.x /= k;
+                coordinates.y /= k;
+                coordinates.z /= k;
+            }
 
             static Scalar distance(const Vector3& vector1, const Vector3& vector2);
             Scalar angleBetween (const Vector3& vector) const;
@@ -4,10 +4,9 @@
 #include <Scalar.hpp>
 #include <Vector3.hpp>
 #include <Versor4.hpp>
-#include <Matrix4.hpp>
 #include <Point4.hpp>
-#include <Quaternion.hpp>
 #include <Math.hpp>
+#include <SIMD.hpp>
 
 #include <iostream>
 #include <cmath>
@@ -34,17 +33,30 @@ namespace Math
         public:
             Vector4Coordinates<Scalar> coordinates;
 
-            Vector4();
-            Vector4(const Scalar& x, const Scalar& y, const Scalar& z, const Scalar& w);
+            // The hot operations are defined here so they can be inlined in the quadric and collapse loops
+            Vector4() : coordinates{0, 0, 0, 0} {}
+            Vector4(const Scalar& x, const Scalar& y, const Scalar& z, const Scalar& w) : coordinates{x, y, z, w} {}
             Vector4(const Vector2& vector, const Scalar& z, const Scalar& w);
             Vector4(const Vector3& vector, const Scalar& w);
-            Vector4(const Vector4& vector);
+            Vector4(const Vector4& vector) = default;
+            Vector4& operator = (const Vector4& vector) = default;
+
+            [[nodiscard]] Scalar dot(const Vector4& vector) const
+            {
+                return SIMD::dot4(&coordinates.x, &vector.coordinates.x);
+            }
 
-            [[nodiscard]] Scalar dot(const Vector4& vector) const;
             [[nodiscard]] Vector4 componentWise(const Vector4& vector) const;
 
-            [[nodiscard]] Scalar magnitude() const;
-            [[nodiscard]] Scalar squareMagnitude() const;
+            [[nodiscard]] Scalar magnitude() const
+            {
+                return std::sqrt(squareMagnitude());
+            }
+
+            [[nodiscard]] Scalar squareMagnitude() const
+            {
+                return dot(*this);
+            }
 
             [[nodiscard]] Vector4 normalized() const;
             void normalize();
@@ -53,19 +65,66 @@ namespace Math
             Scalar& operator [] (const short& i);
         
             // This operator * is the dot product
-            Scalar operator * (const Vector4& vector) const;
-            Vector4 operator + (const Vector4& vector) const;
-            Vector4 operator - (const Vector4& vector) const;
-            bool operator == (const Vector4& vector) const;
+            Scalar operator * (const Vector4& vector) const
+            {
+                return dot(vector);
+            }
+
+            Vector4 operator + (const Vector4& vector) const
+            {
+                Vector4 result;
+                SIMD::add4(&coordinates.x, &vector.coordinates.x, &result.coordinates.x);
+                return result;
+            }
+
+            Vector4 operator - (const Vector4& vector) const
+            {
+                Vector4 result;
+                SIMD::sub4(&coordinates.x, &vector.coordinates.x, &result.coordinates.x);
+                return result;
+            }
 
-            Vector4 operator - () const;
-            Vector4 operator * (const Scalar& k) const;
-            Vector4 operator / (const Scalar& k) const;
+            bool operator == (const Vector4& vector) const;
 
-            void operator += (const Vector4& vector);
-            void operator -= (const Vector4& vector);
-            void operator *= (const Scalar& k);
-            void operator /= (const Scalar& k);
+            Vector4 operator - () const
+            {
+                return {-coordinates.x, -coordinates.y, -coordinates.z, -coordinates.w};
+            }
+
+            Vector4 operator * (const Scalar& k) const
+            {
+                Vector4 result;
+                SIMD::scale4(&coordinates.x, k, &result.coordinates.x);
+                return result;
+            }
+
+            Vector4 operator / (const Scalar& k) const
+            {
+                return {coordinates.x / k, coordinates.y / k, coordinates.z / k, coordinates.w / k};
+            }
+
+            void operator += (const Vector4& vector)
+            {
+                SIMD::add4(&coordinates.x, &vector.coordinates.x, &coordinates.x);
+            }
+
+            void operator -= (const Vector4& vector)
+            {
+                SIMD::sub4(&coordinates.x, &vector.coordinates.x, &coordinates.x);
+            }
+
+            void operator *= (const Scalar& k)
+            {
+                SIMD::scale4(&coordinates.x, k, &coordinates.x);
+            }
+
+            void operator /= (const Scalar& k)
+            {
+                coordinates.x /= k;
+                coordinates.y /= k;
+                coordinates.z /= k;
+                coordinates.w /= k;
+            }
 
             Vector3 xyz();
 
@@ -88,4 +147,8 @@ namespace Math
     };
 }
 
+// Included after Vector4 is complete, Matrix4 uses it in its inline operations
+#include <Matrix4.hpp>
+#include <Quaternion.hpp>
+
 #endif
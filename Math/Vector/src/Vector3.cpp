@@ -6,20 +6,6 @@
 #include <Vector4.hpp>
 
 namespace Math {
-    Vector3::Vector3() {
-        coordinates = Vector3Coordinates<Scalar>();
-        this->coordinates.x = (Scalar) 0.0;
-        this->coordinates.y = (Scalar) 0.0;
-        this->coordinates.z = (Scalar) 0.0;
-    }
-
-    Vector3::Vector3(const Scalar& x, const Scalar& y, const Scalar& z) {
-        coordinates = Vector3Coordinates<Scalar>();
-        this->coordinates.x = x;
-        this->coordinates.y = y;
-        this->coordinates.z = z;
-    }
-
     Vector3::Vector3(const Vector2& vector, const Scalar& z) {
         coordinates = Vector3Coordinates<Scalar>();
         this->coordinates.x = vector.coordinates.x;
@@ -27,13 +13,6 @@ namespace Math {
         this->coordinates.z = z;
     }
 
-    Vector3::Vector3(const Vector3& vector) {
-        coordinates = Vector3Coordinates<Scalar>();
-        this->coordinates.x = vector.coordinates.x;
-        this->coordinates.y = vector.coordinates.y;
-        this->coordinates.z = vector.coordinates.z;
-    }
-
     Vector3::Vector3(const Scalar* vector) {
         coordinates = Vector3Coordinates<Scalar>();
         this->coordinates.x = vector[0];
@@ -48,28 +27,6 @@ namespace Math {
     Vector3 Vector3::forward() { return Vector3(0, 0, +1); }
     Vector3 Vector3::backward() { return Vector3(0, 0, -1); }
 
-    Vector3 Vector3::cross(const Vector3& vector1, const Vector3& vector2) {
-                return Vector3(
-                    vector1.coordinates.y * vector2.coordinates.z - vector1.coordinates.z * vector2.coordinates.y,
-                    vector1.coordinates.z * vector2.coordinates.x - vector1.coordinates.x * vector2.coordinates.z,
-                    vector1.coordinates.x * vector2.coordinates.y - vector1.coordinates.y * vector2.coordinates.x
-                );
-    }
-
-    Scalar Vector3::dot(const Vector3& vector1, const Vector3& vector2) {
-        return vector1.dot(vector2);
-    }
-
-    Scalar Vector3::dot(const Vector3& vector) const {
-        return this->coordinates.x * vector.coordinates.x +
-                this->coordinates.y * vector.coordinates.y +
-                this->coordinates.z * vector.coordinates.z;
-    }
-
-    Vector3 Vector3::cross(const Vector3& vector) const {
-        return Vector3::cross(*this, vector);
-    }
-
     Vector3 Vector3::componentWise(const Vector3& vector) const {
         return Vector3(
             this->coordinates.x * vector.coordinates.x,
@@ -107,14 +64,6 @@ namespace Math {
         return Vector3(tmp.coordinates.x / tmp.coordinates.w, tmp.coordinates.y / tmp.coordinates.w, tmp.coordinates.z / tmp.coordinates.w);
     }
 
-    Scalar Vector3::magnitude() const {
-        return std::sqrt(this->squareMagnitude());
-    }
-
-    Scalar Vector3::squareMagnitude() const {
-        return (this->coordinates.x * this->coordinates.x) + (this->coordinates.y * this->coordinates.y) + (this->coordinates.z * this->coordinates.z);
-    }
-
     Vector3 Vector3::normalized() const {
         if (this->magnitude() == 0)
             return *this;
@@ -158,66 +107,10 @@ namespace Math {
         throw std::invalid_argument("INDEX_OUT_OF_RANGE::in Vector3 the index might be either 0, 1 or 2");
     }
 
-    Scalar Vector3::operator * (const Vector3& vector) const {
-        return this->dot(vector);
-    }
-
-    Vector3 Vector3::operator + (const Vector3& vector) const {
-        return Vector3( this->coordinates.x + vector.coordinates.x, 
-                        this->coordinates.y + vector.coordinates.y,
-                        this->coordinates.z + vector.coordinates.z);
-    }
-
-    Vector3 Vector3::operator - (const Vector3& vector) const {
-        return Vector3(this->coordinates.x - vector.coordinates.x,
-                       this->coordinates.y - vector.coordinates.y,
-                       this->coordinates.z - vector.coordinates.z);
-    }
-
     bool Vector3::operator == (const Vector3& vector) const {
         return this->areEquals(vector);
     }
 
-    Vector3 Vector3::operator - () const {
-        return Vector3(-this->coordinates.x, -this->coordinates.y, -this->coordinates.z);
-    }
-
-    Vector3 Vector3::operator * (const Scalar& k) const {
-        return Vector3(this->coordinates.x * k, 
-                this->coordinates.y * k,
-                this->coordinates.z * k);
-    }
-
-    Vector3 Vector3::operator / (const Scalar& k) const {
-        return Vector3(this->coordinates.x / k, 
-                this->coordinates.y / k,
-                this->coordinates.z / k);
-    }
-
-    void Vector3::operator += (const Vector3& vector) {
-        this->coordinates.x += vector.coordinates.x;
-        this->coordinates.y += vector.coordinates.y;
-        this->coordinates.z += vector.coordinates.z;
-    }
-
-    void Vector3::operator -= (const Vector3& vector) {
-        this->coordinates.x -= vector.coordinates.x;
-        this->coordinates.y -= vector.coordinates.y;
-        this->coordinates.z -= vector.coordinates.z;
-    }
-
-    void Vector3::operator *= (const Scalar& k) {
-        this->coordinates.x *= k;
-        this->coordinates.y *= k;
-        this->coordinates.z *= k;
-    }
-
-    void Vector3::operator /= (const Scalar& k) {
-        this->coordinates.x /= k;
-        this->coordinates.y /= k;
-        this->coordinates.z /= k;
-    }
-
     Matrix3 Vector3::outer(const Vector3& vector) const
     {
         return Matrix3(
@@ -1,22 +1,6 @@
 #include <Vector4.hpp>
 
 namespace Math {
-    Vector4::Vector4() {
-        coordinates = Vector4Coordinates<Scalar>();
-        this->coordinates.x = (Scalar) 0.0;
-        this->coordinates.y = (Scalar) 0.0;
-        this->coordinates.z = (Scalar) 0.0;
-        this->coordinates.w = (Scalar) 0.0;
-    }
-
-    Vector4::Vector4(const Scalar& x, const Scalar& y, const Scalar& z, const Scalar& w) {
-        coordinates = Vector4Coordinates<Scalar>();
-        this->coordinates.x = x;
-        this->coordinates.y = y;
-        this->coordinates.z = z;
-        this->coordinates.w = w;
-    }
-
     Vector4::Vector4(const Vector2& vector, const Scalar& z, const Scalar& w) {
         coordinates = Vector4Coordinates<Scalar>();
         this->coordinates.x = vector.coordinates.x;
@@ -33,21 +17,6 @@ namespace Math {
         this->coordinates.w = w;
     }
     
-    Vector4::Vector4(const Vector4& vector) {
-        coordinates = Vector4Coordinates<Scalar>();
-        this->coordinates.x = vector.coordinates.x;
-        this->coordinates.y = vector.coordinates.y;
-        this->coordinates.z = vector.coordinates.z;
-        this->coordinates.w = vector.coordinates.w;
-    }
-
-    Scalar Vector4::dot(const Vector4& vector) const {
-        return this->coordinates.x * vector.coordinates.x +
-                this->coordinates.y * vector.coordinates.y +
-                this->coordinates.z * vector.coordinates.z +
-                this->coordinates.w * vector.coordinates.w;
-    }
-
     Vector4 Vector4::componentWise(const Vector4& vector) const {
         return Vector4(
             this->coordinates.x * vector.coordinates.x,
@@ -57,15 +26,6 @@ namespace Math {
         );
     }
 
-    Scalar Vector4::magnitude() const {
-        return std::sqrt(this->squareMagnitude());
-    }
-
-    Scalar Vector4::squareMagnitude() const {
-        return (this->coordinates.x * this->coordinates.x) + (this->coordinates.y * this->coordinates.y) 
-                + (this->coordinates.z * this->coordinates.z) + (this->coordinates.w * this->coordinates.w);
-    }
-
     Vector4 Vector4::normalized() const {
         return *this / this->magnitude();
     }
@@ -100,74 +60,10 @@ namespace Math {
         throw std::invalid_argument("INDEX_OUT_OF_RANGE::in Vector4 the index might be either 0 or 1");
     }
 
-    Scalar Vector4::operator * (const Vector4& vector) const {
-        return this->dot(vector);
-    }
-
-    Vector4 Vector4::operator + (const Vector4& vector) const {
-        return Vector4(this->coordinates.x + vector.coordinates.x, 
-            this->coordinates.y + vector.coordinates.y,
-            this->coordinates.z + vector.coordinates.z,
-            this->coordinates.w + vector.coordinates.w);
-    }
-
-    Vector4 Vector4::operator - (const Vector4& vector) const {
-            return Vector4(this->coordinates.x - vector.coordinates.x, 
-                this->coordinates.y - vector.coordinates.y,
-                this->coordinates.z - vector.coordinates.z,
-                this->coordinates.w - vector.coordinates.w);
-    }
-
     bool Vector4::operator == (const Vector4& vector) const {
         return this->areEquals(vector);
     }
 
-    Vector4 Vector4::operator - () const {
-        return Vector4(-this->coordinates.x, -this->coordinates.y, -this->coordinates.z, -this->coordinates.w);
-    }
-
-    Vector4 Vector4::operator * (const Scalar& k) const {
-        return Vector4(this->coordinates.x * k, 
-                this->coordinates.y * k,
-                this->coordinates.z * k,
-                this->coordinates.w * k);
-    }
-
-    Vector4 Vector4::operator / (const Scalar& k) const {
-        return Vector4(this->coordinates.x / k, 
-                this->coordinates.y / k,
-                this->coordinates.z / k,
-                this->coordinates.w / k);
-    }
-
-    void Vector4::operator += (const Vector4& vector) {
-        this->coordinates.x += vector.coordinates.x;
-        this->coordinates.y += vector.coordinates.y;
-        this->coordinates.z += vector.coordinates.z;
-        this->coordinates.w += vector.coordinates.w;
-    }
-
-    void Vector4::operator -= (const Vector4& vector) {
-        this->coordinates.x -= vector.coordinates.x;
-        this->coordinates.y -= vector.coordinates.y;
-        this->coordinates.z -= vector.coordinates.z;
-        this->coordinates.w -= vector.coordinates.w;
-    }
-
-    void Vector4::operator *= (const Scalar& k) {
-        this->coordinates.x *= k;
-        this->coordinates.y *= k;
-        this->coordinates.z *= k;
-        this->coordinates.w *= k;
-    }
-
-    void Vector4::operator /= (const Scalar& k) {
-        this->coordinates.x /= k;
-        this->coordinates.y /= k;
-        this->coordinates.z /= k;
-        this->coordinates.w /= k;
-    }
-
     Vector3 Vector4::xyz()
     {
         return Vector3(this->coordinates.x, this->coordinates.y, this->coordinates.z);
@@ -7,14 +7,6 @@ struct Material {
     float shininess;
 };
 
-struct Light {
-    vec3 position;  // Now this is the direction of light
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
 in vec3 FragPos;
 in vec3 Normal;
 in vec3 ViewDir;
@@ -22,7 +14,14 @@ in vec3 ViewDir;
 out vec4 FragColor;
 
 uniform Material material;
-uniform Light light;
+layout (std140) uniform Light
+{
+    vec3 position;  // Now this is the direction of light
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+} light;
 
 const float ALPHA_MIN = 0.2;
 const float ALPHA_MAX = 0.8;
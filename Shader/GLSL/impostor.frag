@@ -7,14 +7,6 @@ struct Material {
     float shininess;
 };
 
-struct Light {
-    vec3 position;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
 in vec2 TexCoords;
 in vec4 worldPos;
 in vec3 ViewDir;
@@ -23,11 +15,22 @@ flat in float radiusClip;
 out vec4 FragColor;
 
 uniform Material material;
-uniform Light light;
+layout (std140) uniform Light
+{
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+} light;
+
 uniform vec3 sphereCenter;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140, row_major) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+};
 uniform float radius;
 
 void main()
@@ -2,8 +2,11 @@
 
 layout (location = 0) in vec2 aPos;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140, row_major) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+};
 
 uniform vec3 center;
 uniform float radius;
@@ -8,8 +8,11 @@ out vec3 Normal;
 out vec3 ViewDir;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140, row_major) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+};
 
 void main()
 {
@@ -0,0 +1,64 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glad/glad.h>
+
+#include <unordered_map>
+
+namespace Renderer
+{
+    // Shadow copy of the GL state touched by the renderers. A call that would set a value the context already holds is
+    // not issued, and the calls that do go through are counted. Every state change of the meshes has to go through
+    // here for the shadow copy to stay valid; invalidate() after code that changes the state behind its back.
+    class GLState
+    {
+    public:
+        struct Counters
+        {
+            unsigned long issued = 0;
+            unsigned long elided = 0;
+            unsigned long uniforms = 0;
+            unsigned long draws = 0;
+        };
+
+        static void useProgram(GLuint program);
+        static void bindVertexArray(GLuint vertexArray);
+
+        static void setCapability(GLenum capability, bool enabled);
+        static void enable(GLenum capability);
+        static void disable(GLenum capability);
+
+        static void depthMask(GLboolean flag);
+        static void polygonMode(GLenum face, GLenum mode);
+        static void polygonOffset(GLfloat factor, GLfloat units);
+        static void blendFunc(GLenum source, GLenum destination);
+
+        static void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+
+        static void countUniform();
+
+        // Forgets the shadow copy, the next call of every kind is issued
+        static void invalidate();
+
+        // Stores the counters of the frame that just ended and starts counting the next one
+        static void endFrame();
+        static const Counters& getLastFrameCounters();
+
+    private:
+        static constexpr GLint UNKNOWN = -1;
+
+        static GLint program;
+        static GLint vertexArray;
+        static GLint depthWrite;
+        static GLint polygonFace, polygonFill;
+        static GLint blendSource, blendDestination;
+        static GLfloat offsetFactor, offsetUnits;
+        static bool offsetKnown;
+        static std::unordered_map<GLenum, bool> capabilities;
+
+        static Counters current;
+        static Counters lastFrame;
+    };
+}
+
+#endif
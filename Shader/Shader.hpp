@@ -11,6 +11,7 @@
 #include <Matrix4.hpp>
 
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -33,6 +34,9 @@ namespace Renderer
         // activate the shader
         // ------------------------------------------------------------------------
         void use() const;
+        // location of an active uniform, resolved once at link time (-1 if the program doesn't use it)
+        // ------------------------------------------------------------------------
+        GLint getUniformLocation(const std::string &name) const;
         // utility uniform functions
         // ------------------------------------------------------------------------
         void setBool(const std::string &name, bool value) const;
@@ -57,6 +61,14 @@ namespace Renderer
         void setMat4(const std::string &name, const Math::Matrix4& mat) const;
 
     private:
+        std::unordered_map<std::string, GLint> uniformLocations;
+
+        // reads every active uniform of the linked program into uniformLocations
+        // ------------------------------------------------------------------------
+        void cacheUniformLocations();
+        // attaches the Camera and Light blocks, when used, to their shared binding points
+        // ------------------------------------------------------------------------
+        void bindUniformBlocks();
         // utility function for checking shader compilation/linking errors.
         // ------------------------------------------------------------------------
         void checkCompileErrors(GLuint shader, std::string type);
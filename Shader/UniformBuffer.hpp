@@ -0,0 +1,79 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <Vector3.hpp>
+#include <Matrix4.hpp>
+
+#include <vector>
+
+namespace Renderer
+{
+    // Binding points of the uniform blocks shared by every shader, see Shader::bindUniformBlocks
+    static constexpr GLuint CAMERA_BLOCK_BINDING = 0;
+    static constexpr GLuint LIGHT_BLOCK_BINDING = 1;
+
+    // std140 image of `layout (std140, row_major) uniform Camera { mat4 view; mat4 projection; }`
+    struct CameraBlock
+    {
+        float view[16];
+        float projection[16];
+
+        CameraBlock(const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                view[i] = static_cast<float>(viewMatrix.data[i]);
+                projection[i] = static_cast<float>(projectionMatrix.data[i]);
+            }
+        }
+    };
+
+    // std140 image of `uniform Light { vec3 position; vec3 ambient; vec3 diffuse; vec3 specular; }`, every vec3 takes
+    // the room of a vec4
+    struct LightBlock
+    {
+        float position[4];
+        float ambient[4];
+        float diffuse[4];
+        float specular[4];
+
+        LightBlock(const Math::Vector3& p, const Math::Vector3& a, const Math::Vector3& d, const Math::Vector3& s)
+        {
+            const Math::Vector3* sources[4] = {&p, &a, &d, &s};
+            float* targets[4] = {position, ambient, diffuse, specular};
+
+            for (int i = 0; i < 4; i++)
+            {
+                targets[i][0] = static_cast<float>(sources[i]->coordinates.x);
+                targets[i][1] = static_cast<float>(sources[i]->coordinates.y);
+                targets[i][2] = static_cast<float>(sources[i]->coordinates.z);
+                targets[i][3] = 0;
+            }
+        }
+    };
+
+    // Uniform buffer bound to a fixed binding point. The last uploaded contents are kept, an update with the same bytes
+    // doesn't reach the driver
+    class UniformBuffer
+    {
+    public:
+        UniformBuffer() = default;
+
+        void create(GLuint binding, GLsizeiptr size);
+        void update(const void* data, GLsizeiptr size);
+
+        template <typename Block>
+        void update(const Block& block)
+        {
+            update(&block, sizeof(Block));
+        }
+
+    private:
+        GLuint ID = 0;
+        std::vector<unsigned char> contents;
+    };
+}
+
+#endif
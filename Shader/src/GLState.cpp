@@ -0,0 +1,163 @@
+#include <GLState.hpp>
+
+namespace Renderer
+{
+    GLint GLState::program = GLState::UNKNOWN;
+    GLint GLState::vertexArray = GLState::UNKNOWN;
+    GLint GLState::depthWrite = GLState::UNKNOWN;
+    GLint GLState::polygonFace = GLState::UNKNOWN;
+    GLint GLState::polygonFill = GLState::UNKNOWN;
+    GLint GLState::blendSource = GLState::UNKNOWN;
+    GLint GLState::blendDestination = GLState::UNKNOWN;
+    GLfloat GLState::offsetFactor = 0;
+    GLfloat GLState::offsetUnits = 0;
+    bool GLState::offsetKnown = false;
+    std::unordered_map<GLenum, bool> GLState::capabilities;
+
+    GLState::Counters GLState::current;
+    GLState::Counters GLState::lastFrame;
+
+    void GLState::useProgram(GLuint id)
+    {
+        if (program == static_cast<GLint>(id))
+        {
+            current.elided++;
+            return;
+        }
+
+        glUseProgram(id);
+        program = static_cast<GLint>(id);
+        current.issued++;
+    }
+
+    void GLState::bindVertexArray(GLuint id)
+    {
+        if (vertexArray == static_cast<GLint>(id))
+        {
+            current.elided++;
+            return;
+        }
+
+        glBindVertexArray(id);
+        vertexArray = static_cast<GLint>(id);
+        current.issued++;
+    }
+
+    void GLState::setCapability(GLenum capability, bool enabled)
+    {
+        auto it = capabilities.find(capability);
+        if (it != capabilities.end() && it->second == enabled)
+        {
+            current.elided++;
+            return;
+        }
+
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+
+        capabilities[capability] = enabled;
+        current.issued++;
+    }
+
+    void GLState::enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+
+    void GLState::disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+
+    void GLState::depthMask(GLboolean flag)
+    {
+        if (depthWrite == static_cast<GLint>(flag))
+        {
+            current.elided++;
+            return;
+        }
+
+        glDepthMask(flag);
+        depthWrite = static_cast<GLint>(flag);
+        current.issued++;
+    }
+
+    // Only the last (face, mode) pair is remembered: a call on a single face always invalidates the pair
+    void GLState::polygonMode(GLenum face, GLenum mode)
+    {
+        if (polygonFace == static_cast<GLint>(face) && polygonFill == static_cast<GLint>(mode))
+        {
+            current.elided++;
+            return;
+        }
+
+        glPolygonMode(face, mode);
+        polygonFace = face == GL_FRONT_AND_BACK ? static_cast<GLint>(face) : UNKNOWN;
+        polygonFill = static_cast<GLint>(mode);
+        current.issued++;
+    }
+
+    void GLState::polygonOffset(GLfloat factor, GLfloat units)
+    {
+        if (offsetKnown && offsetFactor == factor && offsetUnits == units)
+        {
+            current.elided++;
+            return;
+        }
+
+        glPolygonOffset(factor, units);
+        offsetFactor = factor;
+        offsetUnits = units;
+        offsetKnown = true;
+        current.issued++;
+    }
+
+    void GLState::blendFunc(GLenum source, GLenum destination)
+    {
+        if (blendSource == static_cast<GLint>(source) && blendDestination == static_cast<GLint>(destination))
+        {
+            current.elided++;
+            return;
+        }
+
+        glBlendFunc(source, destination);
+        blendSource = static_cast<GLint>(source);
+        blendDestination = static_cast<GLint>(destination);
+        current.issued++;
+    }
+
+    void GLState::drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        glDrawElements(mode, count, type, indices);
+        current.draws++;
+    }
+
+    void GLState::countUniform()
+    {
+        current.uniforms++;
+    }
+
+    void GLState::invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        depthWrite = UNKNOWN;
+        polygonFace = polygonFill = UNKNOWN;
+        blendSource = blendDestination = UNKNOWN;
+        offsetKnown = false;
+        capabilities.clear();
+    }
+
+    void GLState::endFrame()
+    {
+        lastFrame = current;
+        current = Counters();
+    }
+
+    const GLState::Counters& GLState::getLastFrameCounters()
+    {
+        return lastFrame;
+    }
+}
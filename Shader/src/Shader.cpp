@@ -1,4 +1,8 @@
 #include <Shader.hpp>
+#include <GLState.hpp>
+#include <UniformBuffer.hpp>
+
+#include <algorithm>
 
 namespace Renderer
 {
@@ -60,6 +64,8 @@ namespace Renderer
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        cacheUniformLocations();
+        bindUniformBlocks();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -77,52 +83,109 @@ namespace Renderer
 
     void Shader::use() const
     {
-        glUseProgram(ID);
+        GLState::useProgram(ID);
+    }
+
+    GLint Shader::getUniformLocation(const std::string &name) const
+    {
+        auto it = uniformLocations.find(name);
+        return it == uniformLocations.end() ? -1 : it->second;
+    }
+
+    void Shader::cacheUniformLocations()
+    {
+        uniformLocations.clear();
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::string name(std::max(maxLength, 1), '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+
+            std::string uniform = name.substr(0, length);
+            GLint location = glGetUniformLocation(ID, uniform.c_str());
+
+            // Members of uniform blocks have no location
+            if (location < 0)
+                continue;
+
+            uniformLocations[uniform] = location;
+
+            // Arrays are reported as "name[0]", they are also set by their plain name
+            if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+                uniformLocations[uniform.substr(0, uniform.size() - 3)] = location;
+        }
+    }
+
+    void Shader::bindUniformBlocks()
+    {
+        GLuint camera = glGetUniformBlockIndex(ID, "Camera");
+        if (camera != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, camera, CAMERA_BLOCK_BINDING);
+
+        GLuint light = glGetUniformBlockIndex(ID, "Light");
+        if (light != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, light, LIGHT_BLOCK_BINDING);
     }
 
     void Shader::setBool(const std::string &name, bool value) const
         {
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+            GLState::countUniform();
+            glUniform1i(getUniformLocation(name), (int)value);
         }
     // ------------------------------------------------------------------------
     void Shader::setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        GLState::countUniform();
+        glUniform1i(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void Shader::setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        GLState::countUniform();
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void Shader::setVec2(const std::string &name, const Math::Vector2& value) const
     {
         float v[2] = { static_cast<float>(value.coordinates.x), static_cast<float>(value.coordinates.y) };
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, v);
+        GLState::countUniform();
+        glUniform2fv(getUniformLocation(name), 1, v);
     }
     void Shader::setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        GLState::countUniform();
+        glUniform2f(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
     void Shader::setVec3(const std::string &name, const Math::Vector3& value) const
     {
         float v[3] = { static_cast<float>(value.coordinates.x), static_cast<float>(value.coordinates.y), static_cast<float>(value.coordinates.z) };
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, v);
+        GLState::countUniform();
+        glUniform3fv(getUniformLocation(name), 1, v);
     }
     void Shader::setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        GLState::countUniform();
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void Shader::setVec4(const std::string &name, const Math::Vector4& value) const
     {
         float v[4] = { static_cast<float>(value.coordinates.x), static_cast<float>(value.coordinates.y), static_cast<float>(value.coordinates.z), static_cast<float>(value.coordinates.w) };
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, v);
+        GLState::countUniform();
+        glUniform4fv(getUniformLocation(name), 1, v);
     }
     void Shader::setVec4(const std::string &name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        GLState::countUniform();
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void Shader::setMat2(const std::string &name, const Math::Matrix2& mat) const
@@ -131,7 +194,8 @@ namespace Renderer
         for (int i = 0; i < 4; i++)
             m[i] = static_cast<float>(mat.data[i]);
         
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_TRUE, m);
+        GLState::countUniform();
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_TRUE, m);
     }
     // ------------------------------------------------------------------------
     void Shader::setMat3(const std::string &name, const Math::Matrix3& mat) const
@@ -140,7 +204,8 @@ namespace Renderer
         for (int i = 0; i < 9; i++)
             m[i] = static_cast<float>(mat.data[i]);
         
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_TRUE, m);
+        GLState::countUniform();
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_TRUE, m);
     }
     // ------------------------------------------------------------------------
 
@@ -150,7 +215,8 @@ namespace Renderer
         for (int i = 0; i < 16; i++)
             m[i] = static_cast<float>(mat.data[i]);
         
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_TRUE, m);
+        GLState::countUniform();
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_TRUE, m);
     }
 
     void Shader::checkCompileErrors(GLuint shader, std::string type)
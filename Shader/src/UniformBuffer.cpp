@@ -0,0 +1,32 @@
+#include <UniformBuffer.hpp>
+#include <GLState.hpp>
+
+#include <cstring>
+
+namespace Renderer
+{
+    void UniformBuffer::create(GLuint binding, GLsizeiptr size)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+        contents.clear();
+    }
+
+    void UniformBuffer::update(const void* data, GLsizeiptr size)
+    {
+        if (contents.size() == static_cast<size_t>(size) && std::memcmp(contents.data(), data, size) == 0)
+            return;
+
+        contents.assign(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        GLState::countUniform();
+    }
+}
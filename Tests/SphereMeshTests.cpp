@@ -0,0 +1,1183 @@
+//
+// SphereMeshTests.cpp
+// Checks that the optimizations of the simplification pipeline leave its result as it was: every case builds the
+// same sphere mesh through two paths and compares them.
+//
+// Usage: sphere_mesh_tests [case ...]
+//
+// Without arguments every case is run. The models come from SPHERE_MESH_ASSETS_DIR; the exit code is non zero if any
+// case fails, the first difference of a failed case is printed to stderr.
+//
+
+#include <TriMesh.hpp>
+#include <SphereMesh.hpp>
+#include <Region.hpp>
+#include <QuadricT.hpp>
+#include <QuadricBatch.hpp>
+#include <SphereMeshBVH.hpp>
+#include <ApproximationError.hpp>
+#include <PreprocessCache.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+namespace
+{
+	using Math::Scalar;
+	using Renderer::SphereMesh;
+	using Renderer::TriMesh;
+
+	// Small enough for every case to run in a few seconds
+	constexpr const char* TEST_MODEL = "dragon.obj";
+	constexpr int TEST_TARGET = 150;
+
+	// Tolerances of the cases that compare against a result computed another way, relative to the cost or to the
+	// bounding box diagonal
+	constexpr Scalar FLOAT_COST_TOLERANCE = 1e-2;
+	constexpr Scalar FLOAT_MINIMIZER_TOLERANCE = 1e-6;
+	constexpr Scalar LAZY_BATCH_TOLERANCE = 1e-9;
+	constexpr Scalar COST_TOLERANCE = 1e-12;
+	constexpr Scalar CHUNKED_ERROR_RATIO = 1.5;
+	constexpr Scalar RINGS_ERROR_RATIO = 1.5;
+
+	std::string modelPath(const std::string& name)
+	{
+		return std::string(SPHERE_MESH_ASSETS_DIR) + "/" + name;
+	}
+
+	// Spheres built from the mesh with the settings of configure, on 4-ring neighbourhoods: the default ones (the
+	// 1-ring extended twice) reach most of a small mesh and would only make the cases slower
+	void build(SphereMesh& sm, const std::function<void(SphereMesh&)>& configure = {})
+	{
+		sm.NEIGHBOURHOOD_RINGS = 4;
+		if (configure)
+			configure(sm);
+
+		sm.resetSphereMesh();
+	}
+
+	// Active spheres in index order and the connectivity between them, through the aliases
+	struct Result
+	{
+		std::vector<int> active;
+		std::vector<std::array<Scalar, 4>> spheres;
+		std::set<std::array<int, 3>> triangles;
+		std::set<std::array<int, 2>> edges;
+	};
+
+	Result result(SphereMesh& sm)
+	{
+		Result r;
+
+		for (int i = 0; i < static_cast<int>(sm.timedSpheres.size()); i++)
+			if (sm.isTimedSphereAlive(i))
+			{
+				const Renderer::Sphere& s = sm.timedSpheres[i].sphere;
+				r.active.push_back(i);
+				r.spheres.push_back({s.center[0], s.center[1], s.center[2], s.radius});
+			}
+
+		for (const Renderer::Triangle& t : sm.getTriangles())
+		{
+			std::array<int, 3> ids{sm.alias(t.i), sm.alias(t.j), sm.alias(t.k)};
+			std::sort(ids.begin(), ids.end());
+			r.triangles.insert(ids);
+		}
+
+		for (const Renderer::Edge& e : sm.getEdges())
+		{
+			std::array<int, 2> ids{sm.alias(e.i), sm.alias(e.j)};
+			std::sort(ids.begin(), ids.end());
+			r.edges.insert(ids);
+		}
+
+		return r;
+	}
+
+	// Same spheres (centers and radii within tolerance, relative to the bounding box diagonal) and same connectivity
+	bool same(const Result& a, const Result& b, Scalar bdd, Scalar tolerance = 0)
+	{
+		if (a.active != b.active)
+		{
+			std::cerr << "  active spheres differ: " << a.active.size() << " and " << b.active.size() << std::endl;
+			return false;
+		}
+
+		for (size_t i = 0; i < a.spheres.size(); i++)
+			for (int c = 0; c < 4; c++)
+				if (std::abs(a.spheres[i][c] - b.spheres[i][c]) > tolerance * bdd)
+				{
+					std::cerr << "  sphere " << a.active[i] << " differs: " << a.spheres[i][c] << " and "
+					          << b.spheres[i][c] << std::endl;
+					return false;
+				}
+
+		if (a.triangles != b.triangles || a.edges != b.edges)
+		{
+			std::cerr << "  connectivity differs: " << a.triangles.size() << "/" << a.edges.size() << " and "
+			          << b.triangles.size() << "/" << b.edges.size() << " triangles/edges" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// A batch of one collapse is the greedy step
+	bool batchOfOneMatchesGreedy()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+
+		SphereMesh greedy(&mesh, nullptr, SphereMesh::Deferred{});
+		build(greedy);
+		greedy.collapseSphereMesh(TEST_TARGET);
+
+		SphereMesh batched(&mesh, nullptr, SphereMesh::Deferred{});
+		build(batched, [](SphereMesh& sm) { sm.BATCH_SIZE = 1; });
+		batched.collapseSphereMeshBatched(TEST_TARGET);
+
+		return same(result(greedy), result(batched), mesh.bbox.BDD().magnitude());
+	}
+
+	// Pruned pairs are back in the queue before anything costlier is popped, by both the greedy and the batched pass
+	bool pruningKeepsResult()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		const Scalar bdd = mesh.bbox.BDD().magnitude();
+
+		for (bool batched : {false, true})
+		{
+			Result results[2];
+
+			for (int pruned = 0; pruned < 2; pruned++)
+			{
+				SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+				build(sm, [&](SphereMesh& s) { s.CANDIDATE_PRUNE_ERROR = pruned ? 0.001 : 0; });
+
+				if (batched)
+					sm.collapseSphereMeshBatched(TEST_TARGET);
+				else
+					sm.collapseSphereMesh(TEST_TARGET);
+
+				results[pruned] = result(sm);
+			}
+
+			if (!same(results[0], results[1], bdd))
+			{
+				std::cerr << "  " << (batched ? "batched" : "greedy") << " pass" << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// The ring builder against the default neighbourhoods. Those are extended in place, while the sets are iterated,
+	// so how far they reach depends on hash order: both link every sphere to its face neighbours, the rings are
+	// symmetric, and collapsing on 3 rings stays within RINGS_ERROR_RATIO of the surface error of the default
+	bool ringsMatchDefaultNeighbourhoods()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		Renderer::ApproximationErrorEvaluator evaluator(mesh, 20000);
+
+		Scalar errors[2];
+		for (int rings : {0, 3})
+		{
+			SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+			build(sm, [&](SphereMesh& s) { s.NEIGHBOURHOOD_RINGS = rings; });
+
+			for (const Renderer::Face& f : mesh.faces)
+				for (auto [i, j] : {std::pair(f.i, f.j), std::pair(f.j, f.k), std::pair(f.k, f.i)})
+					if (!sm.timedSpheres[i].sphere.neighbourSpheres.count(j) ||
+					    !sm.timedSpheres[j].sphere.neighbourSpheres.count(i))
+					{
+						std::cerr << "  " << rings << " rings: spheres " << i << " and " << j << " share a face but are "
+						          << "not linked" << std::endl;
+						return false;
+					}
+
+			if (rings > 0)
+				for (int i = 0; i < static_cast<int>(sm.timedSpheres.size()); i++)
+					for (int j : sm.timedSpheres[i].sphere.neighbourSpheres)
+						if (j == i || !sm.timedSpheres[j].sphere.neighbourSpheres.count(i))
+						{
+							std::cerr << "  sphere " << i << " links " << j << " one way" << std::endl;
+							return false;
+						}
+
+			sm.collapseSphereMesh(TEST_TARGET);
+			errors[rings > 0] = evaluator.evaluate(sm).meanRelative;
+		}
+
+		if (errors[1] > RINGS_ERROR_RATIO * errors[0])
+		{
+			std::cerr << "  mean error " << errors[1] << " on 3 rings and " << errors[0] << " by default" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// Drags of random spheres, as the editor applies them on release
+	void dragSpheres(SphereMesh& sm, int edits, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_int_distribution<int> pick(0, static_cast<int>(sm.timedSpheres.size()) - 1);
+		std::uniform_real_distribution<Scalar> offset(-0.5, 0.5);
+		std::uniform_real_distribution<Scalar> scale(0.8, 1.2);
+
+		for (int e = 0; e < edits; e++)
+		{
+			int i = pick(generator);
+			while (sm.alias(i) != i)
+				i = pick(generator);
+
+			Renderer::Sphere& sphere = sm.timedSpheres[i].sphere;
+			sphere.center += Math::Vector3(offset(generator), offset(generator), offset(generator)) * sphere.radius;
+			sphere.radius *= scale(generator);
+
+			sm.updateAfterEdit(sphere.getID());
+		}
+	}
+
+	// Sphere of every vertex
+	std::vector<int> vertexSpheres(SphereMesh& sm, std::vector<std::vector<int>>* verticesOfSpheres = nullptr)
+	{
+		std::vector<int> offsets, vertices;
+		sm.gatherSphereVertices(offsets, vertices);
+
+		std::vector<int> owners(vertices.size(), -1);
+		for (int s = 0; s + 1 < static_cast<int>(offsets.size()); s++)
+			for (int k = offsets[s]; k < offsets[s + 1]; k++)
+				owners[vertices[k]] = s;
+
+		if (verticesOfSpheres)
+			for (int s = 0; s + 1 < static_cast<int>(offsets.size()); s++)
+				verticesOfSpheres->emplace_back(vertices.begin() + offsets[s], vertices.begin() + offsets[s + 1]);
+
+		return owners;
+	}
+
+	// The connectivity after edits is the one the faces give from scratch; a sphere some edit changed is linked to
+	// the spheres it shares a face with and no other, the others keep at least those
+	bool editsMatchFullRebuild()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+
+		SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+		build(sm);
+		sm.collapseSphereMesh(TEST_TARGET);
+
+		std::vector<std::vector<int>> before, after;
+		vertexSpheres(sm, &before);
+		dragSpheres(sm, 50, 7);
+		const std::vector<int> owners = vertexSpheres(sm, &after);
+
+		Result rebuilt;
+		std::vector<std::set<int>> adjacency(sm.timedSpheres.size());
+		for (const Renderer::Face& f : mesh.faces)
+		{
+			Renderer::Triangle t(owners[f.i], owners[f.j], owners[f.k]);
+			for (auto [a, b] : {std::pair(t.i, t.j), std::pair(t.j, t.k), std::pair(t.i, t.k)})
+				if (a != b)
+				{
+					adjacency[a].insert(b);
+					adjacency[b].insert(a);
+				}
+
+			if (t.i == t.k)
+				continue;
+			else if (t.i == t.j || t.j == t.k)
+				rebuilt.edges.insert({t.i, t.k});
+			else
+				rebuilt.triangles.insert({t.i, t.j, t.k});
+		}
+
+		const Result edited = result(sm);
+		if (edited.triangles != rebuilt.triangles || edited.edges != rebuilt.edges)
+		{
+			std::cerr << "  connectivity differs from the rebuild: " << edited.triangles.size() << "/"
+			          << edited.edges.size() << " and " << rebuilt.triangles.size() << "/" << rebuilt.edges.size()
+			          << " triangles/edges" << std::endl;
+			return false;
+		}
+
+		int changed = 0;
+		for (int s : edited.active)
+		{
+			std::set<int> neighbours;
+			for (int t : sm.timedSpheres[s].sphere.neighbourSpheres)
+			{
+				int a = sm.alias(t);
+				if (a < 0 || !sm.timedSpheres[a].sphere.neighbourSpheres.count(s))
+				{
+					std::cerr << "  sphere " << s << " is linked to " << t << " one way or to a removed sphere" << std::endl;
+					return false;
+				}
+				neighbours.insert(a);
+			}
+
+			std::sort(before[s].begin(), before[s].end());
+			std::sort(after[s].begin(), after[s].end());
+			const bool wasChanged = before[s] != after[s];
+			changed += wasChanged;
+
+			if (wasChanged ? neighbours != adjacency[s]
+			               : !std::includes(neighbours.begin(), neighbours.end(), adjacency[s].begin(), adjacency[s].end()))
+			{
+				std::cerr << "  neighbours of sphere " << s << " differ from the rebuild: " << neighbours.size()
+				          << " and " << adjacency[s].size() << std::endl;
+				return false;
+			}
+		}
+
+		if (changed == 0)
+		{
+			std::cerr << "  no edit moved a vertex" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// The multiple-choice scheduler draws its samples from the seed alone, the solves and merges that run in parallel
+	// don't change them: the same seed collapses to the same sphere mesh on 1 and 4 threads
+	bool multipleChoiceRepeatsSeed()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		const int previousThreads = omp_get_max_threads();
+
+		Result results[2];
+		for (int k = 0; k < 2; k++)
+		{
+			omp_set_num_threads(k == 0 ? 1 : 4);
+
+			SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+			build(sm);
+			sm.collapseSphereMeshMultipleChoice(TEST_TARGET, 7);
+			results[k] = result(sm);
+		}
+
+		omp_set_num_threads(previousThreads);
+		return same(results[0], results[1], mesh.bbox.BDD().magnitude());
+	}
+
+	// Another seed draws other samples: a sphere mesh of the same size, with finite spheres and connectivity between
+	// active spheres only, but not the same one
+	bool multipleChoiceOtherSeedDiffers()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+
+		Result results[2];
+		for (unsigned int seed : {7u, 8u})
+		{
+			SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+			build(sm);
+			sm.collapseSphereMeshMultipleChoice(TEST_TARGET, seed);
+
+			Result& r = results[seed - 7];
+			r = result(sm);
+
+			auto isActive = [&](int i) { return std::binary_search(r.active.begin(), r.active.end(), i); };
+			bool valid = static_cast<int>(r.active.size()) == TEST_TARGET;
+			for (const std::array<Scalar, 4>& sphere : r.spheres)
+				valid &= std::isfinite(sphere[0]) && std::isfinite(sphere[1]) && std::isfinite(sphere[2]) &&
+				         std::isfinite(sphere[3]) && sphere[3] > 0;
+			for (const std::array<int, 3>& t : r.triangles)
+				valid &= isActive(t[0]) && isActive(t[1]) && isActive(t[2]);
+			for (const std::array<int, 2>& e : r.edges)
+				valid &= isActive(e[0]) && isActive(e[1]);
+
+			if (!valid)
+			{
+				std::cerr << "  seed " << seed << " leaves " << r.active.size() << " spheres, or a bad sphere or link"
+				          << std::endl;
+				return false;
+			}
+		}
+
+		if (results[0].active == results[1].active && results[0].spheres == results[1].spheres &&
+		    results[0].triangles == results[1].triangles && results[0].edges == results[1].edges)
+		{
+			std::cerr << "  seeds 7 and 8 give the same sphere mesh" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// A checkpoint written between collapses (after every one, or every batch) resumes to the same sphere mesh as the
+	// run that wrote it
+	bool checkpointResumesCollapse()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		const std::string path = (std::filesystem::temp_directory_path() / "sphere_mesh_tests.checkpoint").string();
+
+		for (bool batched : {false, true})
+		{
+			auto collapse = [&](SphereMesh& sm, int target)
+			{
+				if (batched)
+					sm.collapseSphereMeshBatched(target);
+				else
+					sm.collapseSphereMesh(target);
+			};
+
+			SphereMesh uninterrupted(&mesh, nullptr, SphereMesh::Deferred{});
+			build(uninterrupted);
+			uninterrupted.CHECKPOINT_PATH = path;
+			uninterrupted.CHECKPOINT_INTERVAL = 0;
+			collapse(uninterrupted, 2 * TEST_TARGET);
+			uninterrupted.CHECKPOINT_PATH.clear();
+			collapse(uninterrupted, TEST_TARGET);
+
+			SphereMesh resumed(&mesh, nullptr, SphereMesh::Deferred{});
+			build(resumed);
+			if (!resumed.loadCheckpoint(path))
+			{
+				std::cerr << "  the checkpoint of the " << (batched ? "batched" : "greedy") << " pass doesn't load"
+				          << std::endl;
+				return false;
+			}
+			collapse(resumed, TEST_TARGET);
+
+			if (!same(result(uninterrupted), result(resumed), mesh.bbox.BDD().magnitude()))
+			{
+				std::cerr << "  " << (batched ? "batched" : "greedy") << " pass" << std::endl;
+				return false;
+			}
+		}
+
+		std::filesystem::remove(path);
+		return true;
+	}
+
+	// A model opened a second time comes from the preprocess cache: mesh, sphere quadrics, neighbour sets (in their
+	// original iteration order) and initial collapses. Both opens collapse to the same sphere mesh
+	bool cachedOpenMatchesFresh()
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "sphere_mesh_tests.preprocessed";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		const Renderer::PreprocessCache cache(directory.string());
+
+		Result results[2];
+		std::set<std::pair<std::string, std::filesystem::file_time_type>> entries[2];
+		Scalar bdd = 0;
+		for (int cached = 0; cached < 2; cached++)
+		{
+			TriMesh mesh(modelPath(TEST_MODEL), nullptr, cache);
+			SphereMesh sm(&mesh, nullptr, cache);
+			bdd = mesh.bbox.BDD().magnitude();
+
+			for (const auto& entry : std::filesystem::directory_iterator(directory))
+				entries[cached].emplace(entry.path().string(), entry.last_write_time());
+
+			// The first open writes a mesh entry and a sphere mesh entry, the second one only reads them
+			if (entries[cached].size() != 2 || (cached && entries[1] != entries[0]))
+			{
+				std::cerr << "  the " << (cached ? "second" : "first") << " open left " << entries[cached].size()
+				          << " cache entries" << (cached ? ", or rewrote them" : "") << std::endl;
+				return false;
+			}
+
+			sm.collapseSphereMesh(TEST_TARGET);
+			results[cached] = result(sm);
+		}
+
+		std::filesystem::remove_all(directory);
+		return same(results[0], results[1], bdd);
+	}
+
+	// Faces as OBJ vertex indices, each rotated to start at its smallest index so that the orientation is kept
+	std::multiset<std::array<int, 3>> fileFaces(const TriMesh& mesh)
+	{
+		std::multiset<std::array<int, 3>> faces;
+
+		for (const Renderer::Face& f : mesh.faces)
+		{
+			std::array<int, 3> ids{mesh.toFileIndex(f.i), mesh.toFileIndex(f.j), mesh.toFileIndex(f.k)};
+			std::rotate(ids.begin(), std::min_element(ids.begin(), ids.end()), ids.end());
+			faces.insert(ids);
+		}
+
+		return faces;
+	}
+
+	// A spatially ordered mesh is the file one with its vertices permuted: fileIndices is a permutation, every vertex
+	// sits where its OBJ vertex does, and the faces are the OBJ ones
+	bool spatialOrderKeepsFileVertices()
+	{
+		TriMesh file(modelPath(TEST_MODEL), nullptr);
+		TriMesh sorted(modelPath(TEST_MODEL), nullptr, true);
+
+		if (file.isSpatiallyOrdered() || !sorted.isSpatiallyOrdered() || sorted.vertices.size() != file.vertices.size())
+		{
+			std::cerr << "  " << sorted.vertices.size() << " sorted and " << file.vertices.size()
+			          << " file vertices, or the spatial order was not recorded" << std::endl;
+			return false;
+		}
+
+		std::vector<bool> seen(file.vertices.size(), false);
+		for (int v = 0; v < static_cast<int>(sorted.vertices.size()); v++)
+		{
+			const int f = sorted.toFileIndex(v);
+			if (f < 0 || f >= static_cast<int>(file.vertices.size()) || seen[f])
+			{
+				std::cerr << "  vertex " << v << " has file index " << f << ", out of range or repeated" << std::endl;
+				return false;
+			}
+			seen[f] = true;
+
+			for (int c = 0; c < 3; c++)
+				if (sorted.vertices[v].position[c] != file.vertices[f].position[c])
+				{
+					std::cerr << "  vertex " << v << " is not where file vertex " << f << " is" << std::endl;
+					return false;
+				}
+		}
+
+		if (fileFaces(sorted) != fileFaces(file))
+		{
+			std::cerr << "  faces differ once mapped back to the file vertices" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// Connectivity of r as positions in its active sphere list, dropping what refers to a removed sphere: what the
+	// exports should hold
+	Result exported(const Result& r)
+	{
+		Result e;
+		e.spheres = r.spheres;
+
+		auto position = [&](int i) {
+			auto it = std::lower_bound(r.active.begin(), r.active.end(), i);
+			return it != r.active.end() && *it == i ? static_cast<int>(it - r.active.begin()) : -1;
+		};
+
+		for (int i = 0; i < static_cast<int>(r.active.size()); i++)
+			e.active.push_back(i);
+
+		for (const auto& t : r.triangles)
+		{
+			std::array<int, 3> ids{position(t[0]), position(t[1]), position(t[2])};
+			if (ids[0] >= 0 && ids[1] >= 0 && ids[2] >= 0)
+				e.triangles.insert(ids);
+		}
+
+		for (const auto& edge : r.edges)
+		{
+			std::array<int, 2> ids{position(edge[0]), position(edge[1])};
+			if (ids[0] >= 0 && ids[1] >= 0)
+				e.edges.insert(ids);
+		}
+
+		return e;
+	}
+
+	// Counts of a header against the records that follow it, every index inside the sphere list
+	bool countsMatch(const char* format, const std::array<size_t, 3>& header, const Result& records, size_t active)
+	{
+		const std::array<size_t, 3> counts{records.spheres.size(), records.triangles.size(), records.edges.size()};
+		if (header[0] != active || header != counts)
+		{
+			std::cerr << "  " << format << " header counts " << header[0] << "/" << header[1] << "/" << header[2]
+			          << " for " << active << " active spheres and " << counts[0] << "/" << counts[1] << "/"
+			          << counts[2] << " records" << std::endl;
+			return false;
+		}
+
+		auto outside = [&](int i) { return i < 0 || i >= static_cast<int>(active); };
+		for (const auto& t : records.triangles)
+			if (outside(t[0]) || outside(t[1]) || outside(t[2]))
+			{
+				std::cerr << "  " << format << " triangle refers to a sphere outside the list" << std::endl;
+				return false;
+			}
+
+		for (const auto& e : records.edges)
+			if (outside(e[0]) || outside(e[1]))
+			{
+				std::cerr << "  " << format << " edge refers to a sphere outside the list" << std::endl;
+				return false;
+			}
+
+		return true;
+	}
+
+	bool readTXT(const std::string& path, std::array<size_t, 3>& header, Result& records)
+	{
+		std::ifstream in(path);
+		std::string line;
+		if (!std::getline(in, line) || line != "Sphere Mesh 2.0" || !std::getline(in, line) ||
+		    !(in >> header[0] >> header[1] >> header[2]) || !std::getline(in, line) || !std::getline(in, line))
+			return false;
+
+		for (size_t i = 0; i < header[0]; i++)
+		{
+			std::array<Scalar, 4> s{};
+			if (!(in >> s[0] >> s[1] >> s[2] >> s[3]))
+				return false;
+			records.spheres.push_back(s);
+		}
+
+		for (size_t i = 0; i < header[1]; i++)
+		{
+			std::array<int, 3> t{};
+			if (!(in >> t[0] >> t[1] >> t[2]))
+				return false;
+			std::sort(t.begin(), t.end());
+			records.triangles.insert(t);
+		}
+
+		for (size_t i = 0; i < header[2]; i++)
+		{
+			std::array<int, 2> e{};
+			if (!(in >> e[0] >> e[1]))
+				return false;
+			std::sort(e.begin(), e.end());
+			records.edges.insert(e);
+		}
+
+		return !(in >> line);
+	}
+
+	bool readPLY(const std::string& path, std::array<size_t, 3>& header, Result& records)
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::string line;
+		for (std::getline(in, line); in && line != "end_header"; std::getline(in, line))
+		{
+			std::istringstream words(line);
+			std::string keyword, element;
+			size_t count = 0;
+			if (words >> keyword >> element >> count && keyword == "element")
+				header[element == "vertex" ? 0 : element == "face" ? 1 : 2] = count;
+		}
+
+		for (size_t i = 0; i < header[0]; i++)
+		{
+			std::array<Scalar, 4> s{};
+			in.read(reinterpret_cast<char*>(s.data()), sizeof(s));
+			records.spheres.push_back(s);
+		}
+
+		for (size_t i = 0; i < header[1]; i++)
+		{
+			std::uint8_t size = 0;
+			std::array<std::int32_t, 3> t{};
+			in.read(reinterpret_cast<char*>(&size), sizeof(size));
+			in.read(reinterpret_cast<char*>(t.data()), sizeof(t));
+			if (size != 3)
+				return false;
+			std::sort(t.begin(), t.end());
+			records.triangles.insert({t[0], t[1], t[2]});
+		}
+
+		for (size_t i = 0; i < header[2]; i++)
+		{
+			std::array<std::int32_t, 2> e{};
+			in.read(reinterpret_cast<char*>(e.data()), sizeof(e));
+			std::sort(e.begin(), e.end());
+			records.edges.insert({e[0], e[1]});
+		}
+
+		return in && in.peek() == std::char_traits<char>::eof();
+	}
+
+	// The TXT and PLY files of a collapsed sphere mesh, with one sphere removed by hand, state as many spheres as are
+	// active and hold those spheres in index order and the connectivity between them
+	bool exportsMatchActiveSpheres()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+		build(sm);
+		sm.collapseSphereMesh(TEST_TARGET);
+
+		const Result collapsed = result(sm);
+		sm.removeSphere(sm.timedSpheres[collapsed.active[collapsed.active.size() / 2]].sphere.getID());
+		const Result expected = exported(result(sm));
+		const Scalar bdd = mesh.bbox.BDD().magnitude();
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path();
+		sm.saveTXT(directory.string() + "/", "sphere_mesh_tests.txt");
+		sm.savePLY(directory.string() + "/", "sphere_mesh_tests.ply");
+
+		const char* formats[2] = {"TXT", "PLY"};
+		for (int format = 0; format < 2; format++)
+		{
+			const std::string path = (directory / (format ? "sphere_mesh_tests.ply" : "sphere_mesh_tests.txt")).string();
+			std::array<size_t, 3> header{};
+			Result records;
+			const bool read = format ? readPLY(path, header, records) : readTXT(path, header, records);
+			std::filesystem::remove(path);
+
+			if (!read)
+			{
+				std::cerr << "  " << formats[format] << " file does not hold the records its header states" << std::endl;
+				return false;
+			}
+
+			for (int i = 0; i < static_cast<int>(records.spheres.size()); i++)
+				records.active.push_back(i);
+
+			if (!countsMatch(formats[format], header, records, expected.active.size()) || !same(records, expected, bdd))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Neighbour pairs of the initial spheres, as (first, second) sphere indices
+	std::vector<std::pair<int, int>> initialPairs(SphereMesh& sm, size_t count)
+	{
+		std::vector<std::pair<int, int>> pairs;
+
+		for (int i = 0; i < static_cast<int>(sm.timedSpheres.size()) && pairs.size() < count; i++)
+			for (int j : sm.timedSpheres[i].sphere.neighbourSpheres)
+				if (i < j && pairs.size() < count)
+					pairs.emplace_back(i, j);
+
+		return pairs;
+	}
+
+	// A candidate ranked in float, around its first sphere, costs about what the double solve gives and its minimizer
+	// costs what the double one does; the collapses that are executed are solved in double, so the sphere mesh only
+	// changes where the ranking does
+	bool floatCostsStayClose()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+
+		SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+		build(sm);
+
+		for (auto [i, j] : initialPairs(sm, 4096))
+		{
+			const Renderer::Sphere& first = sm.timedSpheres[i].sphere;
+			Renderer::Quadric sum = first.quadric + sm.timedSpheres[j].sphere.quadric;
+
+			Scalar cost;
+			Math::Vector4 minimizer;
+			sum.getMinimumAndMinimizer(cost, minimizer);
+
+			const Math::Vector4 origin(first.center, first.radius);
+			float floatCost;
+			float floatMinimizer[4];
+			if (!Renderer::QuadricT<float>(sum, origin).getMinimumAndMinimizer(floatCost, floatMinimizer, FLT_MAX,
+			                                                                   static_cast<float>(0.01 - first.radius)))
+				continue;
+
+			const Math::Vector4 sphere = origin + Math::Vector4(floatMinimizer[0], floatMinimizer[1], floatMinimizer[2],
+			                                                   floatMinimizer[3]);
+			if (std::abs(floatCost - cost) > FLOAT_COST_TOLERANCE * cost ||
+			    std::abs(sum.evaluateSQEM(sphere) - cost) > FLOAT_MINIMIZER_TOLERANCE * cost)
+			{
+				std::cerr << "  pair " << i << ", " << j << " costs " << cost << " in double and " << floatCost
+				          << " in float" << std::endl;
+				return false;
+			}
+		}
+
+		Scalar errors[2];
+		for (bool floatCosts : {false, true})
+		{
+			SphereMesh collapsed(&mesh, nullptr, SphereMesh::Deferred{});
+			build(collapsed, [&](SphereMesh& s) { s.FLOAT_CANDIDATE_COSTS = floatCosts; });
+			collapsed.collapseSphereMesh(TEST_TARGET);
+			errors[floatCosts] = collapsed.getQuadricError();
+		}
+
+		if (std::abs(errors[1] - errors[0]) > 0.05 * errors[0])
+		{
+			std::cerr << "  quadric error " << errors[0] << " in double and " << errors[1] << " in float" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// Lazy entries are solved before anything costlier is popped, so the collapses are those of eager costing; the
+	// batched pass solves eager candidates with QuadricBatch and lazy ones with Quadric, so its spheres are compared
+	// within LAZY_BATCH_TOLERANCE
+	bool lazyCostsKeepResult()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		const Scalar bdd = mesh.bbox.BDD().magnitude();
+
+		for (bool batched : {false, true})
+		{
+			Result results[2];
+
+			for (int lazy = 0; lazy < 2; lazy++)
+			{
+				SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+				build(sm, [&](SphereMesh& s) { s.LAZY_COLLAPSE_COSTS = lazy != 0; });
+
+				if (batched)
+					sm.collapseSphereMeshBatched(TEST_TARGET);
+				else
+					sm.collapseSphereMesh(TEST_TARGET);
+
+				results[lazy] = result(sm);
+			}
+
+			if (!same(results[0], results[1], bdd, batched ? LAZY_BATCH_TOLERANCE : 0))
+			{
+				std::cerr << "  " << (batched ? "batched" : "greedy") << " pass" << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// The packed links resolve as the per sphere ones did: following them to the sphere that links to itself, and
+	// -1 past a removed sphere
+	bool packedAliasesResolve()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+
+		SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+		build(sm);
+		sm.collapseSphereMesh(2 * TEST_TARGET);
+
+		int removed = -1;
+		for (int i = 0; i < static_cast<int>(sm.timedSpheres.size()) && removed < 0; i++)
+			if (sm.isTimedSphereAlive(i))
+				removed = i;
+		const std::vector<int> ownersBefore = vertexSpheres(sm);
+		sm.removeSphere(sm.timedSpheres[removed].sphere.getID());
+
+		const SphereMesh::Snapshot links = sm.snapshot();
+		if (links.aliases.size() != sm.timedSpheres.size() || links.timestamps.size() != sm.timedSpheres.size() ||
+		    links.quadricBounds.size() != sm.timedSpheres.size())
+		{
+			std::cerr << "  the packed arrays are not the size of the spheres" << std::endl;
+			return false;
+		}
+
+		for (int i = 0; i < static_cast<int>(links.aliases.size()); i++)
+		{
+			int expected = i;
+			while (expected >= 0 && links.aliases[expected] != expected)
+				expected = links.aliases[expected];
+
+			if (sm.alias(i) != expected)
+			{
+				std::cerr << "  sphere " << i << " resolves to " << sm.alias(i) << " instead of " << expected << std::endl;
+				return false;
+			}
+		}
+
+		// Every vertex still belongs to the sphere it belonged to, none for those of the removed sphere
+		const std::vector<int> owners = vertexSpheres(sm);
+		for (size_t v = 0; v < owners.size(); v++)
+			if (owners[v] != (ownersBefore[v] == removed ? -1 : ownersBefore[v]))
+			{
+				std::cerr << "  vertex " << v << " belongs to sphere " << owners[v] << std::endl;
+				return false;
+			}
+
+		return true;
+	}
+
+	// The vector solve of QuadricBatch against one Quadric solve per candidate, on the pairs of the initial spheres.
+	// FMA contraction rounds the two differently, so the costs are compared within COST_TOLERANCE
+	bool batchSolveMatchesQuadric()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		const Scalar bdd = mesh.bbox.BDD().magnitude();
+
+		SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+		build(sm);
+
+		const std::vector<std::pair<int, int>> pairs = initialPairs(sm, 4096);
+
+		Renderer::QuadricBatch batch;
+		for (auto [i, j] : pairs)
+			batch.add(sm.timedSpheres[i].sphere.quadric, sm.timedSpheres[j].sphere.quadric);
+
+		for (bool vectorized : {false, true})
+		{
+			if (vectorized)
+				batch.solve();
+			else
+				batch.solveScalar();
+
+			for (size_t k = 0; k < pairs.size(); k++)
+			{
+				Renderer::Quadric sum = sm.timedSpheres[pairs[k].first].sphere.quadric +
+				                        sm.timedSpheres[pairs[k].second].sphere.quadric;
+
+				Scalar cost;
+				Math::Vector4 minimizer;
+				sum.getMinimumAndMinimizer(cost, minimizer);
+
+				if (std::abs(batch.getCost(k) - cost) > COST_TOLERANCE * bdd * bdd ||
+				    std::abs(sum.evaluateSQEM(batch.getMinimizer(k)) - batch.getCost(k)) > COST_TOLERANCE * bdd * bdd)
+				{
+					std::cerr << "  " << (vectorized ? "vector" : "scalar") << " solve of pair " << pairs[k].first
+					          << ", " << pairs[k].second << " costs " << batch.getCost(k) << " instead of " << cost
+					          << std::endl;
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// The chunk passes only take collapses that the global pass would find about as cheap: the surface error of the
+	// chunked sphere mesh stays within CHUNKED_ERROR_RATIO of the unchunked one
+	bool chunkedStaysCloseToGlobal()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+		Renderer::ApproximationErrorEvaluator evaluator(mesh, 20000);
+
+		Scalar errors[2];
+		for (int chunked = 0; chunked < 2; chunked++)
+		{
+			SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+			build(sm, [&](SphereMesh& s) { s.CHUNK_VERTICES = chunked ? 300 : 0; });
+			sm.collapseSphereMesh(TEST_TARGET);
+
+			if (sm.getTimedSphereSize() != TEST_TARGET)
+			{
+				std::cerr << "  " << sm.getTimedSphereSize() << " spheres left" << std::endl;
+				return false;
+			}
+
+			errors[chunked] = evaluator.evaluate(sm).meanRelative;
+		}
+
+		if (errors[1] > CHUNKED_ERROR_RATIO * errors[0])
+		{
+			std::cerr << "  mean error " << errors[1] << " chunked and " << errors[0] << " unchunked" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// Rays at about 1e-4 radians to a capsule and to the flat side of a slab (radius 1, 1000 long), which sphere
+	// tracing closes in on too slowly to reach in its steps: the hit is still found, on the surface, through the BVH
+	// as well. A ray along the capsule, outside of it but inside its box, misses
+	bool grazingRaysHit()
+	{
+		auto primitive = [](std::initializer_list<Math::Vector3> centers)
+		{
+			Renderer::EnvelopePrimitive p;
+			p.boxMin = Math::Vector3(DBL_MAX, DBL_MAX, DBL_MAX);
+			p.boxMax = Math::Vector3(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+
+			for (const Math::Vector3& center : centers)
+			{
+				p.spheres[p.count] = p.count;
+				p.centers[p.count] = center;
+				p.radii[p.count] = 1;
+				p.count++;
+
+				for (int a = 0; a < 3; a++)
+				{
+					p.boxMin[a] = std::min(p.boxMin[a], center[a] - 1);
+					p.boxMax[a] = std::max(p.boxMax[a], center[a] + 1);
+				}
+			}
+
+			return p;
+		};
+
+		auto ray = [](const Math::Vector3& origin, Math::Vector3 direction)
+		{
+			Renderer::Ray r;
+			r.origin = origin;
+			direction.normalize();
+			r.direction = direction;
+			return r;
+		};
+
+		// The slab is tilted and the rays start inside the boxes, so entering a box doesn't bring them to the surface
+		const std::vector<Renderer::EnvelopePrimitive> envelope = {
+			primitive({Math::Vector3(0, 0, 0), Math::Vector3(1000, 0, 0)}),
+			primitive({Math::Vector3(0, 0, -2000), Math::Vector3(1000, 0, -1900), Math::Vector3(0, 1000, -2000)}),
+		};
+
+		Renderer::SphereMeshBVH bvh;
+		bvh.build(envelope);
+
+		Math::Vector3 slabNormal(-0.1, 0, 1);
+		slabNormal.normalize();
+		Math::Vector3 slabSide(1, 1, 0.1);
+		slabSide.normalize();
+
+		const Renderer::Ray grazing[2] = {
+			ray(Math::Vector3(1, 0.916, 0.5), Math::Vector3(1, -1e-4, 0)),
+			ray(Math::Vector3(100, 100, -1990) + slabNormal * 1.05, slabSide - slabNormal * 1e-4),
+		};
+
+		for (int k = 0; k < 2; k++)
+		{
+			Scalar weights[3];
+			const Scalar t = Renderer::SphereMeshBVH::rayDistance(envelope[k], grazing[k]);
+			const Scalar d = t == DBL_MAX ? DBL_MAX :
+			                 Renderer::SphereMeshBVH::signedDistance(envelope[k], grazing[k].origin +
+			                                                         grazing[k].direction * t, weights);
+
+			if (std::abs(d) > 1e-3 || bvh.raycast(grazing[k]).distance != t)
+			{
+				std::cerr << "  grazing ray " << k << " hits at " << t << ", " << d << " from the surface, "
+				          << bvh.raycast(grazing[k]).distance << " through the BVH" << std::endl;
+				return false;
+			}
+		}
+
+		const Renderer::Ray along = ray(Math::Vector3(1, 0.9, 0.9), Math::Vector3(1, 0, 0));
+		if (Renderer::SphereMeshBVH::rayDistance(envelope[0], along) != DBL_MAX)
+		{
+			std::cerr << "  a ray along the capsule hits it" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// Every BVH answer against every primitive of the envelope: distances of closest points and ray hits, and
+	// whether a sphere touches the envelope. Queries are drawn around the bounding box
+	bool bvhMatchesBruteForce()
+	{
+		TriMesh mesh(modelPath(TEST_MODEL), nullptr);
+
+		SphereMesh sm(&mesh, nullptr, SphereMesh::Deferred{});
+		build(sm);
+		sm.collapseSphereMesh(TEST_TARGET);
+
+		Renderer::SphereMeshBVH bvh;
+		bvh.build(sm);
+
+		std::mt19937 generator(42);
+		std::uniform_real_distribution<Scalar> uniform(0, 1);
+		std::normal_distribution<Scalar> normal(0, 1);
+
+		const Math::Vector3 boxMin = mesh.bbox.minCorner;
+		const Math::Vector3 diagonal = mesh.bbox.BDD();
+		const Scalar size = diagonal.magnitude();
+		auto inBox = [&]()
+		{
+			return boxMin + Math::Vector3(diagonal[0] * (uniform(generator) * 1.2 - 0.1),
+			                              diagonal[1] * (uniform(generator) * 1.2 - 0.1),
+			                              diagonal[2] * (uniform(generator) * 1.2 - 0.1));
+		};
+
+		std::vector<Math::Vector3> points;
+		std::vector<Renderer::Ray> rays;
+		std::vector<Math::Vector4> spheres;
+		for (int q = 0; q < 2000; q++)
+		{
+			points.push_back(inBox());
+
+			Math::Vector3 outside(normal(generator), normal(generator), normal(generator));
+			outside.normalize();
+
+			Renderer::Ray ray;
+			ray.origin = boxMin + diagonal * 0.5 + outside * size;
+			ray.direction = inBox() - ray.origin;
+			ray.direction.normalize();
+			rays.push_back(ray);
+
+			spheres.emplace_back(inBox(), uniform(generator) * 0.05 * size);
+		}
+
+		std::vector<Renderer::EnvelopeHit> closest;
+		std::vector<Renderer::RayHit> hits;
+		std::vector<std::uint8_t> overlaps;
+		bvh.closest(points, closest);
+		bvh.raycast(rays, hits);
+		bvh.overlaps(spheres, overlaps);
+
+		for (size_t q = 0; q < points.size(); q++)
+		{
+			Scalar nearest = DBL_MAX, first = DBL_MAX;
+			bool touches = false;
+
+			for (const Renderer::EnvelopePrimitive& primitive : bvh.primitives)
+			{
+				Scalar weights[3];
+				nearest = std::min(nearest, Renderer::SphereMeshBVH::signedDistance(primitive, points[q], weights));
+				first = std::min(first, Renderer::SphereMeshBVH::rayDistance(primitive, rays[q]));
+				touches |= Renderer::SphereMeshBVH::signedDistance(primitive, spheres[q].truncateToVector3(), weights) <
+				           spheres[q].coordinates.w;
+			}
+
+			if (closest[q].distance != nearest || hits[q].distance != first || (overlaps[q] != 0) != touches)
+			{
+				std::cerr << "  query " << q << ": closest " << closest[q].distance << "/" << nearest << ", ray "
+				          << hits[q].distance << "/" << first << ", overlap " << int(overlaps[q]) << "/" << touches
+				          << std::endl;
+				return false;
+			}
+		}
+
+		return grazingRaysHit();
+	}
+
+	struct TestCase
+	{
+		const char* name;
+		bool (*run)();
+	};
+
+	const TestCase TEST_CASES[] = {
+		{"batch_of_one_matches_greedy", batchOfOneMatchesGreedy},
+		{"pruning_keeps_result", pruningKeepsResult},
+		{"rings_match_default_neighbourhoods", ringsMatchDefaultNeighbourhoods},
+		{"edits_match_full_rebuild", editsMatchFullRebuild},
+		{"multiple_choice_repeats_seed", multipleChoiceRepeatsSeed},
+		{"multiple_choice_other_seed_differs", multipleChoiceOtherSeedDiffers},
+		{"checkpoint_resumes_collapse", checkpointResumesCollapse},
+		{"cached_open_matches_fresh", cachedOpenMatchesFresh},
+		{"spatial_order_keeps_file_vertices", spatialOrderKeepsFileVertices},
+		{"exports_match_active_spheres", exportsMatchActiveSpheres},
+		{"float_costs_stay_close", floatCostsStayClose},
+		{"lazy_costs_keep_result", lazyCostsKeepResult},
+		{"packed_aliases_resolve", packedAliasesResolve},
+		{"batch_solve_matches_quadric", batchSolveMatchesQuadric},
+		{"chunked_stays_close_to_global", chunkedStaysCloseToGlobal},
+		{"bvh_matches_brute_force", bvhMatchesBruteForce},
+	};
+}
+
+int main(int argc, char** argv)
+{
+	Renderer::Region::initialize();
+
+	std::vector<std::string> names(argv + 1, argv + argc);
+	bool passed = true;
+
+	for (const TestCase& test : TEST_CASES)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), test.name) == names.end())
+			continue;
+
+		bool ok = test.run();
+		std::cout << (ok ? "PASS " : "FAIL ") << test.name << std::endl;
+		passed &= ok;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -4,6 +4,7 @@
 #include <Camera.hpp>
 #include <SphereMesh.hpp>
 #include <Region.hpp>
+#include <PreprocessCache.hpp>
 
 #include <YAMLUtils.hpp>
 
@@ -15,14 +16,16 @@ Renderer::SphereMesh* sm;
 Renderer::Shader* sphereShader;
 Renderer::Shader* mainShader;
 
+Renderer::PreprocessCache preprocessCache;
+
 bool loadCachedResult() {    
     if (std::filesystem::exists(".cache")) {
         std::filesystem::path filePath = std::filesystem::absolute(".cache");
         
         std::string referenceMeshPath = getYAMLRenderableMeshPath(filePath);
         
-        mesh = new Renderer::TriMesh(referenceMeshPath, mainShader);
-        sm = new Renderer::SphereMesh(mesh, sphereShader);
+        mesh = new Renderer::TriMesh(referenceMeshPath, mainShader, preprocessCache);
+        sm = new Renderer::SphereMesh(mesh, sphereShader, preprocessCache);
         
         sm->loadFromYaml(filePath);
         
@@ -52,9 +55,9 @@ int main()
 //											"/camel-reference-4040.obj", mainShader);
 	    mesh = new Renderer::TriMesh("/Users/davidepaollilo/Workspaces/C++/SphereMeshEditor/Assets/Models"
 											"/smaug"
-											".obj", mainShader);
+											".obj", mainShader, preprocessCache);
 //        mesh = new Renderer::TriMesh("/Users/davidepaollilo/Workspaces/C++/Thesis/Assets/Models/bunny250NH.obj", mainShader);
-        sm = new Renderer::SphereMesh(mesh, sphereShader);
+        sm = new Renderer::SphereMesh(mesh, sphereShader, preprocessCache);
     }
 	
 	window->setMeshShader(mainShader);